@@ -0,0 +1,370 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include <string.h>
+
+static const char * const class_names[N_CORPORA] = {
+  "ascii",
+  "cjk",
+  "emoji",
+  "links",
+  "entities",
+  "long",
+};
+
+static const char * const api_names[N_APIS] = {
+  "count_characters_n",
+  "extract_entities_n",
+  "extract_entities_and_text_n",
+};
+
+static const char * const words[] = {
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "release",
+  "today", "new", "version", "thanks", "everyone", "who", "helped", "with",
+  "this", "can't", "wait", "see", "you", "there!", "really", "great", "talk",
+  "about", "performance,", "memory", "and", "latency.", "Check", "it", "out:",
+};
+
+static const char * const links[] = {
+  "https://example.com",
+  "http://www.gnome.org/news/",
+  "https://github.com/baedert/corebird/issues/123",
+  "www.twitter.com",
+  "foo.co.uk/bar?baz=1&qux=2",
+  "t.co/abcDEF123",
+  "https://en.wikipedia.org/wiki/Foo_(bar)",
+  "example.io",
+  "https://a.b.c.example.net:8080/path#frag",
+};
+
+static const char * const emoji[] = {
+  "\xF0\x9F\x98\x80",                          /* grinning face */
+  "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD",          /* thumbs up, skin tone */
+  "\xF0\x9F\x87\xA9\xF0\x9F\x87\xAA",          /* flag */
+  "\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7", /* ZWJ family */
+  "\xE2\x9D\xA4\xEF\xB8\x8F",                  /* heart, variation selector */
+  "\xF0\x9F\x8E\x89",                          /* party popper */
+};
+
+/* xorshift32, so corpora are identical on every machine and every run */
+static inline guint32
+next_random (guint32 *state)
+{
+  guint32 x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+
+  return x;
+}
+
+static inline guint
+random_range (guint32 *state,
+              guint    min,
+              guint    max)
+{
+  return min + next_random (state) % (max - min + 1);
+}
+
+#define PICK(array, state) (array[next_random (state) % G_N_ELEMENTS (array)])
+
+static void
+append_word (GString *s,
+             guint32 *state)
+{
+  g_string_append (s, PICK (words, state));
+}
+
+static void
+append_cjk (GString *s,
+            guint32 *state)
+{
+  guint n = random_range (state, 2, 8);
+  guint i;
+
+  for (i = 0; i < n; i ++) {
+    // Mostly CJK ideographs, some hiragana
+    if (next_random (state) % 4 == 0) {
+      g_string_append_unichar (s, random_range (state, 0x3041, 0x3096));
+    } else {
+      g_string_append_unichar (s, random_range (state, 0x4E00, 0x9FFF));
+    }
+  }
+
+  if (next_random (state) % 3 == 0) {
+    g_string_append (s, "\xE3\x80\x82"); /* ideographic full stop */
+  }
+}
+
+static void
+append_mention_or_hashtag (GString *s,
+                           guint32 *state)
+{
+  g_string_append_c (s, next_random (state) % 2 ? '@' : '#');
+  g_string_append (s, PICK (words, state));
+  if (next_random (state) % 4 == 0) {
+    g_string_append_printf (s, "_%u", next_random (state) % 1000);
+  }
+}
+
+/* Appends one whitespace-separated piece of text in the style of @class */
+static void
+append_piece (GString     *s,
+              CorpusClass  class,
+              guint32     *state)
+{
+  guint r = next_random (state) % 100;
+
+  switch (class) {
+    case CORPUS_ASCII:
+      append_word (s, state);
+    break;
+
+    case CORPUS_CJK:
+      if (r < 85) {
+        append_cjk (s, state);
+      } else {
+        append_word (s, state);
+      }
+    break;
+
+    case CORPUS_EMOJI:
+      if (r < 60) {
+        g_string_append (s, PICK (emoji, state));
+        if (r < 20) {
+          g_string_append (s, PICK (emoji, state));
+        }
+      } else {
+        append_word (s, state);
+      }
+    break;
+
+    case CORPUS_LINKS:
+      if (r < 40) {
+        g_string_append (s, PICK (links, state));
+      } else {
+        append_word (s, state);
+      }
+    break;
+
+    case CORPUS_ENTITIES:
+      if (r < 60) {
+        append_mention_or_hashtag (s, state);
+      } else {
+        append_word (s, state);
+      }
+    break;
+
+    case CORPUS_LONG:
+      // A bit of everything
+      if (r < 5) {
+        g_string_append (s, PICK (links, state));
+      } else if (r < 10) {
+        append_mention_or_hashtag (s, state);
+      } else if (r < 15) {
+        g_string_append (s, PICK (emoji, state));
+      } else if (r < 25) {
+        append_cjk (s, state);
+      } else {
+        append_word (s, state);
+      }
+    break;
+
+    default:
+      g_assert_not_reached ();
+  }
+}
+
+/*
+ * corpus_new:
+ * @class: What kind of texts to generate
+ * @n_texts: Number of texts to generate
+ * @seed: Seed for the generator, must not be 0
+ *
+ * Generates a deterministic corpus. Tweet-sized texts end at roughly 280
+ * characters, CORPUS_LONG texts are 2-8 KB documents.
+ */
+Corpus *
+corpus_new (CorpusClass class,
+            gsize       n_texts,
+            guint32     seed)
+{
+  Corpus *corpus = g_new0 (Corpus, 1);
+  GString *data = g_string_new (NULL);
+  GArray *offsets = g_array_new (FALSE, FALSE, sizeof (gsize));
+  guint32 state = seed;
+  gsize i;
+
+  g_assert (seed != 0);
+
+  for (i = 0; i < n_texts; i ++) {
+    const gsize start = data->len;
+    const gsize target = class == CORPUS_LONG ? random_range (&state, 2048, 8192)
+                                              : random_range (&state, 20, 280);
+
+    g_array_append_val (offsets, start);
+
+    while (data->len - start < target) {
+      if (data->len > start) {
+        g_string_append_c (data, next_random (&state) % 16 == 0 ? '\n' : ' ');
+      }
+      append_piece (data, class, &state);
+    }
+
+    // The NUL terminates the text, so the API can peek past its end
+    g_string_append_c (data, '\0');
+  }
+
+  corpus->class = class;
+  corpus->n_texts = n_texts;
+  corpus->texts = g_new (const char *, n_texts);
+  corpus->lengths = g_new (gsize, n_texts);
+  corpus->data = g_string_free (data, FALSE);
+
+  for (i = 0; i < n_texts; i ++) {
+    corpus->texts[i] = corpus->data + g_array_index (offsets, gsize, i);
+    corpus->lengths[i] = strlen (corpus->texts[i]);
+    corpus->n_bytes += corpus->lengths[i];
+  }
+
+  g_array_free (offsets, TRUE);
+
+  return corpus;
+}
+
+void
+corpus_free (Corpus *corpus)
+{
+  g_free (corpus->data);
+  g_free (corpus->texts);
+  g_free (corpus->lengths);
+  g_free (corpus);
+}
+
+const char *
+corpus_class_name (CorpusClass class)
+{
+  g_assert (class < N_CORPORA);
+
+  return class_names[class];
+}
+
+gboolean
+corpus_class_parse (const char  *name,
+                    CorpusClass *out_class)
+{
+  guint i;
+
+  for (i = 0; i < N_CORPORA; i ++) {
+    if (strcmp (name, class_names[i]) == 0) {
+      *out_class = i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+const char *
+api_name (Api api)
+{
+  g_assert (api < N_APIS);
+
+  return api_names[api];
+}
+
+/*
+ * api_call:
+ *
+ * Calls @api on @text and frees the result, like a real caller would.
+ *
+ * Returns: The weighted length, so the call cannot be optimized out.
+ */
+gsize
+api_call (Api         api,
+          const char *text,
+          gsize       length)
+{
+  TlEntity *entities;
+  gsize n_entities;
+  gsize weighted_length;
+
+  switch (api) {
+    case API_COUNT:
+      return tl_count_characters_n (text, length);
+
+    case API_EXTRACT:
+      entities = tl_extract_entities_n (text, length, &n_entities, &weighted_length);
+    break;
+
+    case API_EXTRACT_AND_TEXT:
+      entities = tl_extract_entities_and_text_n (text, length, &n_entities, &weighted_length);
+    break;
+
+    default:
+      g_assert_not_reached ();
+  }
+
+  g_free (entities);
+
+  return weighted_length + n_entities;
+}
+
+void
+histogram_init (Histogram *histogram)
+{
+  memset (histogram, 0, sizeof (Histogram));
+  histogram->min = G_MAXUINT64;
+}
+
+/*
+ * histogram_percentile:
+ * @percentile: Between 0 and 1
+ *
+ * Returns: The upper bound of the bucket containing @percentile of all values
+ */
+guint64
+histogram_percentile (const Histogram *histogram,
+                      double           percentile)
+{
+  const guint64 rank = MAX (1, (guint64)(percentile * histogram->n_values + 0.5));
+  guint64 seen = 0;
+  guint i;
+
+  if (histogram->n_values == 0) {
+    return 0;
+  }
+
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i ++) {
+    seen += histogram->counts[i];
+    if (seen >= rank) {
+      break;
+    }
+  }
+
+  if (i < HISTOGRAM_SUB_BUCKETS) {
+    return i;
+  } else {
+    const guint shift = i / HISTOGRAM_SUB_BUCKETS - 1;
+    const guint64 top = i % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+
+    return MIN (((top + 1) << shift) - 1, histogram->max);
+  }
+}
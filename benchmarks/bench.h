@@ -0,0 +1,118 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_BENCH_H__
+#define __TL_BENCH_H__
+
+#include "libtweetlength.h"
+#include <time.h>
+
+typedef enum {
+  CORPUS_ASCII,
+  CORPUS_CJK,
+  CORPUS_EMOJI,
+  CORPUS_LINKS,
+  CORPUS_ENTITIES,
+  CORPUS_LONG,
+
+  N_CORPORA
+} CorpusClass;
+
+typedef enum {
+  API_COUNT,
+  API_EXTRACT,
+  API_EXTRACT_AND_TEXT,
+
+  N_APIS
+} Api;
+
+/* Generated texts, all stored back to back in one NUL-separated buffer */
+typedef struct {
+  CorpusClass class;
+  char *data;
+  const char **texts;
+  gsize *lengths;
+  gsize n_texts;
+  gsize n_bytes;
+} Corpus;
+
+Corpus     *corpus_new            (CorpusClass  class,
+                                   gsize        n_texts,
+                                   guint32      seed);
+void        corpus_free           (Corpus      *corpus);
+const char *corpus_class_name     (CorpusClass  class);
+gboolean    corpus_class_parse    (const char  *name,
+                                   CorpusClass *out_class);
+
+const char *api_name              (Api          api);
+gsize       api_call              (Api          api,
+                                   const char  *text,
+                                   gsize        length);
+
+/*
+ * Log-bucketed histogram in the style of HdrHistogram: every power of two is
+ * split into 2^HISTOGRAM_SUB_BITS linear buckets, so any recorded value is
+ * off by at most 1/16th of itself.
+ */
+#define HISTOGRAM_SUB_BITS    4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_N_BUCKETS   ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+  guint64 counts[HISTOGRAM_N_BUCKETS];
+  guint64 n_values;
+  guint64 sum;
+  guint64 min;
+  guint64 max;
+} Histogram;
+
+void        histogram_init        (Histogram       *histogram);
+guint64     histogram_percentile  (const Histogram *histogram,
+                                   double           percentile);
+
+static inline void
+histogram_record (Histogram *histogram,
+                  guint64    value)
+{
+  guint index;
+
+  if (value < HISTOGRAM_SUB_BUCKETS) {
+    index = value;
+  } else {
+    const guint shift = g_bit_storage (value) - 1 - HISTOGRAM_SUB_BITS;
+
+    index = (shift + 1) * HISTOGRAM_SUB_BUCKETS + (guint)(value >> shift) - HISTOGRAM_SUB_BUCKETS;
+  }
+
+  histogram->counts[index] ++;
+  histogram->n_values ++;
+  histogram->sum += value;
+  histogram->min = MIN (histogram->min, value);
+  histogram->max = MAX (histogram->max, value);
+}
+
+static inline guint64
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (guint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,672 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Counts instructions, branch mispredictions and last-level cache misses per
+ * input byte for every stage and corpus class. Unlike wall-clock time, the
+ * instruction count is deterministic, so it is compared against a baseline.
+ *
+ * Counters come from perf_event_open() if the kernel allows it. Otherwise,
+ * with --valgrind, every stage runs in a child process under cachegrind: once
+ * with zero iterations and once with one, the difference is the stage itself.
+ * Without either, the benchmark is skipped.
+ *
+ * A baseline only applies to the configuration it was recorded with: the
+ * build (INSTRUCTIONS_CONFIG, set by meson), the backend and TL_KERNELS.
+ * For any other configuration, nothing is compared and the benchmark counts
+ * as skipped. A baseline without counts for this one fails.
+ */
+
+#include "bench.h"
+#include "records.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#define N_TEXTS     500
+#define SKIP_EXIT   77 /* What meson treats as a skipped test */
+
+#ifndef INSTRUCTIONS_CONFIG
+#define INSTRUCTIONS_CONFIG "unknown"
+#endif
+
+typedef enum {
+  STAGE_TOKENIZE,
+  STAGE_PARSE,
+  STAGE_COUNT,
+  STAGE_EXTRACT,
+  STAGE_EXTRACT_AND_TEXT,
+
+  N_STAGES
+} Stage;
+
+static const char * const stage_names[N_STAGES] = {
+  "tokenize",
+  "parse",
+  "count_characters_n",
+  "extract_entities_n",
+  "extract_entities_and_text_n",
+};
+
+typedef enum {
+  COUNTER_INSTRUCTIONS,
+  COUNTER_BRANCH_MISSES,
+  COUNTER_CACHE_MISSES,
+
+  N_COUNTERS
+} Counter;
+
+typedef struct {
+  guint64 values[N_COUNTERS];
+  gboolean available[N_COUNTERS];
+} Counts;
+
+typedef struct {
+  Corpus *corpus;
+  TlTokens **tokens; // Input of the parse stage
+} StageInput;
+
+static volatile gsize sink;
+
+static StageInput *
+stage_input_new (Stage       stage,
+                 CorpusClass class)
+{
+  StageInput *input = g_new0 (StageInput, 1);
+  gsize i;
+
+  input->corpus = corpus_new (class, class == CORPUS_LONG ? N_TEXTS / 20 : N_TEXTS, 0x5eed + class);
+
+  if (stage == STAGE_PARSE) {
+    input->tokens = g_new (TlTokens *, input->corpus->n_texts);
+    for (i = 0; i < input->corpus->n_texts; i ++) {
+      input->tokens[i] = tl_tokenize_n (input->corpus->texts[i], input->corpus->lengths[i]);
+    }
+  }
+
+  return input;
+}
+
+static void
+stage_input_free (StageInput *input)
+{
+  gsize i;
+
+  if (input->tokens != NULL) {
+    for (i = 0; i < input->corpus->n_texts; i ++) {
+      tl_tokens_free (input->tokens[i]);
+    }
+    g_free (input->tokens);
+  }
+
+  corpus_free (input->corpus);
+  g_free (input);
+}
+
+static void
+stage_run (Stage       stage,
+           StageInput *input)
+{
+  const Corpus *corpus = input->corpus;
+  gsize result = 0;
+  gsize i;
+
+  for (i = 0; i < corpus->n_texts; i ++) {
+    TlEntity *entities;
+    TlTokens *tokens;
+    gsize n_entities;
+    gsize length;
+
+    switch (stage) {
+      case STAGE_TOKENIZE:
+        tokens = tl_tokenize_n (corpus->texts[i], corpus->lengths[i]);
+        tl_tokens_free (tokens);
+      break;
+
+      case STAGE_PARSE:
+        entities = tl_tokens_extract_entities (input->tokens[i], &n_entities, &length);
+        result += length;
+        g_free (entities);
+      break;
+
+      case STAGE_COUNT:
+        result += api_call (API_COUNT, corpus->texts[i], corpus->lengths[i]);
+      break;
+
+      case STAGE_EXTRACT:
+        result += api_call (API_EXTRACT, corpus->texts[i], corpus->lengths[i]);
+      break;
+
+      case STAGE_EXTRACT_AND_TEXT:
+        result += api_call (API_EXTRACT_AND_TEXT, corpus->texts[i], corpus->lengths[i]);
+      break;
+
+      default:
+        g_assert_not_reached ();
+    }
+  }
+
+  sink += result;
+}
+
+#ifdef __linux__
+typedef struct {
+  int leader;
+  int fds[N_COUNTERS];
+} PerfCounters;
+
+static const guint64 perf_configs[N_COUNTERS] = {
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_BRANCH_MISSES,
+  PERF_COUNT_HW_CACHE_MISSES,
+};
+
+static gboolean
+perf_open (PerfCounters *counters)
+{
+  guint i;
+
+  counters->leader = -1;
+
+  for (i = 0; i < N_COUNTERS; i ++) {
+    struct perf_event_attr attr;
+
+    memset (&attr, 0, sizeof (attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof (attr);
+    attr.config = perf_configs[i];
+    attr.disabled = counters->leader == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    counters->fds[i] = syscall (SYS_perf_event_open, &attr, 0, -1, counters->leader, 0);
+
+    if (i == COUNTER_INSTRUCTIONS) {
+      // Without instructions, there is no point
+      if (counters->fds[i] < 0) {
+        return FALSE;
+      }
+      counters->leader = counters->fds[i];
+    }
+    // Some VMs only expose a subset, the rest just gets reported as null
+  }
+
+  return TRUE;
+}
+
+static void
+perf_close (PerfCounters *counters)
+{
+  guint i;
+
+  for (i = 0; i < N_COUNTERS; i ++) {
+    if (counters->fds[i] >= 0) {
+      close (counters->fds[i]);
+    }
+  }
+}
+
+static void
+perf_measure (PerfCounters *counters,
+              Stage         stage,
+              StageInput   *input,
+              Counts       *out_counts)
+{
+  struct {
+    guint64 n;
+    guint64 values[N_COUNTERS];
+  } data;
+  guint i, v;
+
+  // Warm up, so lazy binding and first-touch page faults are not counted
+  stage_run (stage, input);
+
+  ioctl (counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl (counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  stage_run (stage, input);
+  ioctl (counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  memset (&data, 0, sizeof (data));
+  if (read (counters->leader, &data, sizeof (data)) < 0) {
+    data.n = 0;
+  }
+
+  // The group only contains the counters that could be opened, in order
+  for (i = 0, v = 0; i < N_COUNTERS; i ++) {
+    out_counts->available[i] = counters->fds[i] >= 0 && v < data.n;
+    out_counts->values[i] = out_counts->available[i] ? data.values[v++] : 0;
+  }
+}
+#endif
+
+/* Runs @stage on @class in a child process under cachegrind */
+static gboolean
+cachegrind_run (const char  *valgrind,
+                Stage        stage,
+                CorpusClass  class,
+                guint        iterations,
+                Counts      *out_counts,
+                GError     **error)
+{
+  static const char * const keys[N_COUNTERS] = { "Irefs", "Mispredicts", "LLmisses" };
+  char *child_arg = g_strdup_printf ("--child=%s/%s/%u", stage_names[stage],
+                                     corpus_class_name (class), iterations);
+  char *argv[] = {
+    (char *)valgrind, "--tool=cachegrind", "--cache-sim=yes", "--branch-sim=yes",
+    "--cachegrind-out-file=/dev/null", "/proc/self/exe", child_arg, NULL
+  };
+  char *child_stderr = NULL;
+  char **lines;
+  int status;
+  gboolean success;
+  guint i, c;
+
+  // The child's /proc/self/exe is valgrind, so resolve ours now
+  argv[5] = g_file_read_link ("/proc/self/exe", error);
+  if (argv[5] == NULL) {
+    g_free (child_arg);
+    return FALSE;
+  }
+
+  success = g_spawn_sync (NULL, argv, NULL, G_SPAWN_STDOUT_TO_DEV_NULL, NULL, NULL,
+                          NULL, &child_stderr, &status, error) &&
+            g_spawn_check_exit_status (status, error);
+
+  g_free (argv[5]);
+  g_free (child_arg);
+
+  if (!success) {
+    g_free (child_stderr);
+    return FALSE;
+  }
+
+  memset (out_counts, 0, sizeof (Counts));
+
+  // Summary lines look like "==1234== I   refs:      1,234,567"
+  lines = g_strsplit (child_stderr, "\n", -1);
+  for (i = 0; lines[i] != NULL; i ++) {
+    const char *line = strstr (lines[i], "== ");
+    const char *colon;
+    GString *key;
+
+    if (line == NULL || (colon = strchr (line, ':')) == NULL) {
+      continue;
+    }
+
+    key = g_string_new (NULL);
+    for (line += 3; line < colon; line ++) {
+      if (*line != ' ') {
+        g_string_append_c (key, *line);
+      }
+    }
+
+    for (c = 0; c < N_COUNTERS; c ++) {
+      if (strcmp (key->str, keys[c]) == 0) {
+        GString *digits = g_string_new (NULL);
+        const char *p;
+
+        for (p = colon + 1; *p != '\0' && *p != '('; p ++) {
+          if (g_ascii_isdigit (*p)) {
+            g_string_append_c (digits, *p);
+          }
+        }
+
+        out_counts->values[c] = g_ascii_strtoull (digits->str, NULL, 10);
+        out_counts->available[c] = digits->len > 0;
+        g_string_free (digits, TRUE);
+      }
+    }
+
+    g_string_free (key, TRUE);
+  }
+
+  g_strfreev (lines);
+  g_free (child_stderr);
+
+  if (!out_counts->available[COUNTER_INSTRUCTIONS]) {
+    g_set_error (error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+                 "No instruction count in cachegrind output");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+cachegrind_measure (const char  *valgrind,
+                    Stage        stage,
+                    CorpusClass  class,
+                    Counts      *out_counts,
+                    GError     **error)
+{
+  Counts setup;
+  guint i;
+
+  if (!cachegrind_run (valgrind, stage, class, 0, &setup, error) ||
+      !cachegrind_run (valgrind, stage, class, 1, out_counts, error)) {
+    return FALSE;
+  }
+
+  for (i = 0; i < N_COUNTERS; i ++) {
+    out_counts->values[i] = out_counts->values[i] > setup.values[i] ?
+                            out_counts->values[i] - setup.values[i] : 0;
+  }
+
+  return TRUE;
+}
+
+/* What the process started by cachegrind_run() does */
+static int
+child_main (const char *spec)
+{
+  char **parts = g_strsplit (spec, "/", -1);
+  Stage stage = N_STAGES;
+  CorpusClass class;
+  StageInput *input;
+  guint iterations;
+  guint i;
+
+  if (g_strv_length (parts) != 3 || !corpus_class_parse (parts[1], &class)) {
+    g_printerr ("Invalid --child argument: %s\n", spec);
+    g_strfreev (parts);
+    return 1;
+  }
+
+  for (i = 0; i < N_STAGES; i ++) {
+    if (strcmp (parts[0], stage_names[i]) == 0) {
+      stage = i;
+    }
+  }
+  iterations = atoi (parts[2]);
+  g_strfreev (parts);
+
+  if (stage == N_STAGES) {
+    g_printerr ("Invalid stage in --child argument: %s\n", spec);
+    return 1;
+  }
+
+  input = stage_input_new (stage, class);
+  stage_run (stage, input); // Warm up, like perf_measure()
+  for (i = 0; i < iterations; i ++) {
+    stage_run (stage, input);
+  }
+  stage_input_free (input);
+
+  return 0;
+}
+
+/*
+ * The baseline is a text file with a "config CONFIGURATION" line and one
+ * "stage corpus instructions_per_byte" line per measurement. Lines starting
+ * with # are comments.
+ */
+static GHashTable *
+baseline_load (const char  *filename,
+               char       **out_config,
+               GError     **error)
+{
+  GHashTable *baseline = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  char *contents;
+  char **lines;
+  guint i;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error)) {
+    g_hash_table_unref (baseline);
+    return NULL;
+  }
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i] != NULL; i ++) {
+    char **fields;
+    double *value;
+
+    if (lines[i][0] == '#' || lines[i][0] == '\0') {
+      continue;
+    }
+
+    fields = g_strsplit_set (lines[i], " \t", -1);
+    if (g_strv_length (fields) == 2 && strcmp (fields[0], "config") == 0) {
+      g_free (*out_config);
+      *out_config = g_strdup (fields[1]);
+    } else if (g_strv_length (fields) == 3) {
+      value = g_new (double, 1);
+      *value = g_ascii_strtod (fields[2], NULL);
+      g_hash_table_insert (baseline, g_strdup_printf ("%s %s", fields[0], fields[1]), value);
+    }
+    g_strfreev (fields);
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return baseline;
+}
+
+static void
+append_per_byte (GString      *out,
+                 const char   *name,
+                 const Counts *counts,
+                 Counter       counter,
+                 gsize         n_bytes)
+{
+  if (counts->available[counter]) {
+    g_string_append_printf (out, ",\"%s\":%.4f", name, (double)counts->values[counter] / n_bytes);
+  } else {
+    g_string_append_printf (out, ",\"%s\":null", name);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  char *valgrind = NULL;
+  char *baseline_filename = NULL;
+  char *write_baseline_filename = NULL;
+  char *child_spec = NULL;
+  double tolerance = 0.02;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  GHashTable *baseline = NULL;
+  char *baseline_config = NULL;
+  char *config;
+  gboolean compare = FALSE;
+  guint n_compared = 0;
+  GString *out;
+  GString *new_baseline;
+  const char *backend = NULL;
+  gboolean first = TRUE;
+  gboolean success = TRUE;
+#ifdef __linux__
+  PerfCounters perf;
+#endif
+  guint stage, c;
+  const GOptionEntry entries[] = {
+    { "baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline_filename,
+      "Compare instruction counts against this file", "FILE" },
+    { "tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &tolerance,
+      "Allowed relative increase over the baseline", "FRACTION" },
+    { "write-baseline", 'w', 0, G_OPTION_ARG_FILENAME, &write_baseline_filename,
+      "Write the measured instruction counts to this file", "FILE" },
+    { "valgrind", 0, 0, G_OPTION_ARG_FILENAME, &valgrind,
+      "Run under cachegrind if perf counters are not available", "PATH" },
+    { "child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, &child_spec, NULL, NULL },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("- count instructions per input byte");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  if (child_spec != NULL) {
+    int status = child_main (child_spec);
+
+    g_free (child_spec);
+    return status;
+  }
+
+#ifdef __linux__
+  if (perf_open (&perf)) {
+    backend = "perf";
+  }
+#endif
+  if (backend == NULL && valgrind != NULL) {
+    backend = "cachegrind";
+  }
+  if (backend == NULL) {
+    g_printerr ("Neither perf counters nor valgrind are available, skipping\n");
+    return SKIP_EXIT;
+  }
+
+  config = g_strdup_printf ("%s/%s/kernels-%s", INSTRUCTIONS_CONFIG, backend,
+                            g_getenv ("TL_KERNELS") != NULL ? g_getenv ("TL_KERNELS") : "auto");
+
+  if (baseline_filename != NULL) {
+    baseline = baseline_load (baseline_filename, &baseline_config, &error);
+    if (baseline == NULL) {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+    compare = g_strcmp0 (baseline_config, config) == 0;
+    if (baseline_config == NULL || g_hash_table_size (baseline) == 0) {
+      g_printerr ("%s has no instruction counts, record them with --write-baseline\n", baseline_filename);
+      success = FALSE;
+    } else if (!compare) {
+      g_printerr ("%s was recorded with %s, not comparing counts of %s\n",
+                  baseline_filename, baseline_config, config);
+    }
+  }
+
+  out = g_string_new (NULL);
+  g_string_append_printf (out, "{\n  \"benchmark\":\"instructions\",\n  \"backend\":\"%s\",\n"
+                               "  \"config\":", backend);
+  json_append_string (out, config);
+  g_string_append_printf (out, ",\n  \"tolerance\":%.4f,\n  \"results\":[\n", tolerance);
+  new_baseline = g_string_new ("# Instructions per input byte, written by instructions --write-baseline\n"
+                               "# stage corpus instructions_per_byte\n");
+  g_string_append_printf (new_baseline, "config %s\n", config);
+
+  for (stage = 0; stage < N_STAGES; stage ++) {
+    for (c = 0; c < N_CORPORA; c ++) {
+      StageInput *input = stage_input_new (stage, c);
+      const gsize n_bytes = input->corpus->n_bytes;
+      Counts counts;
+      char *key;
+      double *expected = NULL;
+      double per_byte;
+
+#ifdef __linux__
+      if (strcmp (backend, "perf") == 0) {
+        perf_measure (&perf, stage, input, &counts);
+      } else
+#endif
+      if (!cachegrind_measure (valgrind, stage, c, &counts, &error)) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+      }
+
+      stage_input_free (input);
+
+      per_byte = (double)counts.values[COUNTER_INSTRUCTIONS] / n_bytes;
+      key = g_strdup_printf ("%s %s", stage_names[stage], corpus_class_name (c));
+      g_string_append_printf (new_baseline, "%s %.4f\n", key, per_byte);
+
+      if (!first) {
+        g_string_append (out, ",\n");
+      }
+      first = FALSE;
+
+      g_string_append_printf (out, "    {\"stage\":\"%s\",\"corpus\":\"%s\",\"bytes\":%" G_GSIZE_FORMAT,
+                              stage_names[stage], corpus_class_name (c), n_bytes);
+      append_per_byte (out, "instructions_per_byte", &counts, COUNTER_INSTRUCTIONS, n_bytes);
+      append_per_byte (out, "branch_misses_per_byte", &counts, COUNTER_BRANCH_MISSES, n_bytes);
+      append_per_byte (out, "cache_misses_per_byte", &counts, COUNTER_CACHE_MISSES, n_bytes);
+
+      if (compare) {
+        expected = g_hash_table_lookup (baseline, key);
+        if (expected == NULL) {
+          g_printerr ("%s: no baseline\n", key);
+          success = FALSE;
+        }
+      }
+
+      if (expected != NULL) {
+        const gboolean passed = per_byte <= *expected * (1 + tolerance);
+
+        n_compared ++;
+        g_string_append_printf (out, ",\"baseline\":%.4f,\"passed\":%s}",
+                                *expected, passed ? "true" : "false");
+        if (!passed) {
+          g_printerr ("%s: %.2f instructions per byte, baseline is %.2f\n", key, per_byte, *expected);
+          success = FALSE;
+        }
+      } else {
+        g_string_append (out, ",\"baseline\":null}");
+      }
+
+      g_free (key);
+    }
+  }
+
+  g_string_append (out, "\n  ]\n}\n");
+  fputs (out->str, stdout);
+
+  if (write_baseline_filename != NULL &&
+      !g_file_set_contents (write_baseline_filename, new_baseline->str, new_baseline->len, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    success = FALSE;
+  }
+
+#ifdef __linux__
+  if (strcmp (backend, "perf") == 0) {
+    perf_close (&perf);
+  }
+#endif
+  if (baseline != NULL) {
+    g_hash_table_unref (baseline);
+  }
+  g_string_free (out, TRUE);
+  g_string_free (new_baseline, TRUE);
+  g_free (valgrind);
+  g_free (baseline_filename);
+  g_free (write_baseline_filename);
+  g_free (baseline_config);
+  g_free (config);
+
+  if (!success) {
+    return 1;
+  }
+
+  // Passing without comparing anything would hide that the gate is off
+  return baseline_filename != NULL && n_compared == 0 ? SKIP_EXIT : 0;
+}
@@ -0,0 +1,202 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times every single call of the public API and reports the latency
+ * distribution per API and corpus class as JSON.
+ *
+ * With --cold, the caches get flushed and the allocator gets trimmed before
+ * every call, so the numbers include everything a call has to pull back in.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+static volatile gsize sink;
+
+typedef struct {
+  char *data;
+  gsize size;
+} Evictor;
+
+static void
+evict (Evictor *evictor)
+{
+  gsize sum = 0;
+  gsize i;
+
+  // Write, so the lines are dirty and the data cache really has to let go
+  for (i = 0; i < evictor->size; i += 64) {
+    evictor->data[i] ++;
+    sum += evictor->data[i];
+  }
+  sink += sum;
+
+#ifdef __GLIBC__
+  malloc_trim (0);
+#endif
+}
+
+static void
+run (Corpus    *corpus,
+     Api        api,
+     guint      n_calls,
+     Evictor   *evictor,
+     Histogram *histogram)
+{
+  gsize result = 0;
+  guint i;
+
+  histogram_init (histogram);
+
+  // Warm up, unless we want it cold anyway
+  if (evictor == NULL) {
+    for (i = 0; i < MIN (n_calls, corpus->n_texts); i ++) {
+      result += api_call (api, corpus->texts[i], corpus->lengths[i]);
+    }
+  }
+
+  for (i = 0; i < n_calls; i ++) {
+    const gsize t = i % corpus->n_texts;
+    guint64 start;
+
+    if (evictor != NULL) {
+      evict (evictor);
+    }
+
+    start = now_ns ();
+    result += api_call (api, corpus->texts[t], corpus->lengths[t]);
+    histogram_record (histogram, now_ns () - start);
+  }
+
+  sink += result;
+}
+
+static void
+append_result (GString         *out,
+               Corpus          *corpus,
+               Api              api,
+               const Histogram *histogram)
+{
+  g_string_append_printf (out,
+                          "    {\"corpus\":\"%s\",\"api\":\"%s\",\"calls\":%" G_GUINT64_FORMAT
+                          ",\"mean_ns\":%.1f,\"min_ns\":%" G_GUINT64_FORMAT
+                          ",\"p50_ns\":%" G_GUINT64_FORMAT ",\"p90_ns\":%" G_GUINT64_FORMAT
+                          ",\"p99_ns\":%" G_GUINT64_FORMAT ",\"p999_ns\":%" G_GUINT64_FORMAT
+                          ",\"max_ns\":%" G_GUINT64_FORMAT "}",
+                          corpus_class_name (corpus->class), api_name (api),
+                          histogram->n_values,
+                          (double)histogram->sum / MAX (histogram->n_values, 1),
+                          histogram->min,
+                          histogram_percentile (histogram, 0.5),
+                          histogram_percentile (histogram, 0.9),
+                          histogram_percentile (histogram, 0.99),
+                          histogram_percentile (histogram, 0.999),
+                          histogram->max);
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean cold = FALSE;
+  int n_calls = 0;
+  int n_texts = 2000;
+  int evict_size_mb = 32;
+  char *corpus_name = NULL;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  Evictor evictor = { NULL, 0 };
+  Histogram *histogram;
+  GString *out;
+  gboolean first = TRUE;
+  guint c;
+  const GOptionEntry entries[] = {
+    { "cold", 0, 0, G_OPTION_ARG_NONE, &cold,
+      "Flush the caches and trim the allocator before every call", NULL },
+    { "calls", 'n', 0, G_OPTION_ARG_INT, &n_calls,
+      "Number of timed calls per corpus and API (default: 100000, 2000 with --cold)", "N" },
+    { "texts", 0, 0, G_OPTION_ARG_INT, &n_texts,
+      "Number of texts to generate per corpus", "N" },
+    { "evict-size", 0, 0, G_OPTION_ARG_INT, &evict_size_mb,
+      "Size of the buffer used to flush the caches, in MB", "MB" },
+    { "corpus", 'c', 0, G_OPTION_ARG_STRING, &corpus_name,
+      "Only run on this corpus class", "NAME" },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("- measure per-call latency distributions");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  if (n_calls <= 0) {
+    n_calls = cold ? 2000 : 100000;
+  }
+
+  if (cold) {
+    evictor.size = (gsize)evict_size_mb * 1024 * 1024;
+    evictor.data = g_malloc0 (evictor.size);
+  }
+
+  histogram = g_new (Histogram, 1);
+  out = g_string_new (NULL);
+  g_string_append_printf (out, "{\n  \"benchmark\":\"latency\",\n  \"cold\":%s,\n"
+                               "  \"results\":[\n", cold ? "true" : "false");
+
+  for (c = 0; c < N_CORPORA; c ++) {
+    Corpus *corpus;
+    guint api;
+
+    if (corpus_name != NULL && g_strcmp0 (corpus_name, corpus_class_name (c)) != 0) {
+      continue;
+    }
+
+    corpus = corpus_new (c, n_texts, 0x5eed + c);
+
+    for (api = 0; api < N_APIS; api ++) {
+      run (corpus, api, n_calls, cold ? &evictor : NULL, histogram);
+
+      if (!first) {
+        g_string_append (out, ",\n");
+      }
+      first = FALSE;
+
+      append_result (out, corpus, api, histogram);
+    }
+
+    corpus_free (corpus);
+  }
+
+  g_string_append (out, "\n  ]\n}\n");
+  fputs (out->str, stdout);
+
+  g_string_free (out, TRUE);
+  g_free (histogram);
+  g_free (evictor.data);
+  g_free (corpus_name);
+
+  return 0;
+}
@@ -0,0 +1,301 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Counts what every API call does to the heap: allocations, reallocations,
+ * bytes requested and the peak of live heap memory during the call, for
+ * inputs from a few bytes up to --max-size, on every corpus class.
+ *
+ * This binary replaces malloc() and friends with counting wrappers around
+ * glibc's internal entry points. libtweetlength's (and GLib's) calls resolve
+ * to them as well, since the executable comes first in symbol lookup. On
+ * other C libraries the benchmark is skipped.
+ */
+
+#include "bench.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc   (size_t size);
+extern void *__libc_calloc   (size_t n, size_t size);
+extern void *__libc_realloc  (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+extern void  __libc_free     (void *ptr);
+
+typedef struct {
+  guint64 n_allocations;
+  guint64 n_reallocations;
+  guint64 n_frees;
+  guint64 bytes_requested;
+  // Usable sizes, so this is what the allocator really handed out
+  gint64 live_bytes;
+  gint64 peak_live_bytes;
+} AllocStats;
+
+// Only the main thread allocates while this is set
+static gboolean tracking;
+static AllocStats alloc_stats;
+
+static inline void
+track_alloc (void  *ptr,
+             size_t size)
+{
+  if (!tracking || ptr == NULL) {
+    return;
+  }
+
+  alloc_stats.n_allocations ++;
+  alloc_stats.bytes_requested += size;
+  alloc_stats.live_bytes += malloc_usable_size (ptr);
+  alloc_stats.peak_live_bytes = MAX (alloc_stats.peak_live_bytes, alloc_stats.live_bytes);
+}
+
+void *
+malloc (size_t size)
+{
+  void *ptr = __libc_malloc (size);
+
+  track_alloc (ptr, size);
+
+  return ptr;
+}
+
+void *
+calloc (size_t n,
+        size_t size)
+{
+  void *ptr = __libc_calloc (n, size);
+
+  track_alloc (ptr, n * size);
+
+  return ptr;
+}
+
+void *
+memalign (size_t alignment,
+          size_t size)
+{
+  void *ptr = __libc_memalign (alignment, size);
+
+  track_alloc (ptr, size);
+
+  return ptr;
+}
+
+void *
+aligned_alloc (size_t alignment,
+               size_t size)
+{
+  return memalign (alignment, size);
+}
+
+int
+posix_memalign (void   **out_ptr,
+                size_t   alignment,
+                size_t   size)
+{
+  void *ptr = memalign (alignment, size);
+
+  if (ptr == NULL) {
+    return ENOMEM;
+  }
+
+  *out_ptr = ptr;
+
+  return 0;
+}
+
+void
+free (void *ptr)
+{
+  if (tracking && ptr != NULL) {
+    alloc_stats.n_frees ++;
+    alloc_stats.live_bytes -= malloc_usable_size (ptr);
+  }
+
+  __libc_free (ptr);
+}
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+  const size_t old_size = ptr != NULL ? malloc_usable_size (ptr) : 0;
+  void *new_ptr;
+
+  if (ptr == NULL) {
+    return malloc (size);
+  }
+
+  new_ptr = __libc_realloc (ptr, size);
+
+  if (tracking) {
+    if (size == 0) {
+      alloc_stats.n_frees ++;
+      alloc_stats.live_bytes -= old_size;
+    } else if (new_ptr != NULL) {
+      alloc_stats.n_reallocations ++;
+      alloc_stats.bytes_requested += size;
+      alloc_stats.live_bytes += (gint64)malloc_usable_size (new_ptr) - (gint64)old_size;
+      alloc_stats.peak_live_bytes = MAX (alloc_stats.peak_live_bytes, alloc_stats.live_bytes);
+    }
+  }
+
+  return new_ptr;
+}
+
+static volatile gsize sink;
+
+// From a few words over a full tweet to long documents
+static const gsize sizes[] = { 16, 32, 64, 140, 280, 1024, 4096, 16384, 65536, 262144, 1048576 };
+
+/* Corpus texts joined by spaces, cut to @size bytes on a character boundary */
+static GString *
+make_input (const Corpus *corpus,
+            gsize         size)
+{
+  GString *s = g_string_new (NULL);
+  gsize i = 0;
+
+  while (s->len < size) {
+    if (s->len > 0) {
+      g_string_append_c (s, ' ');
+    }
+    g_string_append_len (s, corpus->texts[i % corpus->n_texts], corpus->lengths[i % corpus->n_texts]);
+    i ++;
+  }
+
+  while (size > 0 && (s->str[size] & 0xC0) == 0x80) {
+    size --;
+  }
+  g_string_truncate (s, size);
+
+  return s;
+}
+
+static void
+run (const Corpus *corpus,
+     Api           api,
+     const GString *input,
+     GString       *out)
+{
+  // Warm up, so one-time allocations (e.g. GLib's or the stats block) don't count
+  sink += api_call (api, input->str, input->len);
+
+  memset (&alloc_stats, 0, sizeof (AllocStats));
+  tracking = TRUE;
+  sink += api_call (api, input->str, input->len);
+  tracking = FALSE;
+
+  g_string_append_printf (out,
+                          "    {\"corpus\":\"%s\",\"api\":\"%s\",\"bytes\":%" G_GSIZE_FORMAT
+                          ",\"allocations\":%" G_GUINT64_FORMAT ",\"reallocations\":%" G_GUINT64_FORMAT
+                          ",\"frees\":%" G_GUINT64_FORMAT ",\"bytes_allocated\":%" G_GUINT64_FORMAT
+                          ",\"peak_live_bytes\":%" G_GINT64_FORMAT ",\"leaked_bytes\":%" G_GINT64_FORMAT "}",
+                          corpus_class_name (corpus->class), api_name (api), input->len,
+                          alloc_stats.n_allocations, alloc_stats.n_reallocations,
+                          alloc_stats.n_frees, alloc_stats.bytes_requested,
+                          alloc_stats.peak_live_bytes, alloc_stats.live_bytes);
+}
+
+int
+main (int argc, char **argv)
+{
+  int max_size = 64 * 1024;
+  char *corpus_name = NULL;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  GString *out;
+  gboolean first = TRUE;
+  guint c;
+  const GOptionEntry entries[] = {
+    { "max-size", 's', 0, G_OPTION_ARG_INT, &max_size,
+      "Largest input size, in bytes", "BYTES" },
+    { "corpus", 'c', 0, G_OPTION_ARG_STRING, &corpus_name,
+      "Only run on this corpus class", "NAME" },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("- measure heap usage per call");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  out = g_string_new ("{\n  \"benchmark\":\"memory\",\n  \"results\":[\n");
+
+  for (c = 0; c < N_CORPORA; c ++) {
+    Corpus *corpus;
+    guint s;
+    guint api;
+
+    if (corpus_name != NULL && g_strcmp0 (corpus_name, corpus_class_name (c)) != 0) {
+      continue;
+    }
+
+    corpus = corpus_new (c, 200, 0x5eed + c);
+
+    for (s = 0; s < G_N_ELEMENTS (sizes) && sizes[s] <= (gsize)max_size; s ++) {
+      GString *input = make_input (corpus, sizes[s]);
+
+      for (api = 0; api < N_APIS; api ++) {
+        if (!first) {
+          g_string_append (out, ",\n");
+        }
+        first = FALSE;
+
+        run (corpus, api, input, out);
+      }
+
+      g_string_free (input, TRUE);
+    }
+
+    corpus_free (corpus);
+  }
+
+  g_string_append (out, "\n  ]\n}\n");
+  fputs (out->str, stdout);
+
+  g_string_free (out, TRUE);
+  g_free (corpus_name);
+
+  return 0;
+}
+
+#else
+
+int
+main (int argc, char **argv)
+{
+  g_printerr ("Needs glibc to replace malloc()\n");
+
+  // Skipped
+  return 77;
+}
+
+#endif
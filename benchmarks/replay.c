@@ -0,0 +1,192 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Replays the slow inputs the fuzzers found (fuzz/slow/), once as they are
+ * and once repeated up to --size bytes, and prints the time per byte for
+ * each API as JSON. Minimized inputs are tiny, the repeated run is what shows
+ * whether they still blow up on tweet-sized or larger text.
+ *
+ * With -Dstats=true, the work per byte (token visits plus TLD lookups, the
+ * same measure the fuzzers use) is reported as well.
+ */
+
+#include "bench.h"
+#include "tl-stats.h"
+#include <stdio.h>
+#include <string.h>
+
+static volatile gsize sink;
+
+static int
+compare_names (gconstpointer a,
+               gconstpointer b)
+{
+  return strcmp (*(const char * const *)a, *(const char * const *)b);
+}
+
+static void
+run (const char *name,
+     const char *text,
+     gsize       length,
+     Api         api,
+     double      min_seconds,
+     GString    *out)
+{
+  const guint64 min_ns = min_seconds * 1e9;
+  guint64 n_calls = 0;
+  guint64 start;
+  guint64 elapsed;
+  gsize result = 0;
+  TlStats stats;
+  gboolean have_stats;
+
+  tl_stats_reset ();
+  result += api_call (api, text, length);
+  have_stats = tl_stats_get (&stats);
+
+  start = now_ns ();
+  do {
+    result += api_call (api, text, length);
+    n_calls ++;
+    elapsed = now_ns () - start;
+  } while (elapsed < min_ns);
+
+  sink += result;
+
+  g_string_append_printf (out,
+                          "    {\"input\":\"%s\",\"api\":\"%s\",\"bytes\":%" G_GSIZE_FORMAT
+                          ",\"calls\":%" G_GUINT64_FORMAT ",\"ns_per_call\":%.1f,\"ns_per_byte\":%.3f",
+                          name, api_name (api), length, n_calls,
+                          (double)elapsed / n_calls,
+                          (double)elapsed / n_calls / MAX (length, 1));
+  if (have_stats) {
+    g_string_append_printf (out, ",\"work_per_byte\":%.3f",
+                            (double)(stats.n_token_visits + stats.n_tld_lookups) / MAX (length, 1));
+  }
+  g_string_append (out, "}");
+}
+
+int
+main (int argc, char **argv)
+{
+  double min_seconds = 0.2;
+  int size = 4096;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  GPtrArray *names;
+  GString *out;
+  GDir *dir;
+  const char *name;
+  gboolean first = TRUE;
+  guint i;
+  const GOptionEntry entries[] = {
+    { "time", 't', 0, G_OPTION_ARG_DOUBLE, &min_seconds,
+      "Minimum time per input and API, in seconds", "SECONDS" },
+    { "size", 's', 0, G_OPTION_ARG_INT, &size,
+      "Size to repeat each input up to, in bytes", "BYTES" },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("DIRECTORY - replay slow inputs found by the fuzzers");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s [OPTION...] DIRECTORY\n", argv[0]);
+    return 1;
+  }
+
+  dir = g_dir_open (argv[1], 0, &error);
+  if (dir == NULL) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+
+  names = g_ptr_array_new_with_free_func (g_free);
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    g_ptr_array_add (names, g_strdup (name));
+  }
+  g_dir_close (dir);
+  g_ptr_array_sort (names, compare_names);
+
+  out = g_string_new (NULL);
+  g_string_append_printf (out, "{\n  \"benchmark\":\"replay\",\n  \"size\":%d,\n  \"results\":[\n", size);
+
+  for (i = 0; i < names->len; i ++) {
+    char *path = g_build_filename (argv[1], names->pdata[i], NULL);
+    char *repeated_name;
+    GString *repeated;
+    char *contents;
+    gsize length;
+    guint api;
+
+    if (!g_file_get_contents (path, &contents, &length, &error)) {
+      g_printerr ("%s\n", error->message);
+      g_clear_error (&error);
+      g_free (path);
+      continue;
+    }
+    g_free (path);
+
+    if (length == 0) {
+      g_free (contents);
+      continue;
+    }
+
+    repeated = g_string_new (NULL);
+    while (repeated->len + length <= (gsize)size) {
+      g_string_append_len (repeated, contents, length);
+    }
+    repeated_name = g_strdup_printf ("%s*%" G_GSIZE_FORMAT, (const char *)names->pdata[i],
+                                     repeated->len / length);
+
+    for (api = 0; api < N_APIS; api ++) {
+      if (!first) {
+        g_string_append (out, ",\n");
+      }
+      first = FALSE;
+
+      run (names->pdata[i], contents, length, api, min_seconds, out);
+
+      if (repeated->len > length) {
+        g_string_append (out, ",\n");
+        run (repeated_name, repeated->str, repeated->len, api, min_seconds, out);
+      }
+    }
+
+    g_free (repeated_name);
+    g_string_free (repeated, TRUE);
+    g_free (contents);
+  }
+
+  g_string_append (out, "\n  ]\n}\n");
+  fputs (out->str, stdout);
+
+  g_string_free (out, TRUE);
+  g_ptr_array_unref (names);
+
+  return 0;
+}
@@ -0,0 +1,289 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs the public API on single inputs growing from 1 KB up to 64 MB, for
+ * patterns that stress the code paths most likely to go super-linear. A line
+ * is fitted through log(time) over log(size); its slope is the growth
+ * exponent, which should be ~1. Cache and page fault effects at the big sizes
+ * add a bit on top, anything quadratic lands near 2. Fails if any exponent
+ * exceeds --threshold.
+ */
+
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MIN_SIZE          1024
+#define GROWTH            4
+// Small inputs get repeated until one measurement takes at least this long
+#define MIN_SAMPLE_NS     (20 * 1000 * 1000)
+// Sizes below this are too noisy to fit
+#define MIN_FIT_SIZE      (16 * 1024)
+
+typedef void (*PatternFunc) (GString *s, gsize size);
+
+static volatile gsize sink;
+
+static void
+repeat (GString    *s,
+        gsize       size,
+        const char *unit)
+{
+  const gsize unit_length = strlen (unit);
+
+  while (s->len + unit_length <= size) {
+    g_string_append_len (s, unit, unit_length);
+  }
+}
+
+static void
+pattern_dots (GString *s,
+              gsize    size)
+{
+  repeat (s, size, "a.");
+}
+
+static void
+pattern_http (GString *s,
+              gsize    size)
+{
+  repeat (s, size, "http://");
+}
+
+// parse_link_tail() balances parentheses in the path
+static void
+pattern_parens (GString *s,
+                gsize    size)
+{
+  gsize depth;
+
+  g_string_append (s, "https://example.com/");
+  depth = (size - s->len) / 2;
+  while (s->len < 20 + depth) {
+    g_string_append_c (s, '(');
+  }
+  while (s->len < size) {
+    g_string_append_c (s, ')');
+  }
+}
+
+static void
+pattern_mentions (GString *s,
+                  gsize    size)
+{
+  repeat (s, size, "@");
+}
+
+static void
+pattern_hashtags (GString *s,
+                  gsize    size)
+{
+  repeat (s, size, "#");
+}
+
+// Long non-ASCII words; token_ends_in_accented() walks the whole word before a mention
+static void
+pattern_accented (GString *s,
+                  gsize    size)
+{
+  GString *unit = g_string_new (NULL);
+
+  while (unit->len < 256) {
+    g_string_append (unit, "\xC3\xA9");
+  }
+  g_string_append (unit, "@a ");
+
+  repeat (s, size, unit->str);
+  g_string_free (unit, TRUE);
+}
+
+static const struct {
+  const char *name;
+  PatternFunc func;
+} patterns[] = {
+  { "dots",     pattern_dots },
+  { "http",     pattern_http },
+  { "parens",   pattern_parens },
+  { "mentions", pattern_mentions },
+  { "hashtags", pattern_hashtags },
+  { "accented", pattern_accented },
+};
+
+// Returns the time of one call, in seconds
+static double
+measure (Api         api,
+         const char *text,
+         gsize       length)
+{
+  const guint64 start = now_ns ();
+  guint64 elapsed;
+  guint n_calls = 0;
+  gsize result = 0;
+
+  do {
+    result += api_call (api, text, length);
+    n_calls ++;
+    elapsed = now_ns () - start;
+  } while (elapsed < MIN_SAMPLE_NS && length < MIN_FIT_SIZE * GROWTH);
+
+  sink += result;
+
+  return elapsed / 1e9 / n_calls;
+}
+
+// Least-squares slope of log(seconds) over log(bytes)
+static double
+fit_exponent (const double *sizes,
+              const double *seconds,
+              guint         n)
+{
+  double mean_x = 0, mean_y = 0;
+  double sxx = 0, sxy = 0;
+  guint i;
+
+  for (i = 0; i < n; i ++) {
+    mean_x += log (sizes[i]);
+    mean_y += log (seconds[i]);
+  }
+  mean_x /= n;
+  mean_y /= n;
+
+  for (i = 0; i < n; i ++) {
+    const double dx = log (sizes[i]) - mean_x;
+
+    sxx += dx * dx;
+    sxy += dx * (log (seconds[i]) - mean_y);
+  }
+
+  return sxx > 0 ? sxy / sxx : 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  double threshold = 1.5;
+  double budget = 2.0;
+  int max_size_mb = 64;
+  char *pattern_name = NULL;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  GString *out;
+  GString *text;
+  gboolean first = TRUE;
+  gboolean success = TRUE;
+  guint p;
+  const GOptionEntry entries[] = {
+    { "threshold", 'e', 0, G_OPTION_ARG_DOUBLE, &threshold,
+      "Fail if any growth exponent is above this", "EXPONENT" },
+    { "budget", 'b', 0, G_OPTION_ARG_DOUBLE, &budget,
+      "Stop growing an input once one call takes longer than this", "SECONDS" },
+    { "max-size", 'm', 0, G_OPTION_ARG_INT, &max_size_mb,
+      "Largest input size, in MB", "MB" },
+    { "pattern", 'p', 0, G_OPTION_ARG_STRING, &pattern_name,
+      "Only run this pattern", "NAME" },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("- check that input size scales linearly");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  out = g_string_new (NULL);
+  g_string_append_printf (out, "{\n  \"benchmark\":\"scaling\",\n  \"threshold\":%.2f,\n"
+                               "  \"results\":[\n", threshold);
+  text = g_string_new (NULL);
+
+  for (p = 0; p < G_N_ELEMENTS (patterns); p ++) {
+    guint api;
+
+    if (pattern_name != NULL && g_strcmp0 (pattern_name, patterns[p].name) != 0) {
+      continue;
+    }
+
+    for (api = 0; api < N_APIS; api ++) {
+      double sizes[32];
+      double seconds[32];
+      guint n_points = 0;
+      guint n_fit = 0;
+      double exponent;
+      gboolean passed;
+      gsize size;
+      guint i;
+
+      for (size = MIN_SIZE; size <= (gsize)max_size_mb * 1024 * 1024; size *= GROWTH) {
+        g_string_truncate (text, 0);
+        patterns[p].func (text, size);
+
+        sizes[n_points] = text->len;
+        seconds[n_points] = measure (api, text->str, text->len);
+        n_points ++;
+
+        // Anything growing this fast already made its point
+        if (seconds[n_points - 1] > budget) {
+          break;
+        }
+      }
+
+      for (i = 0; i < n_points; i ++) {
+        if (sizes[i] >= MIN_FIT_SIZE) {
+          break;
+        }
+      }
+      n_fit = n_points - i;
+      exponent = n_fit >= 2 ? fit_exponent (sizes + i, seconds + i, n_fit) : 0;
+      passed = exponent <= threshold;
+      success = success && passed;
+
+      if (!first) {
+        g_string_append (out, ",\n");
+      }
+      first = FALSE;
+
+      g_string_append_printf (out, "    {\"pattern\":\"%s\",\"api\":\"%s\",\"exponent\":%.3f,"
+                                   "\"passed\":%s,\"points\":[",
+                              patterns[p].name, api_name (api), exponent,
+                              passed ? "true" : "false");
+      for (i = 0; i < n_points; i ++) {
+        g_string_append_printf (out, "%s{\"bytes\":%.0f,\"seconds\":%.9f}",
+                                i > 0 ? "," : "", sizes[i], seconds[i]);
+      }
+      g_string_append (out, "]}");
+
+      if (!passed) {
+        g_printerr ("%s/%s grows with exponent %.2f (threshold %.2f)\n",
+                    patterns[p].name, api_name (api), exponent, threshold);
+      }
+    }
+  }
+
+  g_string_append (out, "\n  ]\n}\n");
+  fputs (out->str, stdout);
+
+  g_string_free (out, TRUE);
+  g_string_free (text, TRUE);
+  g_free (pattern_name);
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures MB/s and tweets/s of the public API on each generated corpus class
+ * and prints the results as one JSON object. "count_characters_batch" counts
+ * the whole corpus with one tl_count_characters_batch() call per pass.
+ *
+ * With --compare, it first runs another build of itself (e.g. one linked
+ * against a library built without -Dpgo=true) with the same options, and adds
+ * that build's MB/s and the speedup over it to every result.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+
+static volatile gsize sink;
+
+/* Not one of bench.h's APIs, since those take one text per call */
+#define API_COUNT_BATCH N_APIS
+
+/* One pass of @api over all of @corpus. @lengths has room for every text. */
+static gsize
+run_pass (const Corpus *corpus,
+          guint         api,
+          gsize        *lengths)
+{
+  gsize result = 0;
+  gsize i;
+
+  if (api == API_COUNT_BATCH) {
+    tl_count_characters_batch (corpus->texts, corpus->lengths, corpus->n_texts, lengths);
+    for (i = 0; i < corpus->n_texts; i ++) {
+      result += lengths[i];
+    }
+  } else {
+    for (i = 0; i < corpus->n_texts; i ++) {
+      result += api_call (api, corpus->texts[i], corpus->lengths[i]);
+    }
+  }
+
+  return result;
+}
+
+static void
+run (Corpus     *corpus,
+     guint       api,
+     double      min_seconds,
+     GHashTable *baseline,
+     GString    *out)
+{
+  const char *name = api == API_COUNT_BATCH ? "count_characters_batch" : api_name (api);
+  const double *baseline_mb_per_s;
+  const guint64 min_ns = min_seconds * 1e9;
+  guint64 start;
+  guint64 elapsed;
+  guint64 n_texts = 0;
+  guint64 n_bytes = 0;
+  gsize *lengths = g_new (gsize, corpus->n_texts);
+  gsize result = 0;
+  double seconds;
+  double mb_per_s;
+  char *key;
+
+  // One pass to warm up caches and the allocator
+  result += run_pass (corpus, api, lengths);
+
+  start = now_ns ();
+  do {
+    result += run_pass (corpus, api, lengths);
+    n_texts += corpus->n_texts;
+    n_bytes += corpus->n_bytes;
+    elapsed = now_ns () - start;
+  } while (elapsed < min_ns);
+
+  sink += result;
+  g_free (lengths);
+  seconds = elapsed / 1e9;
+  mb_per_s = n_bytes / seconds / (1024.0 * 1024.0);
+
+  g_string_append_printf (out,
+                          "    {\"corpus\":\"%s\",\"api\":\"%s\",\"texts\":%" G_GUINT64_FORMAT
+                          ",\"bytes\":%" G_GUINT64_FORMAT ",\"seconds\":%.6f"
+                          ",\"mb_per_s\":%.3f,\"tweets_per_s\":%.1f",
+                          corpus_class_name (corpus->class), name,
+                          n_texts, n_bytes, seconds,
+                          mb_per_s,
+                          n_texts / seconds);
+
+  key = g_strdup_printf ("%s %s", corpus_class_name (corpus->class), name);
+  baseline_mb_per_s = baseline != NULL ? g_hash_table_lookup (baseline, key) : NULL;
+  if (baseline_mb_per_s != NULL) {
+    g_string_append_printf (out, ",\"baseline_mb_per_s\":%.3f,\"speedup\":%.3f",
+                            *baseline_mb_per_s, mb_per_s / *baseline_mb_per_s);
+  }
+  g_free (key);
+
+  g_string_append_c (out, '}');
+}
+
+/* The string value of @name in the one-line JSON object @line, copied */
+static char *
+json_get_string (const char *line,
+                 const char *name)
+{
+  char *pattern = g_strdup_printf ("\"%s\":\"", name);
+  const char *start = strstr (line, pattern);
+  const char *end;
+
+  start = start != NULL ? start + strlen (pattern) : NULL;
+  end = start != NULL ? strchr (start, '"') : NULL;
+  g_free (pattern);
+
+  return end != NULL ? g_strndup (start, end - start) : NULL;
+}
+
+static gboolean
+json_get_number (const char *line,
+                 const char *name,
+                 double     *out_value)
+{
+  char *pattern = g_strdup_printf ("\"%s\":", name);
+  const char *start = strstr (line, pattern);
+
+  if (start != NULL) {
+    *out_value = g_ascii_strtod (start + strlen (pattern), NULL);
+  }
+  g_free (pattern);
+
+  return start != NULL;
+}
+
+/*
+ * Runs @exe with the same options and returns its MB/s per "corpus api",
+ * read back from the results it prints, one per line.
+ */
+static GHashTable *
+run_baseline (const char  *exe,
+              double       min_seconds,
+              int          n_texts,
+              const char  *corpus_name,
+              GError     **error)
+{
+  char time_arg[G_ASCII_DTOSTR_BUF_SIZE];
+  char *texts_arg = g_strdup_printf ("%d", n_texts);
+  char *argv[] = {
+    (char *)exe, "--time", g_ascii_dtostr (time_arg, sizeof (time_arg), min_seconds),
+    "--texts", texts_arg, corpus_name != NULL ? "--corpus" : NULL, (char *)corpus_name, NULL
+  };
+  char *child_stdout = NULL;
+  GHashTable *baseline;
+  char **lines;
+  int status;
+  gboolean success;
+  guint i;
+
+  success = g_spawn_sync (NULL, argv, NULL, G_SPAWN_DEFAULT, NULL, NULL,
+                          &child_stdout, NULL, &status, error) &&
+            g_spawn_check_exit_status (status, error);
+
+  g_free (texts_arg);
+
+  if (!success) {
+    g_free (child_stdout);
+    return NULL;
+  }
+
+  baseline = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  lines = g_strsplit (child_stdout, "\n", -1);
+  for (i = 0; lines[i] != NULL; i ++) {
+    char *corpus = json_get_string (lines[i], "corpus");
+    char *api = json_get_string (lines[i], "api");
+    double *mb_per_s = g_new (double, 1);
+
+    if (corpus != NULL && api != NULL && json_get_number (lines[i], "mb_per_s", mb_per_s)) {
+      g_hash_table_insert (baseline, g_strdup_printf ("%s %s", corpus, api), mb_per_s);
+    } else {
+      g_free (mb_per_s);
+    }
+    g_free (corpus);
+    g_free (api);
+  }
+
+  g_strfreev (lines);
+  g_free (child_stdout);
+
+  return baseline;
+}
+
+int
+main (int argc, char **argv)
+{
+  double min_seconds = 0.5;
+  int n_texts = 2000;
+  char *corpus_name = NULL;
+  char *output_filename = NULL;
+  char *compare_exe = NULL;
+  GHashTable *baseline = NULL;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  GString *out;
+  gboolean first = TRUE;
+  guint c;
+  const GOptionEntry entries[] = {
+    { "time", 't', 0, G_OPTION_ARG_DOUBLE, &min_seconds,
+      "Minimum time to spend per corpus and API, in seconds", "SECONDS" },
+    { "texts", 'n', 0, G_OPTION_ARG_INT, &n_texts,
+      "Number of texts to generate per corpus", "N" },
+    { "corpus", 'c', 0, G_OPTION_ARG_STRING, &corpus_name,
+      "Only run on this corpus class", "NAME" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_filename,
+      "Write the results to this file instead of stdout", "FILE" },
+    { "compare", 0, 0, G_OPTION_ARG_FILENAME, &compare_exe,
+      "Also run this build of the benchmark and report the speedup over it", "EXE" },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("- measure tweet counting throughput");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  if (compare_exe != NULL) {
+    baseline = run_baseline (compare_exe, min_seconds, n_texts, corpus_name, &error);
+    if (baseline == NULL) {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+  }
+
+  out = g_string_new ("{\n  \"benchmark\":\"throughput\",\n  \"results\":[\n");
+
+  for (c = 0; c < N_CORPORA; c ++) {
+    Corpus *corpus;
+    guint api;
+
+    if (corpus_name != NULL && g_strcmp0 (corpus_name, corpus_class_name (c)) != 0) {
+      continue;
+    }
+
+    // Long documents are ~20 times the size of a tweet
+    corpus = corpus_new (c, c == CORPUS_LONG ? MAX (n_texts / 20, 1) : n_texts, 0x5eed + c);
+
+    for (api = 0; api <= API_COUNT_BATCH; api ++) {
+      if (!first) {
+        g_string_append (out, ",\n");
+      }
+      first = FALSE;
+
+      run (corpus, api, min_seconds, baseline, out);
+    }
+
+    corpus_free (corpus);
+  }
+
+  g_string_append (out, "\n  ]\n}\n");
+
+  if (output_filename != NULL) {
+    if (!g_file_set_contents (output_filename, out->str, out->len, &error)) {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+  } else {
+    fputs (out->str, stdout);
+  }
+
+  g_string_free (out, TRUE);
+  g_clear_pointer (&baseline, g_hash_table_unref);
+  g_free (corpus_name);
+  g_free (output_filename);
+  g_free (compare_exe);
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fuzz.h"
+#include "tl-corpus.h"
+#include <string.h>
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  FuzzInput input;
+  TlCorpusStats stats;
+  guint64 n_records = 0;
+  guint64 n_characters = 0;
+  const char *p;
+  const char *end;
+
+  fuzz_input_init (&input, data, size);
+
+  // One worker, fuzzers don't like threads
+  fuzz_work_start ();
+  tl_corpus_scan (input.text, input.length, 1, NULL, NULL, &stats);
+  fuzz_work_check ("tl_corpus_scan", input.length);
+
+  if (input.valid_utf8) {
+    p = input.text;
+    end = input.text + input.length;
+    while (p < end) {
+      const char *newline = memchr (p, '\n', end - p);
+      const char *record_end = newline != NULL ? newline : end;
+      gsize record_length = record_end - p;
+
+      if (record_length > 0 && record_end[-1] == '\r') {
+        record_length --;
+      }
+
+      n_records ++;
+      n_characters += tl_count_characters_n (p, record_length);
+      p = record_end + 1;
+    }
+
+    g_assert_cmpuint (stats.n_records, ==, n_records);
+    g_assert_cmpuint (stats.n_characters, ==, n_characters);
+    g_assert_cmpuint (stats.n_skipped, ==, 0);
+    g_assert_cmpuint (stats.n_bytes, <=, input.length);
+  }
+
+  fuzz_input_clear (&input);
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fuzz.h"
+#include <string.h>
+
+#define MAX_BATCH 40
+
+/* Every line of @input on its own, counted in one batch and one by one */
+static void
+check_batch (const FuzzInput *input)
+{
+  FuzzInput lines[MAX_BATCH];
+  const char *texts[MAX_BATCH];
+  gsize lengths[MAX_BATCH];
+  gsize out[MAX_BATCH];
+  const char *p = input->text;
+  const char *end = input->text + input->length;
+  guint n = 0;
+  guint i;
+
+  while (n < MAX_BATCH && p < end) {
+    const char *nl = memchr (p, '\n', end - p);
+    const char *line_end = nl != NULL ? nl : end;
+
+    fuzz_input_init (&lines[n], (const uint8_t *)p, line_end - p);
+    texts[n] = lines[n].text;
+    lengths[n] = lines[n].length;
+    n ++;
+    p = line_end + 1;
+  }
+
+  tl_count_characters_batch (texts, lengths, n, out);
+
+  for (i = 0; i < n; i ++) {
+    g_assert_cmpuint (out[i], ==, tl_count_characters_n (texts[i], lengths[i]));
+    fuzz_input_clear (&lines[i]);
+  }
+}
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  FuzzInput input;
+  gboolean has_nul;
+  char *text;
+  gsize length;
+
+  fuzz_input_init (&input, data, size);
+
+  fuzz_work_start ();
+  length = tl_count_characters_n (input.text, input.length);
+  fuzz_work_check ("tl_count_characters_n", input.length);
+
+  text = fuzz_input_dup_nul (&input, &has_nul);
+  fuzz_work_start ();
+  if (has_nul) {
+    tl_count_characters (text);
+  } else {
+    g_assert_cmpuint (tl_count_characters (text), ==, length);
+  }
+  fuzz_work_check ("tl_count_characters", strlen (text));
+
+  g_free (text);
+
+  check_batch (&input);
+  fuzz_input_clear (&input);
+
+  return 0;
+}
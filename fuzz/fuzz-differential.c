@@ -0,0 +1,73 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Differential target, the library has to agree with the reference engine on
+ * every valid input. tests/differential.c does the same without a fuzzer.
+ */
+
+#include "fuzz.h"
+#include "tl-reference.h"
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  FuzzInput input;
+  int extract_text;
+
+  fuzz_input_init (&input, data, size);
+
+  // Only valid UTF-8 has a defined result
+  if (!input.valid_utf8) {
+    fuzz_input_clear (&input);
+    return 0;
+  }
+
+  g_assert_cmpuint (tl_count_characters_n (input.text, input.length), ==,
+                    tl_reference_count_characters_n (input.text, input.length));
+
+  for (extract_text = 0; extract_text <= 1; extract_text ++) {
+    TlEntity *expected;
+    TlEntity *actual;
+    gsize n_expected;
+    gsize n_actual;
+    gsize expected_length;
+    gsize actual_length;
+
+    expected = tl_reference_extract_entities_n (input.text, input.length, extract_text,
+                                                &n_expected, &expected_length);
+    if (extract_text) {
+      actual = tl_extract_entities_and_text_n (input.text, input.length, &n_actual, &actual_length);
+    } else {
+      actual = tl_extract_entities_n (input.text, input.length, &n_actual, &actual_length);
+    }
+
+    g_assert_cmpuint (actual_length, ==, expected_length);
+    fuzz_check_same (extract_text ? "tl_extract_entities_and_text_n" : "tl_extract_entities_n",
+                     actual, n_actual, input.text,
+                     expected, n_expected, input.text);
+
+    g_free (actual);
+    g_free (expected);
+  }
+
+  fuzz_input_clear (&input);
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fuzz.h"
+#include <string.h>
+
+typedef TlEntity * (* ExtractFunc)   (const char *input,
+                                      gsize      *out_n_entities,
+                                      gsize      *out_text_length);
+typedef TlEntity * (* ExtractNFunc)  (const char *input,
+                                      gsize       length_in_bytes,
+                                      gsize      *out_n_entities,
+                                      gsize      *out_text_length);
+
+static void
+check_api (const FuzzInput *input,
+           const char      *nul_text,
+           gboolean         has_nul,
+           gsize            length,
+           const char      *name,
+           ExtractNFunc     extract_n,
+           const char      *nul_name,
+           ExtractFunc      extract)
+{
+  TlEntity *entities;
+  TlEntity *nul_entities;
+  gsize n_entities;
+  gsize n_nul_entities;
+  gsize text_length;
+  gsize nul_text_length;
+
+  fuzz_work_start ();
+  entities = extract_n (input->text, input->length, &n_entities, &text_length);
+  fuzz_work_check (name, input->length);
+
+  g_assert ((entities == NULL) == (n_entities == 0));
+  g_assert_cmpuint (text_length, ==, length);
+  fuzz_check_entities (input, entities, n_entities);
+
+  fuzz_work_start ();
+  nul_entities = extract (nul_text, &n_nul_entities, &nul_text_length);
+  fuzz_work_check (nul_name, strlen (nul_text));
+
+  if (!has_nul) {
+    g_assert_cmpuint (nul_text_length, ==, text_length);
+    fuzz_check_same (nul_name,
+                     entities, n_entities, input->text,
+                     nul_entities, n_nul_entities, nul_text);
+  }
+
+  g_free (nul_entities);
+  g_free (entities);
+}
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  FuzzInput input;
+  gboolean has_nul;
+  char *text;
+  gsize length;
+
+  fuzz_input_init (&input, data, size);
+  text = fuzz_input_dup_nul (&input, &has_nul);
+  length = tl_count_characters_n (input.text, input.length);
+
+  check_api (&input, text, has_nul, length,
+             "tl_extract_entities_n", tl_extract_entities_n,
+             "tl_extract_entities", tl_extract_entities);
+  check_api (&input, text, has_nul, length,
+             "tl_extract_entities_and_text_n", tl_extract_entities_and_text_n,
+             "tl_extract_entities_and_text", tl_extract_entities_and_text);
+
+  g_free (text);
+  fuzz_input_clear (&input);
+
+  return 0;
+}
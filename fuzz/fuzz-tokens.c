@@ -0,0 +1,63 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fuzz.h"
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  FuzzInput input;
+  TlTokens *tokens;
+  TlEntity *entities;
+  TlEntity *staged_entities;
+  gsize n_entities;
+  gsize n_staged_entities;
+  gsize text_length;
+  gsize staged_text_length;
+
+  fuzz_input_init (&input, data, size);
+
+  fuzz_work_start ();
+  tokens = tl_tokenize_n (input.text, input.length);
+  staged_entities = tl_tokens_extract_entities (tokens, &n_staged_entities, &staged_text_length);
+  fuzz_work_check ("tl_tokenize_n + tl_tokens_extract_entities", input.length);
+
+  fuzz_check_entities (&input, staged_entities, n_staged_entities);
+
+  // Extracting twice from the same tokens gives the same result
+  entities = tl_tokens_extract_entities (tokens, &n_entities, &text_length);
+  g_assert_cmpuint (text_length, ==, staged_text_length);
+  fuzz_check_same ("tl_tokens_extract_entities",
+                   entities, n_entities, input.text,
+                   staged_entities, n_staged_entities, input.text);
+  g_free (entities);
+  tl_tokens_free (tokens);
+
+  entities = tl_extract_entities_n (input.text, input.length, &n_entities, &text_length);
+  g_assert_cmpuint (text_length, ==, staged_text_length);
+  fuzz_check_same ("tl_tokens_extract_entities",
+                   entities, n_entities, input.text,
+                   staged_entities, n_staged_entities, input.text);
+
+  g_free (entities);
+  g_free (staged_entities);
+  fuzz_input_clear (&input);
+
+  return 0;
+}
@@ -0,0 +1,170 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fuzz.h"
+#include "tl-stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INVALID_UTF8_PADDING 8
+#define WORK_SLACK           64
+
+void
+fuzz_input_init (FuzzInput     *input,
+                 const uint8_t *data,
+                 size_t         size)
+{
+  input->valid_utf8 = g_utf8_validate ((const char *)data, size, NULL);
+  input->length = size;
+
+  if (input->valid_utf8) {
+    // Exactly @size bytes, malloc(0) might give us NULL
+    input->text = g_malloc (MAX (size, 1));
+  } else {
+    input->text = g_malloc0 (size + INVALID_UTF8_PADDING);
+  }
+
+  memcpy (input->text, data, size);
+}
+
+void
+fuzz_input_clear (FuzzInput *input)
+{
+  g_clear_pointer (&input->text, g_free);
+}
+
+char *
+fuzz_input_dup_nul (const FuzzInput *input,
+                    gboolean        *out_has_nul)
+{
+  const char *nul = memchr (input->text, '\0', input->length);
+  const gsize length = nul != NULL ? (gsize)(nul - input->text) : input->length;
+  char *text;
+
+  *out_has_nul = nul != NULL;
+
+  text = g_malloc0 (length + (input->valid_utf8 ? 1 : INVALID_UTF8_PADDING));
+  memcpy (text, input->text, length);
+
+  return text;
+}
+
+static guint64
+work_per_byte (void)
+{
+  static guint64 limit;
+
+  if (limit == 0) {
+    const char *env = g_getenv ("TL_FUZZ_WORK_PER_BYTE");
+
+    limit = env != NULL ? g_ascii_strtoull (env, NULL, 10) : 0;
+    if (limit == 0) {
+      limit = 16;
+    }
+  }
+
+  return limit;
+}
+
+void
+fuzz_work_start (void)
+{
+  tl_stats_reset ();
+}
+
+void
+fuzz_work_check (const char *what,
+                 gsize       length_in_bytes)
+{
+  TlStats stats;
+  guint64 work;
+
+  // Built without -Dstats=true, nothing to check
+  if (!tl_stats_get (&stats)) {
+    return;
+  }
+
+  work = stats.n_token_visits + stats.n_tld_lookups;
+  if (work > work_per_byte () * length_in_bytes + WORK_SLACK) {
+    fprintf (stderr, "Slow input: %s did %" G_GUINT64_FORMAT " units of work "
+                     "(%" G_GUINT64_FORMAT " token visits, %" G_GUINT64_FORMAT " TLD lookups) "
+                     "for %" G_GSIZE_FORMAT " bytes\n",
+             what, work, stats.n_token_visits, stats.n_tld_lookups, length_in_bytes);
+    abort ();
+  }
+}
+
+void
+fuzz_check_entities (const FuzzInput *input,
+                     const TlEntity  *entities,
+                     gsize            n_entities)
+{
+  gsize n_characters;
+  gsize i;
+
+  // Out-of-contract input, only crashes and slowness count
+  if (!input->valid_utf8) {
+    return;
+  }
+
+  n_characters = g_utf8_strlen (input->text, input->length);
+
+  for (i = 0; i < n_entities; i ++) {
+    const TlEntity *e = &entities[i];
+
+    g_assert_cmpuint (e->type, >=, TL_ENT_TEXT);
+    g_assert_cmpuint (e->type, <=, TL_ENT_WHITESPACE);
+    g_assert (e->start >= input->text);
+    g_assert_cmpuint (e->length_in_bytes, >, 0);
+    g_assert_cmpuint (e->start - input->text + e->length_in_bytes, <=, input->length);
+    g_assert_cmpuint (e->start_character_index + e->length_in_characters, <=, n_characters);
+    g_assert_cmpuint (g_utf8_strlen (e->start, e->length_in_bytes), ==, e->length_in_characters);
+
+    if (i > 0) {
+      g_assert (e->start >= entities[i - 1].start + entities[i - 1].length_in_bytes);
+    }
+  }
+}
+
+void
+fuzz_check_same (const char     *what,
+                 const TlEntity *a,
+                 gsize           n_a,
+                 const char     *a_base,
+                 const TlEntity *b,
+                 gsize           n_b,
+                 const char     *b_base)
+{
+  gsize i;
+
+  if (n_a != n_b) {
+    fprintf (stderr, "%s: %" G_GSIZE_FORMAT " vs. %" G_GSIZE_FORMAT " entities\n", what, n_a, n_b);
+    abort ();
+  }
+
+  for (i = 0; i < n_a; i ++) {
+    if (a[i].type != b[i].type ||
+        a[i].start - a_base != b[i].start - b_base ||
+        a[i].length_in_bytes != b[i].length_in_bytes ||
+        a[i].start_character_index != b[i].start_character_index ||
+        a[i].length_in_characters != b[i].length_in_characters) {
+      fprintf (stderr, "%s: entity %" G_GSIZE_FORMAT " differs\n", what, i);
+      abort ();
+    }
+  }
+}
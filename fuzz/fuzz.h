@@ -0,0 +1,70 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_FUZZ_H__
+#define __TL_FUZZ_H__
+
+#include "libtweetlength.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Every fuzz target implements LLVMFuzzerTestOneInput(), so it links against
+ * libFuzzer, AFL++'s driver (afl-clang-fast -fsanitize=fuzzer) or
+ * standalone.c, which just runs the files it gets.
+ *
+ * With -Dstats=true, each call is also checked for how much work it did
+ * (tokens the parser visited plus TLD lookups). More than
+ * TL_FUZZ_WORK_PER_BYTE (default 16) per input byte, plus a small constant,
+ * counts as a slow input and aborts, so the fuzzer keeps it as a crash.
+ */
+int LLVMFuzzerTestOneInput (const uint8_t *data,
+                            size_t         size);
+
+typedef struct {
+  char *text;
+  gsize length;
+  gboolean valid_utf8;
+} FuzzInput;
+
+/* Copies @data so that reading past @size trips ASan. Invalid UTF-8 gets a few
+ * NUL bytes of padding, since a truncated sequence at the end is read in full. */
+void     fuzz_input_init      (FuzzInput       *input,
+                               const uint8_t   *data,
+                               size_t           size);
+void     fuzz_input_clear     (FuzzInput       *input);
+/* @input up to its first NUL byte, for the NUL-terminated API variants.
+ * Padded the same way as fuzz_input_init(). */
+char    *fuzz_input_dup_nul   (const FuzzInput *input,
+                               gboolean        *out_has_nul);
+
+void     fuzz_work_start      (void);
+void     fuzz_work_check      (const char      *what,
+                               gsize            length_in_bytes);
+
+void     fuzz_check_entities  (const FuzzInput *input,
+                               const TlEntity  *entities,
+                               gsize            n_entities);
+void     fuzz_check_same      (const char      *what,
+                               const TlEntity  *a,
+                               gsize            n_a,
+                               const char      *a_base,
+                               const TlEntity  *b,
+                               gsize            n_b,
+                               const char      *b_base);
+
+#endif
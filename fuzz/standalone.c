@@ -0,0 +1,85 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Stand-in for libFuzzer's main() with compilers that don't have it: runs the
+ * fuzz target once on every file given, or every file in a given directory.
+ * That's enough to reproduce crashes and to replay a corpus under valgrind or
+ * the sanitizers.
+ */
+
+#include "fuzz.h"
+#include <stdio.h>
+
+static gboolean
+run_file (const char *path)
+{
+  GError *error = NULL;
+  char *contents;
+  gsize length;
+
+  if (!g_file_get_contents (path, &contents, &length, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  LLVMFuzzerTestOneInput ((const uint8_t *)contents, length);
+  g_free (contents);
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  guint n_inputs = 0;
+  int i;
+
+  for (i = 1; i < argc; i ++) {
+    if (g_file_test (argv[i], G_FILE_TEST_IS_DIR)) {
+      GDir *dir = g_dir_open (argv[i], 0, NULL);
+      const char *name;
+
+      if (dir == NULL) {
+        g_printerr ("Could not open %s\n", argv[i]);
+        return 1;
+      }
+
+      while ((name = g_dir_read_name (dir)) != NULL) {
+        char *path = g_build_filename (argv[i], name, NULL);
+
+        if (!run_file (path)) {
+          return 1;
+        }
+        n_inputs ++;
+        g_free (path);
+      }
+      g_dir_close (dir);
+    } else {
+      if (!run_file (argv[i])) {
+        return 1;
+      }
+      n_inputs ++;
+    }
+  }
+
+  printf ("Ran %u inputs\n", n_inputs);
+
+  return 0;
+}
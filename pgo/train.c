@@ -0,0 +1,140 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * The training run of a -Dpgo=true build: feeds every line of a corpus
+ * through every public entry point of the instrumented library, so the
+ * profile has counts for all of them.
+ */
+
+#include "libtweetlength.h"
+#include "tl-corpus.h"
+#include <string.h>
+
+#define N_PASSES 4
+// Lines per tl_count_characters_batch() call
+#define BATCH_SIZE 64
+
+static volatile gsize sink;
+
+static gsize
+train_text (const char *text,
+            gsize       length)
+{
+  TlEntity *entities;
+  TlTokens *tokens;
+  char *nul_terminated;
+  gsize n_entities;
+  gsize text_length;
+  gsize result = 0;
+
+  nul_terminated = g_strndup (text, length);
+
+  result += tl_count_characters (nul_terminated);
+  result += tl_count_characters_n (text, length);
+  result += tl_estimate_scratch_size (length);
+
+  entities = tl_extract_entities (nul_terminated, &n_entities, &text_length);
+  result += n_entities + text_length;
+  g_free (entities);
+
+  entities = tl_extract_entities_n (text, length, &n_entities, &text_length);
+  result += n_entities + text_length;
+  g_free (entities);
+
+  entities = tl_extract_entities_and_text (nul_terminated, &n_entities, &text_length);
+  result += n_entities + text_length;
+  g_free (entities);
+
+  entities = tl_extract_entities_and_text_n (text, length, &n_entities, NULL);
+  result += n_entities;
+  g_free (entities);
+
+  tokens = tl_tokenize_n (text, length);
+  entities = tl_tokens_extract_entities (tokens, &n_entities, &text_length);
+  result += n_entities + text_length;
+  g_free (entities);
+  tl_tokens_free (tokens);
+
+  g_free (nul_terminated);
+
+  return result;
+}
+
+int
+main (int argc, char **argv)
+{
+  TlCorpusStats stats;
+  GError *error = NULL;
+  char *data;
+  gsize length;
+  guint pass;
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s CORPUS\n", argv[0]);
+    return 1;
+  }
+
+  if (!g_file_get_contents (argv[1], &data, &length, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+
+  for (pass = 0; pass < N_PASSES; pass ++) {
+    const char *p = data;
+    const char *end = data + length;
+    const char *batch[BATCH_SIZE];
+    gsize batch_lengths[BATCH_SIZE];
+    gsize out_lengths[BATCH_SIZE];
+    guint n_batch = 0;
+    guint i;
+
+    while (p < end) {
+      const char *newline = memchr (p, '\n', end - p);
+      const char *line_end = newline != NULL ? newline : end;
+
+      sink += train_text (p, line_end - p);
+
+      batch[n_batch] = p;
+      batch_lengths[n_batch] = line_end - p;
+      n_batch ++;
+      p = line_end + 1;
+
+      if (n_batch == BATCH_SIZE || p >= end) {
+        tl_count_characters_batch (batch, batch_lengths, n_batch, out_lengths);
+        for (i = 0; i < n_batch; i ++) {
+          sink += out_lengths[i];
+        }
+        n_batch = 0;
+      }
+    }
+  }
+
+  // Single-threaded, so the profile counters don't race
+  if (!tl_corpus_scan_file (argv[1], 1, NULL, NULL, &stats, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  sink += stats.n_characters;
+
+  g_free (data);
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+#
+# Runs the training for a -Dpgo=true build: clears the profile directory, runs
+# the instrumented trainer on the corpus once per kernel level and, for Clang,
+# merges the raw profiles. Writes a header holding a hash of the result, which
+# every source of the optimized library includes, so they get rebuilt when the
+# profile changes.
+
+import argparse
+import glob
+import hashlib
+import os
+import shutil
+import subprocess
+import sys
+
+NOTE = '/* Generated by train.py, do not edit. */\n'
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--trainer', required=True)
+    parser.add_argument('--corpus', required=True)
+    parser.add_argument('--profile-dir', required=True)
+    parser.add_argument('--llvm-profdata')
+    parser.add_argument('--output', required=True)
+    parser.add_argument('levels', nargs='+')
+    args = parser.parse_args()
+
+    # Counts from an older build of the library don't match it anymore
+    shutil.rmtree(args.profile_dir, ignore_errors=True)
+    os.makedirs(args.profile_dir)
+
+    for level in args.levels:
+        env = dict(os.environ, TL_KERNELS=level)
+        if args.llvm_profdata:
+            env['LLVM_PROFILE_FILE'] = os.path.join(args.profile_dir, '%m.profraw')
+        subprocess.run([args.trainer, args.corpus], env=env, check=True)
+
+    if args.llvm_profdata:
+        raw = glob.glob(os.path.join(args.profile_dir, '*.profraw'))
+        profiles = [os.path.join(args.profile_dir, 'libtweetlength.profdata')]
+        subprocess.run([args.llvm_profdata, 'merge', '-o', profiles[0]] + raw, check=True)
+    else:
+        profiles = glob.glob(os.path.join(args.profile_dir, '**', '*.gcda'), recursive=True)
+
+    if not profiles:
+        sys.exit('The training run did not write a profile')
+
+    digest = hashlib.sha256()
+    for name in sorted(profiles):
+        with open(name, 'rb') as f:
+            digest.update(f.read())
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write(NOTE)
+        f.write('/* Profile {} */\n'.format(digest.hexdigest()))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+#
+# Writes libtweetlength_amalgamated.c and libtweetlength_amalgamated.h, the
+# GLib-free core (tl-core.c, tl-kernels.c, tl-trace.c and everything they
+# include) as one source file plus tl-core.h. The build runs this, or by
+# hand:
+#
+#   ./src/amalgamate.py src/ outdir/
+
+import os
+import re
+import sys
+
+SOURCES = ['tl-core.c', 'tl-kernels.c', 'tl-trace.c']
+HEADER = 'libtweetlength_amalgamated.h'
+SOURCE = 'libtweetlength_amalgamated.c'
+
+INCLUDE_RE = re.compile(r'^#include "([^"]+)"\s*$')
+
+# Only included with LIBTL_STATS, which needs GLib and is turned off below
+EXTERNAL = {'tl-stats.h'}
+
+NOTE = '/* Generated by amalgamate.py from {}, do not edit. */\n'
+
+
+def read(srcdir, name):
+    with open(os.path.join(srcdir, name), encoding='utf-8') as f:
+        return f.read()
+
+
+def split_license(text):
+    # Every file starts with the same license comment, keep just one
+    end = text.index(' */\n') + len(' */\n')
+    return text[:end], text[end:].lstrip('\n')
+
+
+def inline(srcdir, name, seen, out):
+    if name in seen:
+        return
+    seen.add(name)
+
+    _, body = split_license(read(srcdir, name))
+    out.append('\n/* ---- {} ---- */\n\n'.format(name))
+
+    for line in body.splitlines(keepends=True):
+        match = INCLUDE_RE.match(line)
+        if match is None:
+            out.append(line)
+        elif match.group(1) == 'tl-core.h':
+            if 'tl-core.h' not in seen:
+                seen.add('tl-core.h')
+                out.append('#include "{}"\n'.format(HEADER))
+        elif match.group(1) in EXTERNAL:
+            out.append(line)
+        else:
+            inline(srcdir, match.group(1), seen, out)
+
+
+def main():
+    srcdir, outdir = sys.argv[1:3]
+    license, core_header = split_license(read(srcdir, 'tl-core.h'))
+
+    with open(os.path.join(outdir, HEADER), 'w', encoding='utf-8') as f:
+        f.write(license + '\n' + NOTE.format('tl-core.h') + '\n' + core_header)
+
+    out = [license, '\n', NOTE.format(', '.join(SOURCES)), '\n',
+           '#undef LIBTL_STATS\n']
+    seen = set()
+    for name in SOURCES:
+        inline(srcdir, name, seen, out)
+
+    with open(os.path.join(outdir, SOURCE), 'w', encoding='utf-8') as f:
+        f.write(''.join(out).rstrip('\n') + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# Generates tld-tables.h from the lists in tlds/, one TLD per line, as taken
+# from twitter-text. Run it from anywhere after changing a list and commit the
+# result:
+#
+#   ./src/gen-tld-tables.py
+
+import os
+
+TABLES = [
+    ('SPECIAL_CCTLDS', 'special-cctlds.txt'),
+    ('GTLDS', 'gtlds.txt'),
+    ('CCTLDS', 'cctlds.txt'),
+]
+
+HEADER = '''/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Generated by gen-tld-tables.py from tlds/, do not edit. */
+
+#ifndef __TL_TLD_TABLES_H__
+#define __TL_TLD_TABLES_H__
+'''
+
+
+def read_list(path):
+    with open(path, encoding='utf-8') as f:
+        tlds = [line.strip() for line in f if line.strip()]
+    # token_is_tld() relies on the last entry being the longest one
+    return sorted(tlds, key=len)
+
+
+def c_string(s):
+    s = s.replace('\\', '\\\\').replace('"', '\\"').replace('\0', '\\0')
+    return '"' + s + '"'
+
+
+def main():
+    src_dir = os.path.dirname(os.path.abspath(__file__))
+    out = [HEADER]
+
+    for name, filename in TABLES:
+        tlds = read_list(os.path.join(src_dir, 'tlds', filename))
+        entries = []
+        offset = 0
+
+        out.append('\nstatic const char %s_STRINGS[] =\n' % name)
+        for tld in tlds:
+            out.append('  %s\n' % c_string(tld + '\0'))
+            entries.append((offset, len(tld), tld))
+            offset += len(tld.encode('utf-8')) + 1
+        out.append(';\n')
+
+        if offset > 0xFFFF:
+            raise SystemExit('%s does not fit 16 bit offsets anymore' % name)
+
+        out.append('\nstatic const TldEntry %s[] = {\n' % name)
+        for offset, length, tld in entries:
+            out.append('  {%d, %d}, // %s\n' % (offset, length, tld))
+        out.append('};\n')
+
+    out.append('\n#endif\n')
+
+    with open(os.path.join(src_dir, 'tld-tables.h'), 'w', encoding='utf-8') as f:
+        f.write(''.join(out))
+
+
+if __name__ == '__main__':
+    main()
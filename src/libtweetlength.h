@@ -19,28 +19,17 @@
 #define __LIBTWEETLENGTH_H__
 
 #include <glib.h>
+#include "tl-core.h"
 
-struct _TlEntity {
-  guint type;
-  const char *start;
-  gsize length_in_bytes;
-
-  gsize start_character_index;
-  gsize length_in_characters;
-};
-typedef struct _TlEntity TlEntity;
-
-typedef enum {
-  TL_ENT_TEXT       = 1,
-  TL_ENT_HASHTAG    = 2,
-  TL_ENT_LINK       = 3,
-  TL_ENT_MENTION    = 4,
-  TL_ENT_WHITESPACE = 5,
-} TlEntityType;
+G_BEGIN_DECLS
 
 gsize      tl_count_characters            (const char *input);
 gsize      tl_count_characters_n          (const char *input,
                                            gsize       length_in_bytes);
+void       tl_count_characters_batch      (const char * const *inputs,
+                                           const gsize        *lengths_in_bytes,
+                                           gsize               n_inputs,
+                                           gsize              *out_lengths);
 TlEntity * tl_extract_entities            (const char *input,
                                            gsize      *out_n_entities,
                                            gsize      *out_text_length);
@@ -56,6 +45,17 @@ TlEntity * tl_extract_entities_and_text_n (const char *input,
                                            gsize      *out_n_entities,
                                            gsize      *out_text_length);
 
+TlTokens * tl_tokenize_n                  (const char     *input,
+                                           gsize           length_in_bytes);
+TlEntity * tl_tokens_extract_entities     (const TlTokens *tokens,
+                                           gsize          *out_n_entities,
+                                           gsize          *out_text_length);
+void       tl_tokens_free                 (TlTokens       *tokens);
+
+gsize      tl_estimate_scratch_size       (gsize           length_in_bytes);
+
+G_END_DECLS
+
 
 
 #endif
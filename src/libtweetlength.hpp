@@ -0,0 +1,274 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef __LIBTWEETLENGTH_HPP__
+#define __LIBTWEETLENGTH_HPP__
+
+#include "tl-core.h"
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <memory_resource>
+#include <new>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/*
+ * C++20 API on top of tl-core.h, header-only. Link against the core
+ * (libtweetlength-core, or libtweetlength itself).
+ *
+ * Entities point into the text they came from, so it has to outlive them.
+ * All memory, the returned vectors and the scratch buffers for texts too long
+ * for the stack, comes from the given std::pmr::memory_resource.
+ */
+
+namespace tl {
+
+enum class EntityType : unsigned int {
+  text       = TL_ENT_TEXT,
+  hashtag    = TL_ENT_HASHTAG,
+  link       = TL_ENT_LINK,
+  mention    = TL_ENT_MENTION,
+  whitespace = TL_ENT_WHITESPACE,
+};
+
+struct Entity {
+  EntityType type;
+  std::string_view text;
+
+  std::size_t start_character_index;
+  std::size_t length_in_characters;
+};
+
+constexpr Entity
+to_entity (const TlEntity &entity) noexcept
+{
+  return {
+    static_cast<EntityType> (entity.type),
+    std::string_view (entity.start, entity.length_in_bytes),
+    entity.start_character_index,
+    entity.length_in_characters,
+  };
+}
+
+namespace detail {
+
+// The core frees without a size, but memory_resource wants it back
+struct alignas (std::max_align_t) BlockHeader {
+  std::size_t size;
+};
+
+inline void *
+resource_alloc (std::size_t  size,
+                void        *user_data) noexcept
+{
+  auto *resource = static_cast<std::pmr::memory_resource *> (user_data);
+
+  try {
+    void *mem = resource->allocate (sizeof (BlockHeader) + size, alignof (BlockHeader));
+    return new (mem) BlockHeader { size } + 1;
+  } catch (const std::bad_alloc &) {
+    // Like g_malloc(), the core can't handle running out of memory
+    std::abort ();
+  }
+}
+
+inline void
+resource_free (void *mem,
+               void *user_data) noexcept
+{
+  auto *resource = static_cast<std::pmr::memory_resource *> (user_data);
+  BlockHeader *header;
+
+  if (mem == nullptr) {
+    return;
+  }
+
+  header = static_cast<BlockHeader *> (mem) - 1;
+  resource->deallocate (header, sizeof (BlockHeader) + header->size, alignof (BlockHeader));
+}
+
+inline TlAllocator
+make_allocator (std::pmr::memory_resource *resource) noexcept
+{
+  return { resource_alloc, resource_free, resource };
+}
+
+// Exceptions must not unwind through the C code, so they wait here until the
+// core has returned and cleaned up.
+template <typename Func>
+struct Callback {
+  Func &func;
+  std::exception_ptr exception;
+
+  static void
+  call (const TlEntity *entity,
+        std::size_t     n_entities,
+        void           *user_data) noexcept
+  {
+    auto *self = static_cast<Callback *> (user_data);
+
+    if (self->exception) {
+      return;
+    }
+
+    try {
+      if constexpr (std::is_invocable_v<Func &, const Entity &, std::size_t>) {
+        self->func (to_entity (*entity), n_entities);
+      } else {
+        self->func (to_entity (*entity));
+      }
+    } catch (...) {
+      self->exception = std::current_exception ();
+    }
+  }
+};
+
+} // namespace detail
+
+/*
+ * The length of @text in characters, as tl_count_characters_n() computes it.
+ */
+inline std::size_t
+count (std::string_view           text,
+       std::pmr::memory_resource *resource = std::pmr::get_default_resource ())
+{
+  const TlAllocator allocator = detail::make_allocator (resource);
+
+  return tl_core_count_characters (text.data (), text.size (), &allocator);
+}
+
+/*
+ * The length of each of @texts into @out_lengths, which has to be at least
+ * as long. The same as count() on each, but faster for many short texts,
+ * see tl_core_count_characters_batch().
+ */
+inline void
+count (std::span<const std::string_view>  texts,
+       std::span<std::size_t>             out_lengths,
+       std::pmr::memory_resource         *resource = std::pmr::get_default_resource ())
+{
+  constexpr std::size_t chunk_size = 64;
+  const TlAllocator allocator = detail::make_allocator (resource);
+  const char *inputs[chunk_size];
+  std::size_t lengths[chunk_size];
+
+  for (std::size_t i = 0; i < texts.size (); i += chunk_size) {
+    const std::size_t n = texts.size () - i < chunk_size ? texts.size () - i : chunk_size;
+
+    for (std::size_t k = 0; k < n; k ++) {
+      inputs[k] = texts[i + k].data ();
+      lengths[k] = texts[i + k].size ();
+    }
+
+    tl_core_count_characters_batch (inputs, lengths, n, out_lengths.data () + i, &allocator);
+  }
+}
+
+/*
+ * Calls @func with each entity of @text, in order, without collecting them
+ * anywhere. @func takes a const tl::Entity & and optionally the total amount
+ * of entities as a std::size_t, which is the same in every call. Returns that
+ * total. Exceptions from @func stop the calls and are rethrown once the
+ * core is done.
+ */
+template <typename Func>
+std::size_t
+for_each_entity (std::string_view           text,
+                 Func                     &&func,
+                 bool                       with_text_entities = false,
+                 std::size_t               *out_text_length = nullptr,
+                 std::pmr::memory_resource *resource = std::pmr::get_default_resource ())
+{
+  const TlAllocator allocator = detail::make_allocator (resource);
+  detail::Callback<std::remove_reference_t<Func>> callback { func, nullptr };
+  std::size_t n_entities;
+
+  n_entities = tl_core_foreach_entity (text.data (), text.size (), with_text_entities,
+                                       callback.call, &callback, out_text_length, &allocator);
+
+  if (callback.exception) {
+    std::rethrow_exception (callback.exception);
+  }
+
+  return n_entities;
+}
+
+namespace detail {
+
+inline std::pmr::vector<Entity>
+collect (std::string_view           text,
+         bool                       with_text_entities,
+         std::size_t               *out_text_length,
+         std::pmr::memory_resource *resource)
+{
+  std::pmr::vector<Entity> entities (resource);
+
+  for_each_entity (text, [&entities] (const Entity &entity, std::size_t n_entities) {
+    if (entities.empty ()) {
+      entities.reserve (n_entities);
+    }
+    entities.push_back (entity);
+  }, with_text_entities, out_text_length, resource);
+
+  return entities;
+}
+
+} // namespace detail
+
+/*
+ * Hashtags, links and mentions in @text, like tl_extract_entities_n(). The
+ * vector is reserved once and filled straight from the parser.
+ */
+inline std::pmr::vector<Entity>
+extract (std::string_view           text,
+         std::pmr::memory_resource *resource = std::pmr::get_default_resource (),
+         std::size_t               *out_text_length = nullptr)
+{
+  return detail::collect (text, false, out_text_length, resource);
+}
+
+/*
+ * Like tl::extract(), but with text entities too, like
+ * tl_extract_entities_and_text_n().
+ */
+inline std::pmr::vector<Entity>
+extract_and_text (std::string_view           text,
+                  std::pmr::memory_resource *resource = std::pmr::get_default_resource (),
+                  std::size_t               *out_text_length = nullptr)
+{
+  return detail::collect (text, true, out_text_length, resource);
+}
+
+/*
+ * A view of tl::Entity over entities from the C API, e.g.
+ * tl::entities ({ array, n_entities }).
+ */
+inline auto
+entities (std::span<const TlEntity> array)
+{
+  return array | std::views::transform ([] (const TlEntity &entity) { return to_entity (entity); });
+}
+
+} // namespace tl
+
+#endif
@@ -0,0 +1,1685 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tl-core.h"
+#include "data.h"
+#include "tl-kernels.h"
+#include "tl-probes.h"
+#include "tl-stats-private.h"
+#include "tl-trace.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define LINK_LENGTH 23
+
+#define N_ELEMENTS(array) (sizeof (array) / sizeof ((array)[0]))
+
+#ifdef __GNUC__
+#define UNLIKELY(expr) __builtin_expect (!!(expr), 0)
+#define ALWAYS_INLINE  inline __attribute__ ((always_inline))
+#else
+#define UNLIKELY(expr) (expr)
+#define ALWAYS_INLINE  inline
+#endif
+
+/* Texts with up to this many tokens keep their tokens and entities in
+ * buffers on the stack, about 12KiB each. Enough for any 280 character tweet. */
+#ifndef STACK_TOKENS
+#define STACK_TOKENS 320
+#endif
+
+/* tl_core_count_characters_batch() scans texts up to this long side by side,
+ * longer ones would only keep the other lanes waiting */
+#define BATCH_LANE_BYTES 1024
+
+/*
+ * What one instantiation of the parser produces. parse() and the entity
+ * parsers below it only ever get one of these as a constant and are always
+ * inlined into the few engine functions further down, so like a template,
+ * each of those ends up with just the branches its mode needs.
+ */
+enum {
+  // Keep the entities, not only the sum of their lengths
+  ENGINE_ENTITIES = 1 << 0,
+  // Text entities are relevant too
+  ENGINE_TEXT     = 1 << 1,
+};
+
+#define ENGINE_COUNT             0
+#define ENGINE_EXTRACT           ENGINE_ENTITIES
+#define ENGINE_EXTRACT_WITH_TEXT (ENGINE_ENTITIES | ENGINE_TEXT)
+
+typedef struct {
+  unsigned int type;
+  const char *start;
+  size_t start_character_index;
+  size_t length_in_bytes;
+  size_t length_in_characters;
+} Token;
+
+struct _TlTokens {
+  Token *tokens;
+  size_t n_tokens;
+};
+
+/* Either points to a caller's stack buffer or to the heap */
+typedef struct {
+  Token *data;
+  size_t len;
+  size_t capacity;
+  Token *stack;
+  const TlAllocator *allocator;
+} TokenArray;
+
+/* Without ENGINE_ENTITIES, only len and length_in_characters are kept */
+typedef struct {
+  TlEntity *data;
+  size_t len;
+  size_t length_in_characters;
+  TlEntity *stack;
+  const TlAllocator *allocator;
+} EntityArray;
+
+static void *
+default_alloc (size_t  size,
+               void   *user_data)
+{
+  void *mem = malloc (size);
+
+  // Same as g_malloc(), callers never check
+  if (mem == NULL) {
+    abort ();
+  }
+
+  return mem;
+}
+
+static void
+default_free (void *mem,
+              void *user_data)
+{
+  free (mem);
+}
+
+static const TlAllocator default_allocator = { default_alloc, default_free, NULL };
+
+static inline void *
+tl_alloc (const TlAllocator *allocator,
+          size_t             size)
+{
+  STATS_ADD (n_allocations, 1);
+
+  return allocator->alloc (size, allocator->user_data);
+}
+
+static inline void
+tl_free (const TlAllocator *allocator,
+         void              *mem)
+{
+  if (mem != NULL) {
+    allocator->free (mem, allocator->user_data);
+  }
+}
+
+/*
+ * The input is trusted to be valid UTF-8, like with g_utf8_get_char().
+ * Bytes that can't start a sequence just stand for themselves, so invalid
+ * input never makes us read more than 3 bytes past a lead byte.
+ */
+static const uint8_t utf8_skip[256] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+#define utf8_next_char(p) ((p) + utf8_skip[*(const unsigned char *)(p)])
+
+static inline uint32_t
+utf8_get_char (const char *p)
+{
+  const unsigned char *s = (const unsigned char *)p;
+
+  switch (utf8_skip[s[0]]) {
+    case 2:
+      return ((s[0] & 0x1f) << 6) | (s[1] & 0x3f);
+    case 3:
+      return ((s[0] & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
+    case 4:
+      return ((s[0] & 0x07) << 18) | ((s[1] & 0x3f) << 12) | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
+    default:
+      return s[0];
+  }
+}
+
+enum {
+  TOK_TEXT = 1,
+  TOK_NUMBER,
+  TOK_WHITESPACE,
+  TOK_COLON,
+  TOK_SLASH,
+  TOK_OPEN_PAREN,
+  TOK_CLOSE_PAREN,
+  TOK_QUESTIONMARK,
+  TOK_DOT,
+  TOK_HASH,
+  TOK_AT,
+  TOK_EQUALS,
+  TOK_DASH,
+  TOK_UNDERSCORE,
+  TOK_APOSTROPHE,
+  TOK_QUOTE,
+  TOK_DOLLAR,
+  TOK_AMPERSAND,
+  TOK_EXCLAMATION,
+  TOK_TILDE
+};
+
+static inline unsigned int
+token_type_from_char (uint32_t c)
+{
+  switch (c) {
+    case '@':
+      return TOK_AT;
+    case '#':
+      return TOK_HASH;
+    case ':':
+      return TOK_COLON;
+    case '/':
+      return TOK_SLASH;
+    case '(':
+      return TOK_OPEN_PAREN;
+    case ')':
+      return TOK_CLOSE_PAREN;
+    case '.':
+      return TOK_DOT;
+    case '?':
+      return TOK_QUESTIONMARK;
+    case '=':
+      return TOK_EQUALS;
+    case '-':
+      return TOK_DASH;
+    case '_':
+      return TOK_UNDERSCORE;
+    case '\'':
+      return TOK_APOSTROPHE;
+    case '"':
+      return TOK_QUOTE;
+    case '$':
+      return TOK_DOLLAR;
+    case '&':
+      return TOK_AMPERSAND;
+    case '!':
+      return TOK_EXCLAMATION;
+    case '~':
+      return TOK_TILDE;
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      return TOK_NUMBER;
+    case ' ':
+    case '\n':
+    case '\t':
+      return TOK_WHITESPACE;
+
+    default:
+      return TOK_TEXT;
+  }
+}
+
+static inline bool
+token_ends_in_accented (const Token *t)
+{
+  const char *p = t->start;
+  uint32_t c;
+  size_t i;
+
+  if (t->length_in_bytes == 1 ||
+      t->type != TOK_TEXT) {
+    return false;
+  }
+
+  // The rules here aren't exactly clear...
+  // We read the last character of the text pointed to by the given token.
+  // If that's not an ascii character, we return true.
+  for (i = 0; i < t->length_in_characters - 1; i ++) {
+    p = utf8_next_char (p);
+  }
+
+  c = utf8_get_char (p);
+
+  if (c > 127)
+    return true;
+
+  return false;
+}
+
+static inline bool
+token_in (const Token *t,
+          const char  *haystack)
+{
+  const int haystack_len = strlen (haystack);
+  int i;
+
+  if (t->length_in_bytes > 1) {
+    return false;
+  }
+
+
+  for (i = 0; i < haystack_len; i ++) {
+    if (haystack[i] == t->start[0]) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+static void
+token_array_init (TokenArray        *array,
+                  Token             *stack,
+                  size_t             n_stack,
+                  size_t             capacity,
+                  const TlAllocator *allocator)
+{
+  array->len = 0;
+  array->stack = stack;
+  array->allocator = allocator;
+
+  if (capacity <= n_stack) {
+    array->data = stack;
+    array->capacity = n_stack;
+  } else {
+    array->data = tl_alloc (allocator, capacity * sizeof (Token));
+    array->capacity = capacity;
+  }
+}
+
+static void
+token_array_grow (TokenArray *array)
+{
+  const size_t capacity = array->capacity * 2 > 16 ? array->capacity * 2 : 16;
+  Token *data = tl_alloc (array->allocator, capacity * sizeof (Token));
+
+  memcpy (data, array->data, array->len * sizeof (Token));
+  if (array->data != array->stack) {
+    tl_free (array->allocator, array->data);
+  }
+
+  array->data = data;
+  array->capacity = capacity;
+}
+
+static inline void
+token_array_clear (TokenArray *array)
+{
+  if (array->data != array->stack) {
+    tl_free (array->allocator, array->data);
+  }
+}
+
+static ALWAYS_INLINE void
+entity_array_init (EntityArray       *array,
+                   const unsigned int mode,
+                   TlEntity          *stack,
+                   size_t             n_stack,
+                   size_t             capacity,
+                   const TlAllocator *allocator)
+{
+  array->len = 0;
+  array->length_in_characters = 0;
+  array->stack = stack;
+  array->allocator = allocator;
+
+  if (!(mode & ENGINE_ENTITIES)) {
+    array->data = NULL;
+  } else if (capacity <= n_stack) {
+    array->data = stack;
+  } else {
+    array->data = tl_alloc (allocator, capacity * sizeof (TlEntity));
+  }
+}
+
+static inline void
+entity_array_clear (EntityArray *array)
+{
+  if (array->data != array->stack) {
+    tl_free (array->allocator, array->data);
+  }
+}
+
+static inline void
+emplace_token (TokenArray *array,
+               const char *token_start,
+               size_t      token_length,
+               size_t      start_character_index,
+               size_t      length_in_characters)
+{
+  Token *t;
+
+  // Only invalid UTF-8 can produce more tokens than the count_tokens kernel said
+  if (UNLIKELY (array->len == array->capacity)) {
+    token_array_grow (array);
+  }
+
+  t = &array->data[array->len ++];
+
+  t->type = token_type_from_char (token_start[0]);
+  t->start = token_start;
+  t->length_in_bytes = token_length;
+  t->start_character_index = start_character_index;
+  t->length_in_characters = length_in_characters;
+}
+
+static ALWAYS_INLINE void
+emplace_entity_for_tokens (EntityArray        *array,
+                           const unsigned int  mode,
+                           const Token        *tokens,
+                           unsigned int        entity_type,
+                           unsigned int        start_token_index,
+                           unsigned int        end_token_index)
+{
+  TlEntity *e;
+  size_t length_in_characters = 0;
+  unsigned int i;
+
+  array->len ++;
+
+  if (!(mode & ENGINE_ENTITIES)) {
+    if (entity_type == TL_ENT_LINK) {
+      array->length_in_characters += LINK_LENGTH;
+    } else {
+      for (i = start_token_index; i <= end_token_index; i ++) {
+        length_in_characters += tokens[i].length_in_characters;
+      }
+      array->length_in_characters += length_in_characters;
+    }
+    return;
+  }
+
+  // Sized for one entity per token, so this can't overflow
+  e = &array->data[array->len - 1];
+
+  e->type = entity_type;
+  e->start = tokens[start_token_index].start;
+  e->length_in_bytes = 0;
+  e->start_character_index = tokens[start_token_index].start_character_index;
+
+  for (i = start_token_index; i <= end_token_index; i ++) {
+    e->length_in_bytes += tokens[i].length_in_bytes;
+    length_in_characters += tokens[i].length_in_characters;
+  }
+
+  e->length_in_characters = length_in_characters;
+  array->length_in_characters += entity_type == TL_ENT_LINK ? LINK_LENGTH : length_in_characters;
+}
+
+static inline bool
+is_valid_mention_char (uint32_t c)
+{
+  // Just ASCII
+  if (c > 127)
+    return false;
+
+  return true;
+}
+
+
+static inline bool
+token_is_tld (const Token *t,
+              bool         has_protocol)
+{
+  unsigned int i;
+
+  STATS_ADD (n_tld_lookups, 1);
+
+  if (t->length_in_characters > GTLDS[N_ELEMENTS (GTLDS) - 1].length) {
+    return false;
+  }
+
+  for (i = 0; i < N_ELEMENTS (GTLDS); i ++) {
+    if (t->length_in_characters == GTLDS[i].length &&
+        strncasecmp (t->start, TLD_STRING (GTLDS, i), t->length_in_bytes) == 0) {
+      return true;
+    }
+  }
+
+  for (i = 0; i < N_ELEMENTS (SPECIAL_CCTLDS); i ++) {
+    if (t->length_in_characters == SPECIAL_CCTLDS[i].length &&
+        strncasecmp (t->start, TLD_STRING (SPECIAL_CCTLDS, i), t->length_in_bytes) == 0) {
+      return true;
+    }
+  }
+
+  if (has_protocol) {
+    for (i = 0; i < N_ELEMENTS (CCTLDS); i ++) {
+      if (t->length_in_characters == CCTLDS[i].length &&
+          strncasecmp (t->start, TLD_STRING (CCTLDS, i), t->length_in_bytes) == 0) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+static inline bool
+token_is_protocol (const Token *t)
+{
+  if (t->type != TOK_TEXT) {
+    return false;
+  }
+
+  if (t->length_in_bytes != 4 && t->length_in_bytes != 5) {
+    return false;
+  }
+
+  return strncasecmp (t->start, "http", t->length_in_bytes) == 0 ||
+         strncasecmp (t->start, "https", t->length_in_bytes) == 0;
+}
+
+static inline bool
+char_splits (uint32_t c)
+{
+  switch (c) {
+    case ',':
+    case '.':
+    case '/':
+    case '?':
+    case '(':
+    case ')':
+    case ':':
+    case ';':
+    case '=':
+    case '@':
+    case '#':
+    case '-':
+    case '_':
+    case '\n':
+    case '\t':
+    case '\0':
+    case ' ':
+    case '\'':
+    case '"':
+    case '$':
+    case '|':
+    case '&':
+    case '^':
+    case '%':
+    case '+':
+    case '*':
+    case '\\':
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case '`':
+    case '~':
+    case '!':
+      return true;
+    default:
+      return false;
+  }
+
+  return false;
+}
+
+static inline size_t
+entity_length_in_characters (const TlEntity *e)
+{
+  switch (e->type) {
+    case TL_ENT_LINK:
+      return LINK_LENGTH;
+
+    default:
+      return e->length_in_characters;
+  }
+}
+
+/*
+ * tokenize:
+ * @tokens: (out caller-allocates): Location for the tokens, clear with
+ *   token_array_clear()
+ * @stack: (nullable): Buffer of @n_stack tokens to use if they fit
+ * @allocator: Used if they don't
+ */
+static void
+tokenize (const char        *input,
+          size_t             length_in_bytes,
+          TokenArray        *tokens,
+          Token             *stack,
+          size_t             n_stack,
+          const TlAllocator *allocator)
+{
+  STATS_TIMER_START (start);
+  const TlKernels *kernels = _tl_kernels ();
+  const char *p = input;
+  const char *end = input + length_in_bytes;
+  size_t cur_character_index = 0;
+
+  // Exact for valid UTF-8, so the array never has to grow
+  token_array_init (tokens, stack, n_stack, kernels->count_tokens (input, length_in_bytes), allocator);
+
+  TL_PROBE2 (tokenize_start, input, length_in_bytes);
+
+  while (p < end) {
+    const char *cur_start = p;
+    uint32_t cur_char = utf8_get_char (p);
+    size_t cur_length = 0;
+    size_t length_in_chars = 0;
+    unsigned int last_token_type = 0;
+
+    /* If this char already splits, it's a one-char token */
+    if (char_splits (cur_char)) {
+      const char *old_p = p;
+      p = utf8_next_char (p);
+      emplace_token (tokens, cur_start, p - old_p, cur_character_index, 1);
+      cur_character_index ++;
+      continue;
+    }
+
+    last_token_type = token_type_from_char (cur_char);
+
+    // Most of the token at once. The kernel stops on a character boundary,
+    // so the loop below can go on from there.
+    if (kernels->scan_run != NULL) {
+      cur_length = kernels->scan_run (p, end - p, last_token_type == TOK_NUMBER, &length_in_chars);
+      p += cur_length;
+    }
+
+    // Don't peek past the end, @input doesn't need to be NUL-terminated
+    while (p < end) {
+      const char *old_p = p;
+
+      // The first character is known to belong to the token already
+      if (length_in_chars > 0) {
+        cur_char = utf8_get_char (p);
+        if (token_type_from_char (cur_char) != last_token_type ||
+            char_splits (cur_char))
+          break;
+      }
+
+      p = utf8_next_char (p);
+      cur_length += p - old_p;
+      length_in_chars ++;
+    }
+
+    emplace_token (tokens, cur_start, cur_length, cur_character_index, length_in_chars);
+
+    cur_character_index += length_in_chars;
+  }
+
+  TL_PROBE2 (tokenize_done, length_in_bytes, tokens->len);
+  STATS_ADD (n_tokens, tokens->len);
+  STATS_TIMER_STOP (start, tokenize_ns);
+}
+
+static bool
+parse_link_tail (EntityArray  *entities,
+                 const Token  *tokens,
+                 size_t        n_tokens,
+                 unsigned int *current_position)
+{
+  unsigned int i = *current_position;
+  const Token *t;
+
+  TRACE (TRACE_LINK_TAIL_START, i, 0);
+
+  size_t paren_level = 0;
+  int first_paren_index = -1;
+  for (;;) {
+    t = &tokens[i];
+    STATS_ADD (n_token_visits, 1);
+
+    if (t->type == TOK_WHITESPACE || t->type == TOK_APOSTROPHE) {
+      i --;
+      break;
+    }
+
+    if (tokens[i].type == TOK_OPEN_PAREN) {
+
+      if (first_paren_index == -1) {
+        first_paren_index = i;
+        TRACE (TRACE_FIRST_PAREN, i, 0);
+      }
+      paren_level ++;
+      if (paren_level == 3) {
+        break;
+      }
+    } else if (tokens[i].type == TOK_CLOSE_PAREN) {
+      if (first_paren_index == -1) {
+        first_paren_index = i;
+        TRACE (TRACE_FIRST_PAREN, i, 0);
+      }
+      TRACE (TRACE_CLOSE_PAREN, i, paren_level);
+      paren_level --;
+    }
+
+    i ++;
+
+    if (i == n_tokens) {
+      i --;
+      break;
+    }
+  }
+
+  TRACE (TRACE_LINK_TAIL_END, i, paren_level);
+  if (paren_level != 0) {
+    assert (first_paren_index != -1);
+    i = first_paren_index - 1; // Before that paren
+  }
+
+  t = &tokens[i];
+  /* Whatever happened, don't count trailing punctuation */
+  if (token_in (t, INVALID_AFTER_URL_CHARS)) {
+    i --;
+  }
+
+  *current_position = i;
+
+  return true;
+}
+
+
+/*
+ * Where the TLD search of a parse_link() call started and ended, and the
+ * last dot followed by a TLD it saw on the way.
+ */
+typedef struct {
+  unsigned int start;
+  unsigned int end;
+  unsigned int tld_index;
+  bool tld_found;
+  bool has_protocol;
+} TldScan;
+
+static void
+scan_tlds (TldScan      *scan,
+           const Token  *tokens,
+           size_t        n_tokens,
+           unsigned int  start,
+           bool          has_protocol)
+{
+  unsigned int i;
+
+  TRACE (TRACE_TLD_SEARCH, start, n_tokens);
+
+  scan->start = start;
+  scan->tld_found = false;
+  scan->has_protocol = has_protocol;
+
+  for (i = start; i < n_tokens - 1; i ++) {
+    const Token *t = &tokens[i];
+
+    STATS_ADD (n_token_visits, 1);
+
+    if (!(t->type == TOK_NUMBER ||
+          t->type == TOK_TEXT ||
+          t->type == TOK_DOT ||
+          t->type == TOK_DASH)) {
+      break;
+    }
+
+    if (t->type == TOK_DOT &&
+        token_is_tld (&tokens[i + 1], has_protocol)) {
+      scan->tld_index = i;
+      scan->tld_found = true;
+      TRACE (TRACE_TLD_FOUND, i, 0);
+    }
+  }
+
+  scan->end = i;
+}
+
+// Returns whether a link has been parsed or not.
+static ALWAYS_INLINE bool
+parse_link (EntityArray        *entities,
+            const unsigned int  mode,
+            const Token        *tokens,
+            size_t              n_tokens,
+            TldScan            *tld_scan,
+            unsigned int       *current_position)
+{
+  unsigned int i = *current_position;
+  const Token *t;
+  unsigned int start_token = *current_position;
+  unsigned int end_token;
+  unsigned int tld_index;
+  bool has_protocol = false;
+
+  t = &tokens[i];
+
+  // Some may not even appear before a protocol
+  if (i > 0 && token_in (&tokens[i - 1], INVALID_BEFORE_URL_CHARS)) {
+    return false;
+  }
+
+  if (token_is_protocol (t)) {
+    // need "://" now, and something after it. Otherwise this is not a link,
+    // just the protocol.
+    if (i + 4 >= n_tokens) {
+      return false;
+    }
+
+    t = &tokens[i + 1];
+    if (t->type != TOK_COLON) {
+      return false;
+    }
+    i ++;
+
+    t = &tokens[i + 1];
+    if (t->type != TOK_SLASH) {
+      return false;
+    }
+    i ++;
+
+    t = &tokens[i + 1];
+    if (t->type != TOK_SLASH) {
+      return false;
+    }
+    i += 2; // Skip to token after second slash
+    has_protocol = true;
+  } else {
+    // Lookbehind: Token before may not be an @, they are not supported.
+    if (i > 0 && token_in (&tokens[i - 1], INVALID_BEFORE_NON_PROTOCOL_URL_CHARS)) {
+      return false;
+    }
+  }
+
+  if (token_in (&tokens[i], INVALID_URL_CHARS)) {
+    return false;
+  }
+
+  // Now read until .tld. There can be multiple (e.g. in http://foobar.com.com.com"),
+  // so we need to do this in a greedy way. Any later start in the same run of
+  // domain tokens ends up with the same result, so reuse it if we can.
+  if (tld_scan->has_protocol != has_protocol ||
+      i < tld_scan->start || i >= tld_scan->end) {
+    scan_tlds (tld_scan, tokens, n_tokens, i, has_protocol);
+  }
+
+  if (!tld_scan->tld_found || tld_scan->tld_index < i) {
+    return false;
+  }
+
+  tld_index = tld_scan->tld_index;
+  TRACE (TRACE_TLD_INDEX, tld_index, 0);
+
+  if (tld_index >= n_tokens - 1 ||
+      token_in (&tokens[tld_index - 1], INVALID_URL_CHARS)) {
+    return false;
+  }
+
+  // tld_index is the TOK_DOT
+  assert (tokens[tld_index].type == TOK_DOT);
+  i = tld_index + 1;
+
+  // If the next token is a colon, we are reading a port
+  if (i < n_tokens - 1 && tokens[i + 1].type == TOK_COLON) {
+    i ++; // i == COLON
+    if (i == n_tokens - 1 || tokens[i + 1].type != TOK_NUMBER) {
+      // According to twitter.com, the link reaches until before the COLON
+      i --;
+    } else {
+      // Skip port number
+      i ++;
+    }
+  }
+
+  TRACE (TRACE_PORT, i, 0);
+
+  // To continue a link, the next token must be a slash or a question mark
+  // If it isn't, we stop here.
+  if (i < n_tokens - 1) {
+    // A trailing slash is part of the link, other punctuation is not.
+    if (tokens[i + 1].type == TOK_SLASH ||
+        tokens[i + 1].type == TOK_QUESTIONMARK) {
+      i ++;
+
+      if (i < n_tokens - 1) {
+        if (!parse_link_tail (entities, tokens, n_tokens, &i)) {
+          return false;
+        }
+      } else if (tokens[i].type == TOK_QUESTIONMARK) {
+        // Trailing questionmark is not part of the link
+        i --;
+      }
+    } else if (tokens[i + 1].type == TOK_AT) {
+      // We cannot just return false for all non-slash/non-questionmark tokens here since
+      // The Rules say some of them make a link until this token and some of them cause the
+      // entire parsing to produce no link at all, like in the @ case (don't want to turn
+      // email addresses into links).
+      return false;
+    }
+  }
+
+  TRACE (TRACE_LINK_END, i, 0);
+  end_token = i;
+  assert (end_token < n_tokens);
+
+  emplace_entity_for_tokens (entities,
+                             mode,
+                             tokens,
+                             TL_ENT_LINK,
+                             start_token,
+                             end_token);
+
+  *current_position = end_token + 1; // Hop to the next token!
+
+  return true;
+}
+
+static ALWAYS_INLINE bool
+parse_mention (EntityArray        *entities,
+               const unsigned int  mode,
+               const Token        *tokens,
+               size_t              n_tokens,
+               unsigned int       *current_position)
+{
+  unsigned int i = *current_position;
+  const unsigned int start_token = i;
+  unsigned int end_token;
+
+  assert (tokens[i].type == TOK_AT);
+
+  // Lookback at the previous token. If it was a text token
+  // without whitespace between, this is not going to be a mention...
+  if (i > 0) {
+    // Text tokens before an @-token generally destroy the mention,
+    // except in a few cases...
+    if (tokens[i - 1].type == TOK_TEXT &&
+        !token_in (&tokens[i - 1], VALID_BEFORE_MENTION_CHARS) &&
+        !token_ends_in_accented (&tokens[i - 1])) {
+      return false;
+    }
+
+    // Numbers and special invalid chars always ruin the mention
+    if (tokens[i - 1].type == TOK_NUMBER ||
+        token_in (&tokens[i - 1], INVALID_BEFORE_MENTION_CHARS)) {
+      return false;
+    }
+  }
+
+  // Skip @
+  i ++;
+
+  for (;;) {
+    if (i >= n_tokens) {
+      i --;
+      break;
+    }
+
+    STATS_ADD (n_token_visits, 1);
+
+    if (token_in (&tokens[i], INVALID_MENTION_CHARS)) {
+      i --;
+      break;
+    }
+
+    if (tokens[i].type != TOK_TEXT &&
+        tokens[i].type != TOK_NUMBER &&
+        tokens[i].type != TOK_UNDERSCORE) {
+      i --;
+      break;
+    }
+
+    if (tokens[i].type == TOK_TEXT) {
+      const char *text = tokens[i].start;
+      // Special rules apply about what characters may appear in a @screen_name
+      const char *p = text;
+
+      while (p - text < (long)tokens[i].length_in_bytes) {
+        uint32_t c = utf8_get_char (p);
+
+        if (!is_valid_mention_char (c)) {
+          return false;
+        }
+
+        p = utf8_next_char (p);
+      }
+
+    }
+
+    i ++;
+  }
+
+  if (i == start_token) {
+    return false;
+  }
+
+  // Mentions ending in an '@' are no mentions, e.g. @_@
+  if (i < n_tokens - 1 &&
+      tokens[i + 1].type == TOK_AT) {
+    return false;
+  }
+
+  end_token = i;
+  assert (end_token < n_tokens);
+
+  emplace_entity_for_tokens (entities,
+                             mode,
+                             tokens,
+                             TL_ENT_MENTION,
+                             start_token,
+                             end_token);
+
+  *current_position = end_token + 1; // Hop to the next token!
+
+  return true;
+}
+
+static ALWAYS_INLINE bool
+parse_hashtag (EntityArray        *entities,
+               const unsigned int  mode,
+               const Token        *tokens,
+               size_t              n_tokens,
+               unsigned int       *current_position)
+{
+  size_t i = *current_position;
+  const unsigned int start_token = i;
+  unsigned int end_token;
+  bool text_found = false;
+
+  assert (tokens[i].type == TOK_HASH);
+
+  // Lookback at the previous token. If it was a text token
+  // without whitespace between, this is not going to be a mention...
+  if (i > 0 && tokens[i - 1].type == TOK_TEXT &&
+      !token_in (&tokens[i - 1], VALID_BEFORE_HASHTAG_CHARS)) {
+    return false;
+  }
+
+  // Some chars make the entire hashtag invalid
+  if (i > 0 && token_in (&tokens[i - 1], INVALID_BEFORE_HASHTAG_CHARS)) {
+    return false;
+  }
+
+  //skip #
+  i ++;
+
+  for (; i < n_tokens; i ++) {
+    STATS_ADD (n_token_visits, 1);
+
+    if (token_in (&tokens[i], INVALID_HASHTAG_CHARS)) {
+      break;
+    }
+
+    if (tokens[i].type != TOK_TEXT &&
+        tokens[i].type != TOK_NUMBER &&
+        tokens[i].type != TOK_UNDERSCORE) {
+      break;
+    }
+
+    text_found |= tokens[i].type == TOK_TEXT;
+  }
+
+  if (!text_found) {
+    return false;
+  }
+
+  end_token = i - 1;
+  assert (end_token < n_tokens);
+
+  emplace_entity_for_tokens (entities,
+                             mode,
+                             tokens,
+                             TL_ENT_HASHTAG,
+                             start_token,
+                             end_token);
+
+  *current_position = end_token + 1; // Hop to the next token!
+
+  return true;
+}
+
+/*
+ * parse:
+ * @mode: ENGINE_* flags, a constant
+ * @n_relevant_entities: (out) (optional): Hashtags, links, mentions and,
+ *   with ENGINE_TEXT, text entities found
+ * @entities: (out caller-allocates): Location for the entities, clear with
+ *   entity_array_clear()
+ * @stack: (nullable): Buffer of @n_stack entities to use if they fit
+ * @allocator: Used if they don't
+ */
+static ALWAYS_INLINE void
+parse (const Token        *tokens,
+       size_t              n_tokens,
+       const unsigned int  mode,
+       unsigned int       *n_relevant_entities,
+       EntityArray        *entities,
+       TlEntity           *stack,
+       size_t              n_stack,
+       const TlAllocator  *allocator)
+{
+  STATS_TIMER_START (start);
+  TldScan tld_scan = { 0, 0, 0, false, false };
+  unsigned int i = 0;
+  unsigned int relevant_entities = 0;
+
+  // Every entity covers at least one token
+  entity_array_init (entities, mode, stack, n_stack, n_tokens, allocator);
+
+  TL_PROBE1 (parse_start, n_tokens);
+
+  while (i < n_tokens) {
+    const Token *token = &tokens[i];
+    const unsigned int token_index = i;
+    bool found;
+
+    STATS_ADD (n_token_visits, 1);
+
+    // We always have to do this since links can begin with whatever word
+    {
+      STATS_TIMER_START (link_start);
+      TL_PROBE1 (parse_link_start, token_index);
+      found = parse_link (entities, mode, tokens, n_tokens, &tld_scan, &i);
+      TL_PROBE2 (parse_link_done, token_index, found);
+      STATS_TIMER_STOP (link_start, parse_link_ns);
+      STATS_ADD (n_link_attempts, 1);
+    }
+
+    if (found) {
+      STATS_ADD (n_links, 1);
+      relevant_entities ++;
+      continue;
+    }
+
+    switch (token->type) {
+      case TOK_AT:
+        TL_PROBE1 (parse_mention_start, token_index);
+        found = parse_mention (entities, mode, tokens, n_tokens, &i);
+        TL_PROBE2 (parse_mention_done, token_index, found);
+        if (found) {
+          relevant_entities ++;
+          continue;
+        }
+      break;
+
+      case TOK_HASH:
+        TL_PROBE1 (parse_hashtag_start, token_index);
+        found = parse_hashtag (entities, mode, tokens, n_tokens, &i);
+        TL_PROBE2 (parse_hashtag_done, token_index, found);
+        if (found) {
+          relevant_entities ++;
+          continue;
+        }
+      break;
+    }
+
+    if ((mode & ENGINE_TEXT) &&
+        token->type == TOK_TEXT) {
+      relevant_entities ++;
+    }
+
+    emplace_entity_for_tokens (entities,
+                               mode,
+                               tokens,
+                               token->type == TOK_TEXT ? TL_ENT_TEXT : TL_ENT_WHITESPACE,
+                               i, i);
+
+    i ++;
+  }
+
+  if (n_relevant_entities) {
+    *n_relevant_entities = relevant_entities;
+  }
+
+  TL_PROBE2 (parse_done, n_tokens, entities->len);
+  STATS_ADD (n_entities, entities->len);
+  STATS_TIMER_STOP (start, parse_ns);
+}
+
+/* The instantiations of parse() */
+
+static size_t
+count_engine (const Token       *tokens,
+              size_t             n_tokens,
+              const TlAllocator *allocator)
+{
+  EntityArray entities;
+
+  // Nothing to store, so no buffer either
+  parse (tokens, n_tokens, ENGINE_COUNT, NULL, &entities, NULL, 0, allocator);
+
+  return entities.length_in_characters;
+}
+
+static void
+extract_engine (const Token       *tokens,
+                size_t             n_tokens,
+                unsigned int      *n_relevant_entities,
+                EntityArray       *entities,
+                TlEntity          *stack,
+                size_t             n_stack,
+                const TlAllocator *allocator)
+{
+  parse (tokens, n_tokens, ENGINE_EXTRACT, n_relevant_entities, entities, stack, n_stack, allocator);
+}
+
+static void
+extract_with_text_engine (const Token       *tokens,
+                          size_t             n_tokens,
+                          unsigned int      *n_relevant_entities,
+                          EntityArray       *entities,
+                          TlEntity          *stack,
+                          size_t             n_stack,
+                          const TlAllocator *allocator)
+{
+  parse (tokens, n_tokens, ENGINE_EXTRACT_WITH_TEXT, n_relevant_entities, entities, stack, n_stack, allocator);
+}
+
+/*
+ * tl_core_count_characters:
+ * @input: (nullable): Text to measure
+ * @length_in_bytes: Length of @input, in bytes
+ * @allocator: (nullable): Allocator for texts too long for the stack
+ *
+ * Returns: The length of @input, in characters.
+ */
+TL_CORE_API size_t
+tl_core_count_characters (const char        *input,
+                          size_t             length_in_bytes,
+                          const TlAllocator *allocator)
+{
+  Token stack_tokens[STACK_TOKENS];
+  TokenArray tokens;
+  size_t length;
+
+  if (input == NULL || input[0] == '\0') {
+    return 0;
+  }
+
+  if (allocator == NULL) {
+    allocator = &default_allocator;
+  }
+
+  TL_PROBE2 (count_characters_entry, input, length_in_bytes);
+  STATS_ADD (n_calls, 1);
+  STATS_ADD (n_bytes, length_in_bytes);
+
+  // From here on, input/length_in_bytes are trusted to be OK
+  tokenize (input, length_in_bytes, &tokens, stack_tokens, STACK_TOKENS, allocator);
+  length = count_engine (tokens.data, tokens.len, allocator);
+  token_array_clear (&tokens);
+
+  TL_PROBE2 (count_characters_return, length_in_bytes, length);
+
+  return length;
+}
+
+/*
+ * tl_core_count_characters_batch:
+ * @inputs: Texts to measure, entries may be %NULL
+ * @lengths_in_bytes: Length of each of @inputs, in bytes
+ * @n_inputs: Number of texts
+ * @out_lengths: (out caller-allocates): Return location for the length of
+ *   each of @inputs, in characters
+ * @allocator: (nullable): Allocator for texts too long for the stack
+ *
+ * The same as calling tl_core_count_characters() on each text, but faster
+ * for many short ones: the kernels scan TL_KERNEL_LANES of them at once and
+ * count their characters. Only links don't count their characters, and
+ * there is no link without a '.', so only texts containing one, or invalid
+ * UTF-8, go through the parser.
+ */
+TL_CORE_API void
+tl_core_count_characters_batch (const char * const *inputs,
+                                const size_t       *lengths_in_bytes,
+                                size_t              n_inputs,
+                                size_t             *out_lengths,
+                                const TlAllocator  *allocator)
+{
+  const TlKernels *kernels = _tl_kernels ();
+  size_t n_parsed = 0;
+  size_t i = 0;
+
+  if (n_inputs == 0) {
+    return;
+  }
+
+  TL_PROBE1 (count_characters_batch_entry, n_inputs);
+
+  while (i < n_inputs) {
+    const char *texts[TL_KERNEL_LANES];
+    size_t lengths[TL_KERNEL_LANES];
+    size_t indices[TL_KERNEL_LANES];
+    size_t n_characters[TL_KERNEL_LANES];
+    unsigned int n_texts = 0;
+    unsigned int lane;
+    uint32_t parse;
+
+    for (; i < n_inputs && n_texts < TL_KERNEL_LANES; i ++) {
+      const char *input = inputs[i];
+      const size_t length = lengths_in_bytes[i];
+
+      // Like tl_core_count_characters(), nothing after a leading NUL counts
+      if (input == NULL || length == 0 || input[0] == '\0') {
+        out_lengths[i] = 0;
+      } else if (length > BATCH_LANE_BYTES) {
+        out_lengths[i] = tl_core_count_characters (input, length, allocator);
+        n_parsed ++;
+      } else {
+        texts[n_texts] = input;
+        lengths[n_texts] = length;
+        indices[n_texts] = i;
+        n_texts ++;
+      }
+    }
+
+    if (n_texts == 0) {
+      continue;
+    }
+
+    parse = kernels->scan_lanes (texts, lengths, n_texts, n_characters);
+
+    for (lane = 0; lane < n_texts; lane ++) {
+      if (parse & ((uint32_t)1 << lane)) {
+        n_characters[lane] = tl_core_count_characters (texts[lane], lengths[lane], allocator);
+        n_parsed ++;
+      }
+      out_lengths[indices[lane]] = n_characters[lane];
+    }
+  }
+
+  TL_PROBE2 (count_characters_batch_return, n_inputs, n_parsed);
+}
+
+/*
+ * Hands the relevant entities of @token_array to @func, in order.
+ *
+ * Returns: The amount of entities passed to @func.
+ */
+static size_t
+foreach_entity_in_tokens (const Token       *token_array,
+                          size_t             n_tokens,
+                          bool               extract_text_entities,
+                          TlEntityFunc       func,
+                          void              *user_data,
+                          size_t            *out_text_length,
+                          const TlAllocator *allocator)
+{
+  TlEntity stack_entities[STACK_TOKENS];
+  EntityArray entities;
+  unsigned int n_relevant_entities;
+
+  if (extract_text_entities) {
+    extract_with_text_engine (token_array, n_tokens, &n_relevant_entities,
+                              &entities, stack_entities, STACK_TOKENS, allocator);
+  } else {
+    extract_engine (token_array, n_tokens, &n_relevant_entities,
+                    &entities, stack_entities, STACK_TOKENS, allocator);
+  }
+
+  *out_text_length = entities.length_in_characters;
+
+#ifdef LIBTL_DEBUG
+  for (unsigned int i = 0; i < entities.len; i ++) {
+    const TlEntity *e = &entities.data[i];
+    _tl_debug ("TlEntity %u: Text: '%.*s', Type: %u, Bytes: %u, Length: %u, start character: %u", i, (int)e->length_in_bytes, e->start,
+               e->type, (unsigned int)e->length_in_bytes, (unsigned int)entity_length_in_characters (e), (unsigned int)e->start_character_index);
+  }
+#endif
+
+  // Only pass mentions, hashtags and links out
+  STATS_TIMER_START (copy_start);
+  for (unsigned int i = 0; i < entities.len; i ++) {
+    const TlEntity *e = &entities.data[i];
+    switch (e->type) {
+      case TL_ENT_LINK:
+      case TL_ENT_HASHTAG:
+      case TL_ENT_MENTION:
+        func (e, n_relevant_entities, user_data);
+      break;
+
+      case TL_ENT_TEXT:
+        if (extract_text_entities) {
+          func (e, n_relevant_entities, user_data);
+        }
+      break;
+
+      default: {}
+    }
+  }
+
+  entity_array_clear (&entities);
+  STATS_TIMER_STOP (copy_start, copy_ns);
+
+  return n_relevant_entities;
+}
+
+typedef struct {
+  TlEntity *entities;
+  size_t n_entities;
+  const TlAllocator *allocator;
+} EntitySink;
+
+static void
+append_entity (const TlEntity *entity,
+               size_t          n_entities,
+               void           *user_data)
+{
+  EntitySink *sink = user_data;
+
+  if (sink->entities == NULL) {
+    sink->entities = tl_alloc (sink->allocator, sizeof (TlEntity) * n_entities);
+  }
+
+  memcpy (&sink->entities[sink->n_entities], entity, sizeof (TlEntity));
+  sink->n_entities ++;
+}
+
+static TlEntity *
+extract_entities_from_tokens (const Token       *token_array,
+                              size_t             n_tokens,
+                              size_t            *out_n_entities,
+                              size_t            *out_text_length,
+                              bool               extract_text_entities,
+                              const TlAllocator *allocator)
+{
+  EntitySink sink = { NULL, 0, allocator };
+
+  *out_n_entities = foreach_entity_in_tokens (token_array, n_tokens, extract_text_entities,
+                                              append_entity, &sink, out_text_length, allocator);
+
+  return sink.entities;
+}
+
+/**
+ * tl_core_extract_entities:
+ * @input: (nullable): The input text to extract entities from
+ * @length_in_bytes: The length of @input, in bytes
+ * @extract_text_entities: Whether to return text entities too, as
+ *   tl_extract_entities_and_text_n() does
+ * @out_n_entities: (out): Location to store the amount of entities in the returned
+ *   array. If 0, the return value is %NULL.
+ * @out_text_length: (out) (optional): Return location for the complete
+ *   length of @input, in characters.
+ * @allocator: (nullable): Allocator for the returned array and for texts too
+ *   long for the stack
+ *
+ * Returns: An array of #TlEntity, free it with @allocator. If no entities are
+ *   found, %NULL is returned.
+ */
+TL_CORE_API TlEntity *
+tl_core_extract_entities (const char        *input,
+                          size_t             length_in_bytes,
+                          bool               extract_text_entities,
+                          size_t            *out_n_entities,
+                          size_t            *out_text_length,
+                          const TlAllocator *allocator)
+{
+  Token stack_tokens[STACK_TOKENS];
+  TokenArray tokens;
+  TlEntity *result_entities;
+  size_t dummy;
+
+  assert (out_n_entities != NULL);
+
+  if (out_text_length == NULL) {
+    out_text_length = &dummy;
+  }
+
+  if (input == NULL || input[0] == '\0') {
+    *out_n_entities = 0;
+    *out_text_length = 0;
+    return NULL;
+  }
+
+  if (allocator == NULL) {
+    allocator = &default_allocator;
+  }
+
+  if (extract_text_entities) {
+    TL_PROBE2 (extract_entities_and_text_entry, input, length_in_bytes);
+  } else {
+    TL_PROBE2 (extract_entities_entry, input, length_in_bytes);
+  }
+  STATS_ADD (n_calls, 1);
+  STATS_ADD (n_bytes, length_in_bytes);
+
+  tokenize (input, length_in_bytes, &tokens, stack_tokens, STACK_TOKENS, allocator);
+
+#ifdef LIBTL_DEBUG
+  _tl_debug ("############ %s: %.*s", __FUNCTION__, (unsigned int)length_in_bytes, input);
+  for (unsigned int i = 0; i < tokens.len; i ++) {
+    const Token *t = &tokens.data[i];
+    _tl_debug ("Token %u: Type: %d, Length: %u, Text:%.*s, start char: %u, chars: %u", i, t->type, (unsigned int)t->length_in_bytes,
+         (int)t->length_in_bytes, t->start, (unsigned int)t->start_character_index, (unsigned int)t->length_in_characters);
+  }
+#endif
+
+  result_entities = extract_entities_from_tokens (tokens.data,
+                                                  tokens.len,
+                                                  out_n_entities,
+                                                  out_text_length,
+                                                  extract_text_entities,
+                                                  allocator);
+  token_array_clear (&tokens);
+
+  if (extract_text_entities) {
+    TL_PROBE3 (extract_entities_and_text_return, length_in_bytes, *out_n_entities, *out_text_length);
+  } else {
+    TL_PROBE3 (extract_entities_return, length_in_bytes, *out_n_entities, *out_text_length);
+  }
+
+  return result_entities;
+}
+
+/**
+ * tl_core_foreach_entity:
+ * @input: (nullable): The input text to extract entities from
+ * @length_in_bytes: The length of @input, in bytes
+ * @extract_text_entities: Whether to pass text entities too
+ * @func: Called for each entity, in order
+ * @user_data: Passed to @func
+ * @out_text_length: (out) (optional): Return location for the complete
+ *   length of @input, in characters.
+ * @allocator: (nullable): Allocator for texts too long for the stack
+ *
+ * tl_core_extract_entities() without the returned array, so callers can put
+ * the entities wherever they want them. The entities passed to @func only
+ * live until it returns.
+ *
+ * Returns: The amount of entities passed to @func.
+ */
+TL_CORE_API size_t
+tl_core_foreach_entity (const char        *input,
+                        size_t             length_in_bytes,
+                        bool               extract_text_entities,
+                        TlEntityFunc       func,
+                        void              *user_data,
+                        size_t            *out_text_length,
+                        const TlAllocator *allocator)
+{
+  Token stack_tokens[STACK_TOKENS];
+  TokenArray tokens;
+  size_t n_entities;
+  size_t dummy;
+
+  assert (func != NULL);
+
+  if (out_text_length == NULL) {
+    out_text_length = &dummy;
+  }
+
+  if (input == NULL || input[0] == '\0') {
+    *out_text_length = 0;
+    return 0;
+  }
+
+  if (allocator == NULL) {
+    allocator = &default_allocator;
+  }
+
+  STATS_ADD (n_calls, 1);
+  STATS_ADD (n_bytes, length_in_bytes);
+
+  tokenize (input, length_in_bytes, &tokens, stack_tokens, STACK_TOKENS, allocator);
+  n_entities = foreach_entity_in_tokens (tokens.data, tokens.len, extract_text_entities,
+                                         func, user_data, out_text_length, allocator);
+  token_array_clear (&tokens);
+
+  return n_entities;
+}
+
+/**
+ * tl_core_tokenize:
+ * @input: (nullable): The input text to tokenize
+ * @length_in_bytes: The length of @input, in bytes
+ * @allocator: (nullable): Allocator for the returned tokens
+ *
+ * See tl_tokenize_n().
+ *
+ * Returns: (transfer full): The tokens of @input. Free with
+ *   tl_core_tokens_free() and the same @allocator.
+ */
+TL_CORE_API TlTokens *
+tl_core_tokenize (const char        *input,
+                  size_t             length_in_bytes,
+                  const TlAllocator *allocator)
+{
+  TlTokens *tokens;
+  TokenArray array;
+
+  if (allocator == NULL) {
+    allocator = &default_allocator;
+  }
+
+  tokens = tl_alloc (allocator, sizeof (TlTokens));
+
+  if (input == NULL || length_in_bytes == 0 || input[0] == '\0') {
+    tokens->tokens = NULL;
+    tokens->n_tokens = 0;
+    return tokens;
+  }
+
+  TL_PROBE2 (tokenize_n_entry, input, length_in_bytes);
+  STATS_ADD (n_calls, 1);
+  STATS_ADD (n_bytes, length_in_bytes);
+
+  // No stack buffer, the tokens have to outlive this call
+  tokenize (input, length_in_bytes, &array, NULL, 0, allocator);
+  tokens->n_tokens = array.len;
+  tokens->tokens = array.data;
+
+  TL_PROBE2 (tokenize_n_return, length_in_bytes, tokens->n_tokens);
+
+  return tokens;
+}
+
+/**
+ * tl_core_tokens_extract_entities:
+ * @tokens: Tokens as returned by tl_core_tokenize()
+ * @out_n_entities: (out): Location to store the amount of entities in the returned
+ *   array. If 0, the return value is %NULL.
+ * @out_text_length: (out) (optional): Return location for the complete
+ *   length of the tokenized text, in characters.
+ * @allocator: (nullable): Allocator for the returned array and for texts too
+ *   long for the stack
+ *
+ * Returns: The same as tl_core_extract_entities() on the text @tokens were
+ *   created from.
+ */
+TL_CORE_API TlEntity *
+tl_core_tokens_extract_entities (const TlTokens    *tokens,
+                                 size_t            *out_n_entities,
+                                 size_t            *out_text_length,
+                                 const TlAllocator *allocator)
+{
+  TlEntity *entities;
+  size_t dummy;
+
+  assert (tokens != NULL);
+  assert (out_n_entities != NULL);
+
+  if (out_text_length == NULL) {
+    out_text_length = &dummy;
+  }
+
+  if (tokens->n_tokens == 0) {
+    *out_n_entities = 0;
+    *out_text_length = 0;
+    return NULL;
+  }
+
+  if (allocator == NULL) {
+    allocator = &default_allocator;
+  }
+
+  TL_PROBE1 (tokens_extract_entities_entry, tokens->n_tokens);
+
+  entities = extract_entities_from_tokens (tokens->tokens,
+                                           tokens->n_tokens,
+                                           out_n_entities,
+                                           out_text_length,
+                                           false,
+                                           allocator);
+
+  TL_PROBE3 (tokens_extract_entities_return, tokens->n_tokens, *out_n_entities, *out_text_length);
+
+  return entities;
+}
+
+TL_CORE_API void
+tl_core_tokens_free (TlTokens          *tokens,
+                     const TlAllocator *allocator)
+{
+  if (tokens == NULL) {
+    return;
+  }
+
+  if (allocator == NULL) {
+    allocator = &default_allocator;
+  }
+
+  tl_free (allocator, tokens->tokens);
+  tl_free (allocator, tokens);
+}
+
+/**
+ * tl_core_scratch_size:
+ * @length_in_bytes: Length of a text, in bytes
+ *
+ * Token and entity buffers are sized from the text up front, so this is all
+ * the temporary memory any of the functions above needs for
+ * @length_in_bytes of valid UTF-8, at most one token per byte and one entity
+ * per token. The returned entity array and the #TlTokens struct are not
+ * included.
+ *
+ * Returns: An upper bound for the scratch memory, in bytes.
+ */
+TL_CORE_API size_t
+tl_core_scratch_size (size_t length_in_bytes)
+{
+  return length_in_bytes * (sizeof (Token) + sizeof (TlEntity));
+}
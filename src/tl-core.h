@@ -0,0 +1,121 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __TL_CORE_H__
+#define __TL_CORE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * The engine behind libtweetlength.h, with nothing but libc underneath. To
+ * build it into another project, compile src/tl-core.c, src/tl-kernels.c and
+ * src/tl-trace.c with src/ in the include path. Statistics (LIBTL_STATS)
+ * need GLib, so leave them off there.
+ *
+ * All functions take an optional allocator, NULL means malloc() and free().
+ * Texts that fit the stack buffers don't allocate anything beyond the
+ * returned arrays.
+ *
+ * The build also generates libtweetlength_amalgamated.c/.h, the same code in
+ * one file. Defining TL_CORE_API to "static inline" before including the .c
+ * gives the compiler all of it to inline into the caller.
+ */
+
+#ifndef TL_CORE_API
+#define TL_CORE_API
+#endif
+
+struct _TlEntity {
+  unsigned int type;
+  const char *start;
+  size_t length_in_bytes;
+
+  size_t start_character_index;
+  size_t length_in_characters;
+};
+typedef struct _TlEntity TlEntity;
+
+typedef struct _TlTokens TlTokens;
+
+typedef enum {
+  TL_ENT_TEXT       = 1,
+  TL_ENT_HASHTAG    = 2,
+  TL_ENT_LINK       = 3,
+  TL_ENT_MENTION    = 4,
+  TL_ENT_WHITESPACE = 5,
+} TlEntityType;
+
+typedef struct {
+  // Like g_malloc(), must not return NULL. Never called with a size of 0.
+  void * (* alloc) (size_t  size,
+                    void   *user_data);
+  void   (* free)  (void   *mem,
+                    void   *user_data);
+  void    *user_data;
+} TlAllocator;
+
+/* Gets every entity tl_core_foreach_entity() finds, in order. @n_entities is
+ * their total, the same in each call, so the first one can make room. */
+typedef void (* TlEntityFunc) (const TlEntity *entity,
+                               size_t          n_entities,
+                               void           *user_data);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+TL_CORE_API size_t     tl_core_count_characters        (const char        *input,
+                                                        size_t             length_in_bytes,
+                                                        const TlAllocator *allocator);
+TL_CORE_API void       tl_core_count_characters_batch  (const char * const *inputs,
+                                                        const size_t      *lengths_in_bytes,
+                                                        size_t             n_inputs,
+                                                        size_t            *out_lengths,
+                                                        const TlAllocator *allocator);
+TL_CORE_API TlEntity * tl_core_extract_entities        (const char        *input,
+                                                        size_t             length_in_bytes,
+                                                        bool               extract_text_entities,
+                                                        size_t            *out_n_entities,
+                                                        size_t            *out_text_length,
+                                                        const TlAllocator *allocator);
+TL_CORE_API size_t     tl_core_foreach_entity          (const char        *input,
+                                                        size_t             length_in_bytes,
+                                                        bool               extract_text_entities,
+                                                        TlEntityFunc       func,
+                                                        void              *user_data,
+                                                        size_t            *out_text_length,
+                                                        const TlAllocator *allocator);
+
+TL_CORE_API TlTokens * tl_core_tokenize                (const char        *input,
+                                                        size_t             length_in_bytes,
+                                                        const TlAllocator *allocator);
+TL_CORE_API TlEntity * tl_core_tokens_extract_entities (const TlTokens    *tokens,
+                                                        size_t            *out_n_entities,
+                                                        size_t            *out_text_length,
+                                                        const TlAllocator *allocator);
+TL_CORE_API void       tl_core_tokens_free             (TlTokens          *tokens,
+                                                        const TlAllocator *allocator);
+
+TL_CORE_API size_t     tl_core_scratch_size            (size_t             length_in_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
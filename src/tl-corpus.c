@@ -0,0 +1,354 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tl-corpus.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// More shards than workers, so one slow shard doesn't stall the others
+#define SHARDS_PER_WORKER 8
+#define MIN_SHARD_SIZE    (256 * 1024)
+
+// A truncated UTF-8 sequence at the very end gets read in full
+#define TAIL_PADDING 8
+
+typedef struct {
+  const char *start;
+  gsize length;
+} Shard;
+
+typedef struct {
+  const char *data_end;
+  const Shard *shards;
+  guint n_shards;
+  gint next_shard;
+
+  TlCorpusTextFunc text_func;
+  gpointer user_data;
+} ScanContext;
+
+typedef struct {
+  ScanContext *ctx;
+  TlCorpusStats stats;
+  GString *scratch;
+  GThread *thread;
+} Worker;
+
+static void
+count_record (Worker     *worker,
+              const char *record,
+              gsize       record_length)
+{
+  const ScanContext *ctx = worker->ctx;
+  TlCorpusStats *stats = &worker->stats;
+  const char *text = record;
+  gsize text_length = record_length;
+  TlEntity *entities;
+  gsize n_entities;
+  gsize length;
+  gsize i;
+
+  stats->n_records ++;
+
+  if (ctx->text_func != NULL &&
+      !ctx->text_func (record, record_length, worker->scratch,
+                       &text, &text_length, ctx->user_data)) {
+    stats->n_skipped ++;
+    return;
+  }
+
+  stats->n_bytes += text_length;
+  if (text_length == 0) {
+    return;
+  }
+
+  entities = tl_extract_entities_n (text, text_length, &n_entities, &length);
+
+  stats->n_characters += length;
+  stats->max_characters = MAX (stats->max_characters, length);
+
+  for (i = 0; i < n_entities; i ++) {
+    switch (entities[i].type) {
+      case TL_ENT_HASHTAG:
+        stats->n_hashtags ++;
+      break;
+      case TL_ENT_LINK:
+        stats->n_links ++;
+      break;
+      case TL_ENT_MENTION:
+        stats->n_mentions ++;
+      break;
+    }
+  }
+
+  g_free (entities);
+}
+
+static void
+scan_shard (Worker      *worker,
+            const Shard *shard)
+{
+  const char *p = shard->start;
+  const char *end = shard->start + shard->length;
+
+  while (p < end) {
+    const char *newline = memchr (p, '\n', end - p);
+    const char *record_end = newline != NULL ? newline : end;
+    gsize record_length = record_end - p;
+
+    if (record_length > 0 && record_end[-1] == '\r') {
+      record_length --;
+    }
+
+    // Records near the end of the mapping get copied, reading in a truncated
+    // character could cross its end otherwise
+    if ((gsize)(worker->ctx->data_end - (p + record_length)) < TAIL_PADDING) {
+      char *copy = g_malloc0 (record_length + TAIL_PADDING);
+
+      memcpy (copy, p, record_length);
+      count_record (worker, copy, record_length);
+      g_free (copy);
+    } else {
+      count_record (worker, p, record_length);
+    }
+
+    p = record_end + 1;
+  }
+}
+
+static gpointer
+worker_func (gpointer user_data)
+{
+  Worker *worker = user_data;
+  ScanContext *ctx = worker->ctx;
+
+  for (;;) {
+    guint shard_index = (guint)g_atomic_int_add (&ctx->next_shard, 1);
+
+    if (shard_index >= ctx->n_shards) {
+      break;
+    }
+
+    scan_shard (worker, &ctx->shards[shard_index]);
+  }
+
+  return NULL;
+}
+
+static guint
+split_shards (const char *data,
+              gsize       length,
+              guint       n_shards,
+              Shard      *shards)
+{
+  const char *end = data + length;
+  const char *p = data;
+  guint n = 0;
+  guint i;
+
+  for (i = 1; i <= n_shards && p < end; i ++) {
+    const char *shard_end = data + (length / n_shards) * i;
+
+    if (i == n_shards) {
+      shard_end = end;
+    } else if (shard_end < p) {
+      shard_end = p;
+    }
+
+    // Extend every shard up to and including the next newline
+    if (shard_end < end) {
+      const char *newline = memchr (shard_end, '\n', end - shard_end);
+
+      shard_end = newline != NULL ? newline + 1 : end;
+    }
+
+    shards[n].start = p;
+    shards[n].length = shard_end - p;
+    n ++;
+    p = shard_end;
+  }
+
+  return n;
+}
+
+/**
+ * tl_corpus_scan:
+ * @data: Newline-separated records
+ * @length_in_bytes: Length of @data, in bytes
+ * @n_workers: Number of threads to use, 0 for one per CPU
+ * @text_func: (nullable): Function returning the text to count for a record.
+ *   If %NULL, the entire record is counted.
+ * @user_data: User data for @text_func
+ * @out_stats: (out caller-allocates): Return location for the aggregated stats
+ *
+ * Splits @data into record-aligned shards and counts every record in them,
+ * using @n_workers threads. Records are passed to tl_extract_entities_n()
+ * in place, except for those close enough to the end of @data that reading
+ * ahead could cross it, which get copied. @text_func gets called from the
+ * worker threads.
+ */
+void
+tl_corpus_scan (const char       *data,
+                gsize             length_in_bytes,
+                guint             n_workers,
+                TlCorpusTextFunc  text_func,
+                gpointer          user_data,
+                TlCorpusStats    *out_stats)
+{
+  ScanContext ctx;
+  Shard *shards;
+  Worker *workers;
+  guint n_shards;
+  guint i;
+
+  g_return_if_fail (out_stats != NULL);
+
+  memset (out_stats, 0, sizeof (TlCorpusStats));
+
+  if (data == NULL || length_in_bytes == 0) {
+    return;
+  }
+
+  if (n_workers == 0) {
+    n_workers = g_get_num_processors ();
+  }
+
+  n_shards = MAX (1, MIN (n_workers * SHARDS_PER_WORKER, length_in_bytes / MIN_SHARD_SIZE));
+  n_workers = MIN (n_workers, n_shards);
+  shards = g_new (Shard, n_shards);
+
+  ctx.data_end = data + length_in_bytes;
+  ctx.shards = shards;
+  ctx.n_shards = split_shards (data, length_in_bytes, n_shards, shards);
+  ctx.next_shard = 0;
+  ctx.text_func = text_func;
+  ctx.user_data = user_data;
+
+  workers = g_new0 (Worker, n_workers);
+  for (i = 0; i < n_workers; i ++) {
+    workers[i].ctx = &ctx;
+    workers[i].scratch = g_string_new (NULL);
+  }
+
+  // The calling thread is worker 0
+  for (i = 1; i < n_workers; i ++) {
+    workers[i].thread = g_thread_new ("tl-corpus", worker_func, &workers[i]);
+  }
+  worker_func (&workers[0]);
+
+  for (i = 0; i < n_workers; i ++) {
+    if (workers[i].thread != NULL) {
+      g_thread_join (workers[i].thread);
+    }
+
+    tl_corpus_stats_merge (out_stats, &workers[i].stats);
+    g_string_free (workers[i].scratch, TRUE);
+  }
+
+  g_free (workers);
+  g_free (shards);
+}
+
+/**
+ * tl_corpus_scan_file:
+ * @filename: File containing newline-separated records
+ * @n_workers: Number of threads to use, 0 for one per CPU
+ * @text_func: (nullable): See tl_corpus_scan()
+ * @user_data: User data for @text_func
+ * @out_stats: (out caller-allocates): Return location for the aggregated stats
+ * @error: Return location for a #GError
+ *
+ * Maps @filename into memory and runs tl_corpus_scan() on it.
+ *
+ * Returns: %FALSE if @filename could not be mapped, %TRUE otherwise.
+ */
+gboolean
+tl_corpus_scan_file (const char        *filename,
+                     guint              n_workers,
+                     TlCorpusTextFunc   text_func,
+                     gpointer           user_data,
+                     TlCorpusStats     *out_stats,
+                     GError           **error)
+{
+  struct stat st;
+  void *data;
+  int fd;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (out_stats != NULL, FALSE);
+
+  fd = open (filename, O_RDONLY);
+  if (fd < 0 || fstat (fd, &st) != 0) {
+    int saved_errno = errno;
+
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                 "Could not open %s: %s", filename, g_strerror (saved_errno));
+    if (fd >= 0) {
+      close (fd);
+    }
+    return FALSE;
+  }
+
+  if (st.st_size == 0) {
+    close (fd);
+    tl_corpus_scan (NULL, 0, n_workers, text_func, user_data, out_stats);
+    return TRUE;
+  }
+
+  data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED) {
+    int saved_errno = errno;
+
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                 "Could not map %s: %s", filename, g_strerror (saved_errno));
+    return FALSE;
+  }
+
+  madvise (data, st.st_size, MADV_SEQUENTIAL);
+
+  tl_corpus_scan (data, st.st_size, n_workers, text_func, user_data, out_stats);
+
+  munmap (data, st.st_size);
+
+  return TRUE;
+}
+
+/**
+ * tl_corpus_stats_merge:
+ * @stats: Stats to add @other to
+ * @other: Stats of another part of the corpus
+ *
+ * Adds up the stats of two disjoint parts of a corpus.
+ */
+void
+tl_corpus_stats_merge (TlCorpusStats       *stats,
+                       const TlCorpusStats *other)
+{
+  stats->n_records += other->n_records;
+  stats->n_skipped += other->n_skipped;
+  stats->n_bytes += other->n_bytes;
+  stats->n_characters += other->n_characters;
+  stats->max_characters = MAX (stats->max_characters, other->max_characters);
+  stats->n_hashtags += other->n_hashtags;
+  stats->n_links += other->n_links;
+  stats->n_mentions += other->n_mentions;
+}
@@ -0,0 +1,58 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_CORPUS_H__
+#define __TL_CORPUS_H__
+
+#include "libtweetlength.h"
+
+struct _TlCorpusStats {
+  guint64 n_records;
+  guint64 n_skipped;
+  guint64 n_bytes;
+  guint64 n_characters;
+  guint64 max_characters;
+
+  guint64 n_hashtags;
+  guint64 n_links;
+  guint64 n_mentions;
+};
+typedef struct _TlCorpusStats TlCorpusStats;
+
+typedef gboolean (* TlCorpusTextFunc) (const char  *record,
+                                       gsize        record_length,
+                                       GString     *scratch,
+                                       const char **out_text,
+                                       gsize       *out_text_length,
+                                       gpointer     user_data);
+
+void     tl_corpus_scan      (const char        *data,
+                              gsize              length_in_bytes,
+                              guint              n_workers,
+                              TlCorpusTextFunc   text_func,
+                              gpointer           user_data,
+                              TlCorpusStats     *out_stats);
+gboolean tl_corpus_scan_file (const char        *filename,
+                              guint              n_workers,
+                              TlCorpusTextFunc   text_func,
+                              gpointer           user_data,
+                              TlCorpusStats     *out_stats,
+                              GError           **error);
+void     tl_corpus_stats_merge (TlCorpusStats       *stats,
+                                const TlCorpusStats *other);
+
+#endif
@@ -0,0 +1,773 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tl-kernels.h"
+#include "tl-trace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#ifdef __GNUC__
+#define ALWAYS_INLINE inline __attribute__ ((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+enum {
+  CLASS_TEXT,
+  CLASS_DIGIT,
+  CLASS_SPLIT
+};
+
+/* CLASS_SPLIT for the bytes char_splits () in tl-core.c is true for. Every
+ * byte of a non-ASCII character is text, and none of those split. */
+static const uint8_t byte_classes[256] = {
+  ['\0'] = CLASS_SPLIT, ['\t'] = CLASS_SPLIT, ['\n'] = CLASS_SPLIT, [' '] = CLASS_SPLIT,
+  ['!'] = CLASS_SPLIT, ['"'] = CLASS_SPLIT, ['#'] = CLASS_SPLIT, ['$'] = CLASS_SPLIT,
+  ['%'] = CLASS_SPLIT, ['&'] = CLASS_SPLIT, ['\''] = CLASS_SPLIT, ['('] = CLASS_SPLIT,
+  [')'] = CLASS_SPLIT, ['*'] = CLASS_SPLIT, ['+'] = CLASS_SPLIT, [','] = CLASS_SPLIT,
+  ['-'] = CLASS_SPLIT, ['.'] = CLASS_SPLIT, ['/'] = CLASS_SPLIT, [':'] = CLASS_SPLIT,
+  [';'] = CLASS_SPLIT, ['='] = CLASS_SPLIT, ['?'] = CLASS_SPLIT, ['@'] = CLASS_SPLIT,
+  ['['] = CLASS_SPLIT, ['\\'] = CLASS_SPLIT, [']'] = CLASS_SPLIT, ['^'] = CLASS_SPLIT,
+  ['_'] = CLASS_SPLIT, ['`'] = CLASS_SPLIT, ['{'] = CLASS_SPLIT, ['|'] = CLASS_SPLIT,
+  ['}'] = CLASS_SPLIT, ['~'] = CLASS_SPLIT,
+  ['0'] = CLASS_DIGIT, ['1'] = CLASS_DIGIT, ['2'] = CLASS_DIGIT, ['3'] = CLASS_DIGIT,
+  ['4'] = CLASS_DIGIT, ['5'] = CLASS_DIGIT, ['6'] = CLASS_DIGIT, ['7'] = CLASS_DIGIT,
+  ['8'] = CLASS_DIGIT, ['9'] = CLASS_DIGIT,
+};
+
+/*
+ * Split characters are all ASCII and digits are the only other characters
+ * that get a token type of their own, so looking at single bytes is enough:
+ * every split byte is a token, and every other byte starts one if its class
+ * differs from the previous byte's.
+ */
+static inline size_t
+count_tokens_bytes (const uint8_t *p,
+                    size_t         length_in_bytes,
+                    unsigned int   last_class)
+{
+  size_t n_tokens = 0;
+  size_t i;
+
+  for (i = 0; i < length_in_bytes; i ++) {
+    const unsigned int cur_class = byte_classes[p[i]];
+
+    n_tokens += cur_class == CLASS_SPLIT || cur_class != last_class;
+    last_class = cur_class;
+  }
+
+  return n_tokens;
+}
+
+static size_t
+count_tokens_scalar (const char *input,
+                     size_t      length_in_bytes)
+{
+  // Starting out "after a split" makes the first byte count
+  return count_tokens_bytes ((const uint8_t *)input, length_in_bytes, CLASS_SPLIT);
+}
+
+/*
+ * The batch counter's lanes: every level counts the continuation bytes and
+ * looks for dots and non-ASCII bytes in the whole 8 byte words of all texts,
+ * one word of each text per step, and scan_lanes_finish () adds the bytes
+ * after the last word.
+ */
+#define WORD_SIZE 8
+
+typedef struct {
+  size_t n_continuation[TL_KERNEL_LANES];
+  uint32_t dots;
+  uint32_t non_ascii;
+} Lanes;
+
+/*
+ * Whether @p is valid UTF-8, without overlong forms. Only then is every
+ * character one lead byte plus its continuation bytes, and only then is
+ * every '.' the tokenizer sees a '.' byte: it would decode "\xc0\xae" to one.
+ */
+static bool
+utf8_valid (const uint8_t *p,
+            size_t         length_in_bytes)
+{
+  const uint8_t *end = p + length_in_bytes;
+
+  while (p < end) {
+    const uint8_t c = *p;
+    uint8_t min = 0x80, max = 0xbf;
+    size_t n, i;
+
+    if (c < 0x80) {
+      p ++;
+      continue;
+    } else if (c >= 0xc2 && c <= 0xdf) {
+      n = 1;
+    } else if (c >= 0xe0 && c <= 0xef) {
+      n = 2;
+      min = c == 0xe0 ? 0xa0 : min;
+      max = c == 0xed ? 0x9f : max;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+      n = 3;
+      min = c == 0xf0 ? 0x90 : min;
+      max = c == 0xf4 ? 0x8f : max;
+    } else {
+      return false;
+    }
+
+    if ((size_t)(end - p) <= n || p[1] < min || p[1] > max) {
+      return false;
+    }
+    for (i = 2; i <= n; i ++) {
+      if ((p[i] & 0xc0) != 0x80) {
+        return false;
+      }
+    }
+    p += n + 1;
+  }
+
+  return true;
+}
+
+static inline uint32_t
+scan_lanes_finish (const char * const *texts,
+                   const size_t       *lengths_in_bytes,
+                   unsigned int        n_texts,
+                   const Lanes        *lanes,
+                   size_t             *out_n_characters)
+{
+  uint32_t dots = lanes->dots;
+  uint32_t non_ascii = lanes->non_ascii;
+  uint32_t parse;
+  unsigned int lane;
+
+  for (lane = 0; lane < n_texts; lane ++) {
+    const uint8_t *p = (const uint8_t *)texts[lane];
+    const size_t length = lengths_in_bytes[lane];
+    size_t n_continuation = lanes->n_continuation[lane];
+    size_t i;
+
+    for (i = length - length % WORD_SIZE; i < length; i ++) {
+      n_continuation += (p[i] & 0xc0) == 0x80;
+      dots |= (uint32_t)(p[i] == '.') << lane;
+      non_ascii |= (uint32_t)(p[i] >> 7) << lane;
+    }
+
+    out_n_characters[lane] = length - n_continuation;
+  }
+
+  // Pure ASCII is always valid, and dotted texts get parsed anyway
+  parse = dots;
+  for (lane = 0; lane < n_texts; lane ++) {
+    const uint32_t bit = (uint32_t)1 << lane;
+
+    if ((non_ascii & ~dots & bit) &&
+        !utf8_valid ((const uint8_t *)texts[lane], lengths_in_bytes[lane])) {
+      parse |= bit;
+    }
+  }
+
+  return parse;
+}
+
+#define ONES  UINT64_C (0x0101010101010101)
+#define HIGHS UINT64_C (0x8080808080808080)
+
+/* The high bit of every byte of @w that is a continuation byte, 10xxxxxx */
+static inline uint64_t
+word_continuation (uint64_t w)
+{
+  return w & ~(w << 1) & HIGHS;
+}
+
+/* Non-zero if one of the bytes of @w is @c */
+static inline uint64_t
+word_has_byte (uint64_t w,
+               uint8_t  c)
+{
+  const uint64_t x = w ^ (ONES * c);
+
+  return (x - ONES) & ~x & HIGHS;
+}
+
+/* The number of bytes with the high bit set in a word_continuation () result */
+static inline size_t
+word_count_highs (uint64_t highs)
+{
+  return (size_t)(((highs >> 7) * ONES) >> 56);
+}
+
+static uint32_t
+scan_lanes_scalar (const char * const *texts,
+                   const size_t       *lengths_in_bytes,
+                   unsigned int        n_texts,
+                   size_t             *out_n_characters)
+{
+  static const uint8_t zero_word[WORD_SIZE];
+  uint64_t dots[TL_KERNEL_LANES] = { 0 };
+  uint64_t highs[TL_KERNEL_LANES] = { 0 };
+  size_t n_words[TL_KERNEL_LANES];
+  size_t max_words = 0;
+  Lanes lanes;
+  unsigned int lane;
+  size_t w;
+
+  for (lane = 0; lane < n_texts; lane ++) {
+    n_words[lane] = lengths_in_bytes[lane] / WORD_SIZE;
+    max_words = n_words[lane] > max_words ? n_words[lane] : max_words;
+    lanes.n_continuation[lane] = 0;
+  }
+
+  for (w = 0; w < max_words; w ++) {
+    for (lane = 0; lane < n_texts; lane ++) {
+      // Texts that already ended read zeros, which are neither
+      const uint8_t *p = w < n_words[lane] ? (const uint8_t *)texts[lane] + w * WORD_SIZE : zero_word;
+      uint64_t word;
+
+      memcpy (&word, p, WORD_SIZE);
+      lanes.n_continuation[lane] += word_count_highs (word_continuation (word));
+      dots[lane] |= word_has_byte (word, '.');
+      highs[lane] |= word & HIGHS;
+    }
+  }
+
+  lanes.dots = 0;
+  lanes.non_ascii = 0;
+  for (lane = 0; lane < n_texts; lane ++) {
+    lanes.dots |= (uint32_t)(dots[lane] != 0) << lane;
+    lanes.non_ascii |= (uint32_t)(highs[lane] != 0) << lane;
+  }
+
+  return scan_lanes_finish (texts, lengths_in_bytes, n_texts, &lanes, out_n_characters);
+}
+
+static const TlKernels scalar_kernels = { "scalar", count_tokens_scalar, NULL, scan_lanes_scalar };
+
+#ifdef HAVE_X86_KERNELS
+
+/*
+ * The vector levels classify a whole vector of bytes at once into bit masks,
+ * one bit per byte. The loops around that are the same for every level and
+ * get inlined into each one, so they are compiled for its instruction set.
+ */
+typedef struct {
+  uint64_t split;
+  uint64_t digit;
+  uint64_t continuation; // 10xxxxxx, the bytes after the first of a character
+  // First bytes of characters at least 2, 3 and 4 bytes long, going by
+  // utf8_skip in tl-core.c
+  uint64_t lead_2;
+  uint64_t lead_3;
+  uint64_t lead_4;
+} Masks;
+
+typedef Masks (* MasksFunc) (const uint8_t *p);
+
+/* A byte is a split byte if the entry for its low nibble has the bit for its
+ * high nibble set, see byte_classes. Nibbles 8 to f, i.e. non-ASCII bytes,
+ * have no bit. */
+#define SPLIT_LOW_NIBBLES  0x55, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, \
+                           0x04, 0x05, 0x0d, 0xac, 0xa4, 0xac, 0xa4, 0x2c
+#define SPLIT_HIGH_NIBBLES 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, \
+                           0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+/* The lowest @n bits */
+static ALWAYS_INLINE uint64_t
+all_bits (unsigned int n)
+{
+  return n == 64 ? UINT64_MAX : ((uint64_t)1 << n) - 1;
+}
+
+static ALWAYS_INLINE size_t
+count_tokens_vectors (const uint8_t *p,
+                      size_t         length_in_bytes,
+                      unsigned int   width,
+                      MasksFunc      masks)
+{
+  const uint64_t all = all_bits (width);
+  // The classes of the byte before the current vector
+  uint64_t carry_split = 1;
+  uint64_t carry_digit = 0;
+  size_t n_tokens = 0;
+  size_t i;
+
+  for (i = 0; i + width <= length_in_bytes; i += width) {
+    const Masks m = masks (p + i);
+    const uint64_t prev_split = ((m.split << 1) | carry_split) & all;
+    const uint64_t prev_digit = ((m.digit << 1) | carry_digit) & all;
+
+    n_tokens += __builtin_popcountll (m.split | (m.split ^ prev_split) | (m.digit ^ prev_digit));
+
+    carry_split = m.split >> (width - 1);
+    carry_digit = m.digit >> (width - 1);
+  }
+
+  return n_tokens + count_tokens_bytes (p + i, length_in_bytes - i,
+                                        carry_split ? CLASS_SPLIT : (unsigned int)carry_digit);
+}
+
+static ALWAYS_INLINE size_t
+scan_run_vectors (const uint8_t *p,
+                  size_t         length_in_bytes,
+                  bool           digits,
+                  size_t        *out_n_characters,
+                  unsigned int   width,
+                  MasksFunc      masks)
+{
+  const uint64_t all = all_bits (width);
+  // Continuation bytes the characters of the previous vector expect
+  uint64_t carry = 0;
+  size_t n_characters = 0;
+  size_t i = 0;
+
+  while (i + width <= length_in_bytes) {
+    const Masks m = masks (p + i);
+    const uint64_t in_run = digits ? m.digit : ~(m.split | m.digit) & all;
+    const uint64_t expected = ((m.lead_2 << 1) | (m.lead_3 << 2) | (m.lead_4 << 3) | carry) & all;
+    // The run might end in this vector
+    const unsigned int n = in_run == all ? width : (unsigned int)__builtin_ctzll (~in_run);
+    const uint64_t run = all_bits (n);
+
+    // Continuation bytes where the lead bytes don't say so, i.e. broken
+    // UTF-8. Counting characters by their first bytes would disagree with
+    // the tokenizer stepping through them by length, so leave it all to it.
+    if (((expected ^ m.continuation) & run) != 0) {
+      break;
+    }
+
+    n_characters += __builtin_popcountll (~m.continuation & run);
+    i += n;
+
+    if (n < width) {
+      break;
+    }
+
+    carry = (m.lead_2 >> (width - 1)) | (m.lead_3 >> (width - 2)) | (m.lead_4 >> (width - 3));
+  }
+
+  // The last vector can end inside a character. Leave all of it to the
+  // tokenizer, which would count its other bytes as characters of their own.
+  while (i > 0 && i < length_in_bytes && (p[i] & 0xc0) == 0x80) {
+    i --;
+    if ((p[i] & 0xc0) != 0x80) {
+      n_characters --;
+    }
+  }
+
+  *out_n_characters = n_characters;
+
+  return i;
+}
+
+__attribute__ ((target ("ssse3")))
+static ALWAYS_INLINE Masks
+masks_ssse3 (const uint8_t *p)
+{
+  const __m128i v = _mm_loadu_si128 ((const __m128i *)p);
+  const __m128i nibble = _mm_set1_epi8 (0x0f);
+  const __m128i low = _mm_shuffle_epi8 (_mm_setr_epi8 (SPLIT_LOW_NIBBLES), _mm_and_si128 (v, nibble));
+  const __m128i high = _mm_shuffle_epi8 (_mm_setr_epi8 (SPLIT_HIGH_NIBBLES),
+                                         _mm_and_si128 (_mm_srli_epi16 (v, 4), nibble));
+  const __m128i digit = _mm_sub_epi8 (v, _mm_set1_epi8 ('0'));
+  Masks m;
+
+  m.split = ~(uint64_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_and_si128 (low, high), _mm_setzero_si128 ())) & 0xffff;
+  m.digit = (uint16_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_min_epu8 (digit, _mm_set1_epi8 (9)), digit));
+  m.continuation = (uint16_t)_mm_movemask_epi8 (_mm_cmplt_epi8 (v, _mm_set1_epi8 (-0x40)));
+
+  {
+    const uint64_t from_c0 = (uint16_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_max_epu8 (v, _mm_set1_epi8 (0xc0)), v));
+    const uint64_t from_e0 = (uint16_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_max_epu8 (v, _mm_set1_epi8 (0xe0)), v));
+    const uint64_t from_f0 = (uint16_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_max_epu8 (v, _mm_set1_epi8 (0xf0)), v));
+    const uint64_t from_f8 = (uint16_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_max_epu8 (v, _mm_set1_epi8 (0xf8)), v));
+
+    m.lead_2 = from_c0 & ~from_f8;
+    m.lead_3 = from_e0 & ~from_f8;
+    m.lead_4 = from_f0 & ~from_f8;
+  }
+
+  return m;
+}
+
+__attribute__ ((target ("ssse3")))
+static size_t
+count_tokens_ssse3 (const char *input,
+                    size_t      length_in_bytes)
+{
+  return count_tokens_vectors ((const uint8_t *)input, length_in_bytes, 16, masks_ssse3);
+}
+
+__attribute__ ((target ("ssse3")))
+static size_t
+scan_run_ssse3 (const char *p,
+                size_t      length_in_bytes,
+                bool        digits,
+                size_t     *out_n_characters)
+{
+  return scan_run_vectors ((const uint8_t *)p, length_in_bytes, digits, out_n_characters, 16, masks_ssse3);
+}
+
+__attribute__ ((target ("avx2,popcnt,bmi")))
+static ALWAYS_INLINE Masks
+masks_avx2 (const uint8_t *p)
+{
+  const __m256i v = _mm256_loadu_si256 ((const __m256i *)p);
+  const __m256i nibble = _mm256_set1_epi8 (0x0f);
+  // vpshufb looks up each 128 bit lane separately
+  const __m256i low = _mm256_shuffle_epi8 (_mm256_setr_epi8 (SPLIT_LOW_NIBBLES, SPLIT_LOW_NIBBLES),
+                                           _mm256_and_si256 (v, nibble));
+  const __m256i high = _mm256_shuffle_epi8 (_mm256_setr_epi8 (SPLIT_HIGH_NIBBLES, SPLIT_HIGH_NIBBLES),
+                                            _mm256_and_si256 (_mm256_srli_epi16 (v, 4), nibble));
+  const __m256i digit = _mm256_sub_epi8 (v, _mm256_set1_epi8 ('0'));
+  Masks m;
+
+  m.split = ~(uint64_t)(uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_and_si256 (low, high),
+                                                                          _mm256_setzero_si256 ())) & 0xffffffff;
+  m.digit = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_min_epu8 (digit, _mm256_set1_epi8 (9)), digit));
+  m.continuation = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpgt_epi8 (_mm256_set1_epi8 (-0x40), v));
+
+  {
+    const uint64_t from_c0 = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_max_epu8 (v, _mm256_set1_epi8 (0xc0)), v));
+    const uint64_t from_e0 = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_max_epu8 (v, _mm256_set1_epi8 (0xe0)), v));
+    const uint64_t from_f0 = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_max_epu8 (v, _mm256_set1_epi8 (0xf0)), v));
+    const uint64_t from_f8 = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_max_epu8 (v, _mm256_set1_epi8 (0xf8)), v));
+
+    m.lead_2 = from_c0 & ~from_f8;
+    m.lead_3 = from_e0 & ~from_f8;
+    m.lead_4 = from_f0 & ~from_f8;
+  }
+
+  return m;
+}
+
+__attribute__ ((target ("avx2,popcnt,bmi")))
+static size_t
+count_tokens_avx2 (const char *input,
+                   size_t      length_in_bytes)
+{
+  return count_tokens_vectors ((const uint8_t *)input, length_in_bytes, 32, masks_avx2);
+}
+
+__attribute__ ((target ("avx2,popcnt,bmi")))
+static size_t
+scan_run_avx2 (const char *p,
+               size_t      length_in_bytes,
+               bool        digits,
+               size_t     *out_n_characters)
+{
+  return scan_run_vectors ((const uint8_t *)p, length_in_bytes, digits, out_n_characters, 32, masks_avx2);
+}
+
+__attribute__ ((target ("avx512f,avx512bw,popcnt,bmi")))
+static ALWAYS_INLINE Masks
+masks_avx512 (const uint8_t *p)
+{
+  const __m512i v = _mm512_loadu_si512 (p);
+  const __m512i nibble = _mm512_set1_epi8 (0x0f);
+  const __m512i low = _mm512_shuffle_epi8 (_mm512_broadcast_i32x4 (_mm_setr_epi8 (SPLIT_LOW_NIBBLES)),
+                                           _mm512_and_si512 (v, nibble));
+  const __m512i high = _mm512_shuffle_epi8 (_mm512_broadcast_i32x4 (_mm_setr_epi8 (SPLIT_HIGH_NIBBLES)),
+                                            _mm512_and_si512 (_mm512_srli_epi16 (v, 4), nibble));
+  Masks m;
+
+  m.split = _mm512_test_epi8_mask (low, high);
+  m.digit = _mm512_cmple_epu8_mask (_mm512_sub_epi8 (v, _mm512_set1_epi8 ('0')), _mm512_set1_epi8 (9));
+  m.continuation = _mm512_cmplt_epi8_mask (v, _mm512_set1_epi8 (-0x40));
+  m.lead_2 = _mm512_cmplt_epu8_mask (_mm512_sub_epi8 (v, _mm512_set1_epi8 (0xc0)), _mm512_set1_epi8 (0x38));
+  m.lead_3 = _mm512_cmplt_epu8_mask (_mm512_sub_epi8 (v, _mm512_set1_epi8 (0xe0)), _mm512_set1_epi8 (0x18));
+  m.lead_4 = _mm512_cmplt_epu8_mask (_mm512_sub_epi8 (v, _mm512_set1_epi8 (0xf0)), _mm512_set1_epi8 (0x08));
+
+  return m;
+}
+
+__attribute__ ((target ("avx512f,avx512bw,popcnt,bmi")))
+static size_t
+count_tokens_avx512 (const char *input,
+                     size_t      length_in_bytes)
+{
+  return count_tokens_vectors ((const uint8_t *)input, length_in_bytes, 64, masks_avx512);
+}
+
+__attribute__ ((target ("avx512f,avx512bw,popcnt,bmi")))
+static size_t
+scan_run_avx512 (const char *p,
+                 size_t      length_in_bytes,
+                 bool        digits,
+                 size_t     *out_n_characters)
+{
+  return scan_run_vectors ((const uint8_t *)p, length_in_bytes, digits, out_n_characters, 64, masks_avx512);
+}
+
+/*
+ * The vector levels gather one word of each of 4 (AVX2) or 8 (AVX-512) texts
+ * into a vector. Gathers with a lane masked off don't read anything for it,
+ * so a text that ended, or a missing one, just adds zeros.
+ */
+__attribute__ ((target ("avx2,popcnt,bmi")))
+static uint32_t
+scan_lanes_avx2 (const char * const *texts,
+                 const size_t       *lengths_in_bytes,
+                 unsigned int        n_texts,
+                 size_t             *out_n_characters)
+{
+  enum { PER_VECTOR = 4, N_VECTORS = TL_KERNEL_LANES / PER_VECTOR };
+  const unsigned int n_vectors = (n_texts + PER_VECTOR - 1) / PER_VECTOR;
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i address[N_VECTORS];
+  __m256i n_words[N_VECTORS];
+  __m256i continuation[N_VECTORS];
+  __m256i dots[N_VECTORS];
+  __m256i highs[N_VECTORS];
+  long long max_words = 0;
+  long long w;
+  Lanes lanes;
+  unsigned int v, k;
+
+  for (v = 0; v < n_vectors; v ++) {
+    long long a[PER_VECTOR];
+    long long n[PER_VECTOR];
+
+    for (k = 0; k < PER_VECTOR; k ++) {
+      const unsigned int lane = v * PER_VECTOR + k;
+
+      a[k] = lane < n_texts ? (long long)(uintptr_t)texts[lane] : 0;
+      n[k] = lane < n_texts ? (long long)(lengths_in_bytes[lane] / WORD_SIZE) : 0;
+      max_words = n[k] > max_words ? n[k] : max_words;
+    }
+
+    address[v] = _mm256_loadu_si256 ((const __m256i *)a);
+    n_words[v] = _mm256_loadu_si256 ((const __m256i *)n);
+    continuation[v] = zero;
+    dots[v] = zero;
+    highs[v] = zero;
+  }
+
+  for (w = 0; w < max_words; w ++) {
+    const __m256i step = _mm256_set1_epi64x (w);
+
+    for (v = 0; v < n_vectors; v ++) {
+      const __m256i active = _mm256_cmpgt_epi64 (n_words[v], step);
+      const __m256i words = _mm256_mask_i64gather_epi64 (zero, NULL, address[v], active, 1);
+      const __m256i is_continuation = _mm256_cmpeq_epi8 (_mm256_and_si256 (words, _mm256_set1_epi8 (0xc0)),
+                                                         _mm256_set1_epi8 (0x80));
+
+      // Sums the bytes of each word, i.e. of each text
+      continuation[v] = _mm256_add_epi64 (continuation[v],
+                                          _mm256_sad_epu8 (_mm256_and_si256 (is_continuation, _mm256_set1_epi8 (1)), zero));
+      dots[v] = _mm256_or_si256 (dots[v], _mm256_cmpeq_epi8 (words, _mm256_set1_epi8 ('.')));
+      highs[v] = _mm256_or_si256 (highs[v], words);
+      address[v] = _mm256_add_epi64 (address[v], _mm256_set1_epi64x (WORD_SIZE));
+    }
+  }
+
+  lanes.dots = 0;
+  lanes.non_ascii = 0;
+  for (v = 0; v < n_vectors; v ++) {
+    const uint32_t dot_bytes = (uint32_t)_mm256_movemask_epi8 (dots[v]);
+    const uint32_t high_bytes = (uint32_t)_mm256_movemask_epi8 (highs[v]);
+    long long c[PER_VECTOR];
+
+    _mm256_storeu_si256 ((__m256i *)c, continuation[v]);
+    for (k = 0; k < PER_VECTOR; k ++) {
+      lanes.n_continuation[v * PER_VECTOR + k] = c[k];
+      lanes.dots |= (uint32_t)(((dot_bytes >> (k * WORD_SIZE)) & 0xff) != 0) << (v * PER_VECTOR + k);
+      lanes.non_ascii |= (uint32_t)(((high_bytes >> (k * WORD_SIZE)) & 0xff) != 0) << (v * PER_VECTOR + k);
+    }
+  }
+
+  return scan_lanes_finish (texts, lengths_in_bytes, n_texts, &lanes, out_n_characters);
+}
+
+__attribute__ ((target ("avx512f,avx512bw,popcnt,bmi")))
+static uint32_t
+scan_lanes_avx512 (const char * const *texts,
+                   const size_t       *lengths_in_bytes,
+                   unsigned int        n_texts,
+                   size_t             *out_n_characters)
+{
+  enum { PER_VECTOR = 8, N_VECTORS = TL_KERNEL_LANES / PER_VECTOR };
+  const unsigned int n_vectors = (n_texts + PER_VECTOR - 1) / PER_VECTOR;
+  const __m512i zero = _mm512_setzero_si512 ();
+  __m512i address[N_VECTORS];
+  __m512i n_words[N_VECTORS];
+  __m512i continuation[N_VECTORS];
+  uint64_t dots[N_VECTORS];
+  uint64_t highs[N_VECTORS];
+  long long max_words = 0;
+  long long w;
+  Lanes lanes;
+  unsigned int v, k;
+
+  for (v = 0; v < n_vectors; v ++) {
+    long long a[PER_VECTOR];
+    long long n[PER_VECTOR];
+
+    for (k = 0; k < PER_VECTOR; k ++) {
+      const unsigned int lane = v * PER_VECTOR + k;
+
+      a[k] = lane < n_texts ? (long long)(uintptr_t)texts[lane] : 0;
+      n[k] = lane < n_texts ? (long long)(lengths_in_bytes[lane] / WORD_SIZE) : 0;
+      max_words = n[k] > max_words ? n[k] : max_words;
+    }
+
+    address[v] = _mm512_loadu_si512 (a);
+    n_words[v] = _mm512_loadu_si512 (n);
+    continuation[v] = zero;
+    dots[v] = 0;
+    highs[v] = 0;
+  }
+
+  for (w = 0; w < max_words; w ++) {
+    const __m512i step = _mm512_set1_epi64 (w);
+
+    for (v = 0; v < n_vectors; v ++) {
+      const __mmask8 active = _mm512_cmpgt_epi64_mask (n_words[v], step);
+      const __m512i words = _mm512_mask_i64gather_epi64 (zero, active, address[v], NULL, 1);
+      const __mmask64 is_continuation = _mm512_cmpeq_epi8_mask (_mm512_and_si512 (words, _mm512_set1_epi8 (0xc0)),
+                                                                _mm512_set1_epi8 (0x80));
+
+      continuation[v] = _mm512_add_epi64 (continuation[v],
+                                          _mm512_sad_epu8 (_mm512_maskz_set1_epi8 (is_continuation, 1), zero));
+      dots[v] |= _mm512_cmpeq_epi8_mask (words, _mm512_set1_epi8 ('.'));
+      highs[v] |= _mm512_movepi8_mask (words);
+      address[v] = _mm512_add_epi64 (address[v], _mm512_set1_epi64 (WORD_SIZE));
+    }
+  }
+
+  lanes.dots = 0;
+  lanes.non_ascii = 0;
+  for (v = 0; v < n_vectors; v ++) {
+    long long c[PER_VECTOR];
+
+    _mm512_storeu_si512 (c, continuation[v]);
+    for (k = 0; k < PER_VECTOR; k ++) {
+      lanes.n_continuation[v * PER_VECTOR + k] = c[k];
+      lanes.dots |= (uint32_t)(((dots[v] >> (k * WORD_SIZE)) & 0xff) != 0) << (v * PER_VECTOR + k);
+      lanes.non_ascii |= (uint32_t)(((highs[v] >> (k * WORD_SIZE)) & 0xff) != 0) << (v * PER_VECTOR + k);
+    }
+  }
+
+  return scan_lanes_finish (texts, lengths_in_bytes, n_texts, &lanes, out_n_characters);
+}
+
+// SSSE3 has no gathers, the scalar words are as fast there
+static const TlKernels ssse3_kernels = { "ssse3", count_tokens_ssse3, scan_run_ssse3, scan_lanes_scalar };
+static const TlKernels avx2_kernels = { "avx2", count_tokens_avx2, scan_run_avx2, scan_lanes_avx2 };
+static const TlKernels avx512_kernels = { "avx512", count_tokens_avx512, scan_run_avx512, scan_lanes_avx512 };
+
+#endif
+
+const char * const _tl_kernel_levels[] = {
+  "scalar",
+  "ssse3",
+  "avx2",
+  "avx512",
+  NULL
+};
+
+const TlKernels *
+_tl_kernels_get (const char *name)
+{
+  if (strcmp (name, "scalar") == 0) {
+    return &scalar_kernels;
+  }
+
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init ();
+
+  if (strcmp (name, "ssse3") == 0 && __builtin_cpu_supports ("ssse3")) {
+    return &ssse3_kernels;
+  }
+
+  if (strcmp (name, "avx2") == 0 && __builtin_cpu_supports ("avx2") &&
+      __builtin_cpu_supports ("popcnt") && __builtin_cpu_supports ("bmi")) {
+    return &avx2_kernels;
+  }
+
+  if (strcmp (name, "avx512") == 0 && __builtin_cpu_supports ("avx512f") &&
+      __builtin_cpu_supports ("avx512bw") && __builtin_cpu_supports ("popcnt") &&
+      __builtin_cpu_supports ("bmi")) {
+    return &avx512_kernels;
+  }
+#endif
+
+  return NULL;
+}
+
+static const TlKernels *
+select_kernels (void)
+{
+  const char *forced = getenv ("TL_KERNELS");
+  const TlKernels *best = &scalar_kernels;
+  unsigned int i;
+
+  for (i = 0; _tl_kernel_levels[i] != NULL; i ++) {
+    const TlKernels *kernels = _tl_kernels_get (_tl_kernel_levels[i]);
+
+    if (kernels != NULL) {
+      best = kernels;
+    }
+  }
+
+  if (forced != NULL && forced[0] != '\0') {
+    const TlKernels *kernels = _tl_kernels_get (forced);
+
+    if (kernels != NULL) {
+      return kernels;
+    }
+
+    fprintf (stderr, "libtl: TL_KERNELS=%s is unknown or not supported by this CPU, using %s\n",
+             forced, best->name);
+  }
+
+  return best;
+}
+
+const TlKernels *
+_tl_kernels (void)
+{
+  static const TlKernels *selected;
+  const TlKernels *kernels;
+
+#ifdef __GNUC__
+  kernels = __atomic_load_n (&selected, __ATOMIC_ACQUIRE);
+#else
+  kernels = selected;
+#endif
+
+  if (kernels == NULL) {
+    // Racing threads all pick the same
+    kernels = select_kernels ();
+#ifdef LIBTL_DEBUG
+    _tl_debug ("Using %s kernels", kernels->name);
+#endif
+#ifdef __GNUC__
+    __atomic_store_n (&selected, kernels, __ATOMIC_RELEASE);
+#else
+    selected = kernels;
+#endif
+  }
+
+  return kernels;
+}
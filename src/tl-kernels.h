@@ -0,0 +1,77 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __TL_KERNELS_H__
+#define __TL_KERNELS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The tokenizer's byte scanning loops, in one version per instruction set
+ * level. _tl_kernels () picks the fastest level the CPU can run the first
+ * time it is called. TL_KERNELS=<level> in the environment forces one
+ * instead, for tests and benchmarks. If the CPU can't run it, there is a
+ * warning and the fastest level is used.
+ *
+ * All levels give the same results for valid UTF-8.
+ */
+
+/* Texts scan_lanes () takes at once */
+#define TL_KERNEL_LANES 16
+
+typedef struct {
+  const char *name;
+
+  /* The number of tokens tokenize () creates for @input, exact for valid
+   * UTF-8 */
+  size_t (* count_tokens) (const char *input,
+                           size_t      length_in_bytes);
+
+  /* The longest prefix of @p that is all digits (@digits) or all text bytes,
+   * i.e. neither digits nor bytes char_splits () is true for, up to the last
+   * vector that fits into @length_in_bytes and ending on a character
+   * boundary. Stores its length in characters in @out_n_characters.
+   * NULL for the scalar level, the tokenizer does it one character at a
+   * time then. */
+  size_t (* scan_run)     (const char *p,
+                           size_t      length_in_bytes,
+                           bool        digits,
+                           size_t     *out_n_characters);
+
+  /* For tl_core_count_characters_batch (): the number of characters in each
+   * of @n_texts (at most TL_KERNEL_LANES) texts, counting every byte that
+   * isn't a UTF-8 continuation byte, without looking at entities. Reads the
+   * texts side by side. Returns a bit per text whose count only the parser
+   * knows: texts containing a '.', and texts that aren't valid UTF-8. */
+  uint32_t (* scan_lanes) (const char * const *texts,
+                           const size_t       *lengths_in_bytes,
+                           unsigned int        n_texts,
+                           size_t             *out_n_characters);
+} TlKernels;
+
+/* Names of all levels, slowest first, NULL-terminated */
+extern const char * const _tl_kernel_levels[];
+
+const TlKernels *_tl_kernels     (void);
+/* The kernels of level @name, NULL if there is no such level or the CPU
+ * can't run it */
+const TlKernels *_tl_kernels_get (const char *name);
+
+#endif
@@ -0,0 +1,75 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_PROBES_H__
+#define __TL_PROBES_H__
+
+/*
+ * Static tracepoints (USDT) for perf, bpftrace, systemtap etc. in the
+ * "libtweetlength" provider. An unused probe is a single nop.
+ *
+ * Public API, only for non-empty input:
+ *   count_characters_entry            (input, length_in_bytes)
+ *   count_characters_return           (length_in_bytes, length)
+ *   count_characters_batch_entry      (n_inputs)
+ *   count_characters_batch_return     (n_inputs, n_parsed)
+ *   extract_entities_entry            (input, length_in_bytes)
+ *   extract_entities_return           (length_in_bytes, n_entities, length)
+ *   extract_entities_and_text_entry   (input, length_in_bytes)
+ *   extract_entities_and_text_return  (length_in_bytes, n_entities, length)
+ *   tokenize_n_entry                  (input, length_in_bytes)
+ *   tokenize_n_return                 (length_in_bytes, n_tokens)
+ *   tokens_extract_entities_entry     (n_tokens)
+ *   tokens_extract_entities_return    (n_tokens, n_entities, length)
+ *
+ * Stages:
+ *   tokenize_start                    (input, length_in_bytes)
+ *   tokenize_done                     (length_in_bytes, n_tokens)
+ *   parse_start                       (n_tokens)
+ *   parse_done                        (n_tokens, n_entities)
+ *   parse_link_start                  (token_index)
+ *   parse_link_done                   (token_index, found)
+ *   parse_mention_start               (token_index)
+ *   parse_mention_done                (token_index, found)
+ *   parse_hashtag_start               (token_index)
+ *   parse_hashtag_done                (token_index, found)
+ *
+ * For example, a histogram of tokenize() latencies:
+ *
+ *   bpftrace -e 'usdt:./libtweetlength.so:libtweetlength:tokenize_start { @s[tid] = nsecs; }
+ *                usdt:./libtweetlength.so:libtweetlength:tokenize_done /@s[tid]/ {
+ *                  @ns = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+ */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define TL_PROBE1(name, a)          DTRACE_PROBE1 (libtweetlength, name, a)
+#define TL_PROBE2(name, a, b)       DTRACE_PROBE2 (libtweetlength, name, a, b)
+#define TL_PROBE3(name, a, b, c)    DTRACE_PROBE3 (libtweetlength, name, a, b, c)
+
+#else
+
+// Still "use" the arguments, so variables only passed to probes don't warn
+#define TL_PROBE1(name, a)          do { (void)(a); } while (0)
+#define TL_PROBE2(name, a, b)       do { (void)(a); (void)(b); } while (0)
+#define TL_PROBE3(name, a, b, c)    do { (void)(a); (void)(b); (void)(c); } while (0)
+
+#endif
+
+#endif
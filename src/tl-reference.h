@@ -0,0 +1,37 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __TL_REFERENCE_H__
+#define __TL_REFERENCE_H__
+
+#include "libtweetlength.h"
+
+/*
+ * Reference engine, see tl-reference.c. Not installed, only the differential
+ * tests and fuzzers link against it.
+ */
+
+gsize      tl_reference_count_characters_n (const char *input,
+                                            gsize       length_in_bytes);
+TlEntity * tl_reference_extract_entities_n (const char *input,
+                                            gsize       length_in_bytes,
+                                            gboolean    extract_text_entities,
+                                            gsize      *out_n_entities,
+                                            gsize      *out_text_length);
+
+#endif
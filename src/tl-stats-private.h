@@ -0,0 +1,63 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_STATS_PRIVATE_H__
+#define __TL_STATS_PRIVATE_H__
+
+/*
+ * Counters are only compiled in with -Dstats=true (LIBTL_STATS). Otherwise
+ * all of these expand to nothing, and this header doesn't need GLib.
+ *
+ *   STATS_ADD (n_tokens, tokens->len);
+ *
+ *   STATS_TIMER_START (start);
+ *   ...
+ *   STATS_TIMER_STOP (start, tokenize_ns);
+ */
+#ifdef LIBTL_STATS
+
+#include "tl-stats.h"
+
+// Every thread writes to its own block, tl_stats_get() sums them up
+extern __thread TlStats *_tl_stats_local;
+
+TlStats *_tl_stats_register (void);
+guint64  _tl_stats_now      (void);
+
+static inline TlStats *
+tl_stats_local (void)
+{
+  if (G_LIKELY (_tl_stats_local != NULL)) {
+    return _tl_stats_local;
+  }
+
+  return _tl_stats_register ();
+}
+
+#define STATS_ADD(field, n)           (tl_stats_local ()->field += (n))
+#define STATS_TIMER_START(name)       const guint64 name = _tl_stats_now ()
+#define STATS_TIMER_STOP(name, field) STATS_ADD (field, _tl_stats_now () - (name))
+
+#else
+
+#define STATS_ADD(field, n)           do { } while (0)
+#define STATS_TIMER_START(name)
+#define STATS_TIMER_STOP(name, field) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tl-stats.h"
+#include "tl-stats-private.h"
+#include <string.h>
+#include <time.h>
+
+#ifdef LIBTL_STATS
+
+#define N_FIELDS (sizeof (TlStats) / sizeof (guint64))
+
+__thread TlStats *_tl_stats_local;
+
+static GMutex stats_lock;
+// Blocks of all live threads
+static GSList *thread_stats;
+// Sum of all threads that have exited since
+static TlStats retired_stats;
+
+static inline void
+stats_add (TlStats       *stats,
+           const TlStats *other)
+{
+  guint64 *a = (guint64 *)stats;
+  const guint64 *b = (const guint64 *)other;
+  guint i;
+
+  for (i = 0; i < N_FIELDS; i ++) {
+    a[i] += b[i];
+  }
+}
+
+static void
+thread_stats_free (gpointer data)
+{
+  TlStats *stats = data;
+
+  g_mutex_lock (&stats_lock);
+  stats_add (&retired_stats, stats);
+  thread_stats = g_slist_remove (thread_stats, stats);
+  g_mutex_unlock (&stats_lock);
+
+  _tl_stats_local = NULL;
+  g_free (stats);
+}
+
+// Only here for its destroy notify, lookups go through _tl_stats_local
+static GPrivate thread_stats_key = G_PRIVATE_INIT (thread_stats_free);
+
+TlStats *
+_tl_stats_register (void)
+{
+  TlStats *stats = g_new0 (TlStats, 1);
+
+  g_mutex_lock (&stats_lock);
+  thread_stats = g_slist_prepend (thread_stats, stats);
+  g_mutex_unlock (&stats_lock);
+
+  g_private_set (&thread_stats_key, stats);
+  _tl_stats_local = stats;
+
+  return stats;
+}
+
+guint64
+_tl_stats_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (guint64)ts.tv_sec * G_GUINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+#endif
+
+/**
+ * tl_stats_get:
+ * @out_stats: (out caller-allocates): Location to store the statistics
+ *
+ * Sums up the counters of all threads, including the ones that have exited.
+ * Counters of threads that are busy at the same time might be a few calls
+ * behind.
+ *
+ * Returns: %FALSE if libtweetlength was built without statistics support,
+ *   in which case @out_stats is all zeros.
+ */
+gboolean
+tl_stats_get (TlStats *out_stats)
+{
+  g_return_val_if_fail (out_stats != NULL, FALSE);
+
+  memset (out_stats, 0, sizeof (TlStats));
+
+#ifdef LIBTL_STATS
+  {
+    GSList *l;
+
+    g_mutex_lock (&stats_lock);
+    stats_add (out_stats, &retired_stats);
+    for (l = thread_stats; l != NULL; l = l->next) {
+      stats_add (out_stats, l->data);
+    }
+    g_mutex_unlock (&stats_lock);
+  }
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+/**
+ * tl_stats_reset:
+ *
+ * Sets all counters back to zero. Calls running concurrently on other
+ * threads might still end up in the old counts.
+ */
+void
+tl_stats_reset (void)
+{
+#ifdef LIBTL_STATS
+  GSList *l;
+
+  g_mutex_lock (&stats_lock);
+  memset (&retired_stats, 0, sizeof (TlStats));
+  for (l = thread_stats; l != NULL; l = l->next) {
+    memset (l->data, 0, sizeof (TlStats));
+  }
+  g_mutex_unlock (&stats_lock);
+#endif
+}
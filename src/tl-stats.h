@@ -0,0 +1,47 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_STATS_H__
+#define __TL_STATS_H__
+
+#include "libtweetlength.h"
+
+struct _TlStats {
+  // Texts passed to the counting, extraction or tokenizing functions
+  guint64 n_calls;
+  guint64 n_bytes;
+  guint64 n_tokens;
+  // Tokens looked at by the parser, the same token may be visited many times
+  guint64 n_token_visits;
+  guint64 n_entities;
+  guint64 n_tld_lookups;
+  guint64 n_link_attempts;
+  guint64 n_links;
+  guint64 n_allocations;
+
+  // Cumulative time per stage. parse_link is part of parse.
+  guint64 tokenize_ns;
+  guint64 parse_ns;
+  guint64 parse_link_ns;
+  guint64 copy_ns;
+};
+typedef struct _TlStats TlStats;
+
+gboolean tl_stats_get   (TlStats *out_stats);
+void     tl_stats_reset (void);
+
+#endif
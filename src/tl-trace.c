@@ -0,0 +1,109 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tl-trace.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LIBTL_DEBUG
+
+__thread TraceRing _tl_trace_ring;
+
+static const char * const event_names[N_TRACE_EVENTS] = {
+  "link tail start",
+  "first paren",
+  "close paren",
+  "link tail end",
+  "tld search",
+  "tld found",
+  "tld index",
+  "port",
+  "link end",
+};
+
+/*
+ * _tl_trace_dump:
+ *
+ * Prints the events recorded by the calling thread, oldest first.
+ */
+void
+_tl_trace_dump (void)
+{
+  const uint64_t n_events = _tl_trace_ring.n_events;
+  uint64_t i = n_events > TRACE_RING_SIZE ? n_events - TRACE_RING_SIZE : 0;
+
+  for (; i < n_events; i ++) {
+    const TraceEvent *e = &_tl_trace_ring.events[i & (TRACE_RING_SIZE - 1)];
+
+    fprintf (stderr, "%" PRIu64 ": %s %u %" PRIu64 "\n",
+             i, e->type < N_TRACE_EVENTS ? event_names[e->type] : "?", e->a, e->b);
+  }
+}
+
+static bool
+debug_enabled (void)
+{
+  static int enabled = -1;
+
+  if (enabled == -1) {
+    const char *domains = getenv ("G_MESSAGES_DEBUG");
+    char *copy;
+    char *domain;
+    char *saveptr;
+
+    enabled = 0;
+    if (domains == NULL) {
+      return false;
+    }
+
+    copy = strdup (domains);
+    for (domain = strtok_r (copy, " ,", &saveptr);
+         domain != NULL;
+         domain = strtok_r (NULL, " ,", &saveptr)) {
+      if (strcmp (domain, "all") == 0 || strcmp (domain, "libtl") == 0) {
+        enabled = 1;
+        break;
+      }
+    }
+    free (copy);
+  }
+
+  return enabled == 1;
+}
+
+void
+_tl_debug (const char *format,
+           ...)
+{
+  va_list args;
+
+  if (!debug_enabled ()) {
+    return;
+  }
+
+  va_start (args, format);
+  fputs ("libtl-DEBUG: ", stderr);
+  vfprintf (stderr, format, args);
+  fputc ('\n', stderr);
+  va_end (args);
+}
+
+#endif
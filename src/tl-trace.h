@@ -0,0 +1,95 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_TRACE_H__
+#define __TL_TRACE_H__
+
+#include <stdint.h>
+
+/*
+ * TRACE (event, a, b) records a parser event. Without LIBTL_DEBUG it
+ * expands to nothing, arguments included.
+ *
+ * In debug builds, events go into a per-thread ring buffer holding the last
+ * TRACE_RING_SIZE of them. Nothing gets formatted until someone asks, e.g.
+ * from gdb: call _tl_trace_dump ()
+ *
+ * _tl_debug () prints like g_debug () in the "libtl" domain, i.e. only with
+ * G_MESSAGES_DEBUG=libtl or all, without needing GLib.
+ */
+
+typedef enum {
+  TRACE_LINK_TAIL_START,  /* a: token index */
+  TRACE_FIRST_PAREN,      /* a: token index */
+  TRACE_CLOSE_PAREN,      /* a: token index, b: paren level before */
+  TRACE_LINK_TAIL_END,    /* a: token index, b: paren level */
+  TRACE_TLD_SEARCH,       /* a: token index, b: number of tokens */
+  TRACE_TLD_FOUND,        /* a: token index of the dot */
+  TRACE_TLD_INDEX,        /* a: token index of the last TLD dot */
+  TRACE_PORT,             /* a: token index after the port */
+  TRACE_LINK_END,         /* a: token index of the last link token */
+
+  N_TRACE_EVENTS
+} TraceEventType;
+
+#ifdef LIBTL_DEBUG
+
+#define TRACE_RING_SIZE 4096 /* Power of two */
+
+typedef struct {
+  uint32_t type;
+  uint32_t a;
+  uint64_t b;
+} TraceEvent;
+
+typedef struct {
+  TraceEvent events[TRACE_RING_SIZE];
+  uint64_t n_events; /* Total, the ring holds the last TRACE_RING_SIZE */
+} TraceRing;
+
+extern __thread TraceRing _tl_trace_ring;
+
+void _tl_trace_dump (void);
+void _tl_debug      (const char *format,
+                     ...)
+#ifdef __GNUC__
+  __attribute__ ((format (printf, 1, 2)))
+#endif
+  ;
+
+static inline void
+tl_trace_record (TraceEventType type,
+                 uint32_t       a,
+                 uint64_t       b)
+{
+  TraceEvent *e = &_tl_trace_ring.events[_tl_trace_ring.n_events & (TRACE_RING_SIZE - 1)];
+
+  e->type = type;
+  e->a = a;
+  e->b = b;
+  _tl_trace_ring.n_events ++;
+}
+
+#define TRACE(event, a, b) tl_trace_record ((event), (a), (b))
+
+#else
+
+#define TRACE(event, a, b) do { } while (0)
+
+#endif
+
+#endif
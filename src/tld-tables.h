@@ -0,0 +1,1341 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Generated by gen-tld-tables.py from tlds/, do not edit. */
+
+#ifndef __TL_TLD_TABLES_H__
+#define __TL_TLD_TABLES_H__
+
+static const char SPECIAL_CCTLDS_STRINGS[] =
+  "co\0"
+  "tv\0"
+;
+
+static const TldEntry SPECIAL_CCTLDS[] = {
+  {0, 2}, // co
+  {3, 2}, // tv
+};
+
+static const char GTLDS_STRINGS[] =
+  "삼성\0"
+  "集团\0"
+  "网络\0"
+  "网址\0"
+  "移动\0"
+  "游戏\0"
+  "机构\0"
+  "政务\0"
+  "世界\0"
+  "中信\0"
+  "公司\0"
+  "公益\0"
+  "在线\0"
+  "商标\0"
+  "商城\0"
+  "eus\0"
+  "vet\0"
+  "foo\0"
+  "uno\0"
+  "edu\0"
+  "wed\0"
+  "dnp\0"
+  "gal\0"
+  "gmo\0"
+  "wtc\0"
+  "gop\0"
+  "wtf\0"
+  "gov\0"
+  "xxx\0"
+  "xyz\0"
+  "hiv\0"
+  "ink\0"
+  "tel\0"
+  "int\0"
+  "tax\0"
+  "орг\0"
+  "kim\0"
+  "com\0"
+  "みんな\0"
+  "mil\0"
+  "ceo\0"
+  "cat\0"
+  "moe\0"
+  "中文网\0"
+  "net\0"
+  "cab\0"
+  "bzh\0"
+  "nhk\0"
+  "我爱你\0"
+  "nyc\0"
+  "bmw\0"
+  "soy\0"
+  "onl\0"
+  "biz\0"
+  "bio\0"
+  "org\0"
+  "bid\0"
+  "ovh\0"
+  "bar\0"
+  "axa\0"
+  "pro\0"
+  "pub\0"
+  "red\0"
+  "ren\0"
+  "rio\0"
+  "moda\0"
+  "navy\0"
+  "mobi\0"
+  "mini\0"
+  "voto\0"
+  "menu\0"
+  "meet\0"
+  "surf\0"
+  "luxe\0"
+  "link\0"
+  "limo\0"
+  "life\0"
+  "lgbt\0"
+  "land\0"
+  "kred\0"
+  "kiwi\0"
+  "jobs\0"
+  "info\0"
+  "tips\0"
+  "host\0"
+  "sohu\0"
+  "pics\0"
+  "haus\0"
+  "guru\0"
+  "town\0"
+  "pink\0"
+  "post\0"
+  "sexy\0"
+  "ruhr\0"
+  "toys\0"
+  "qpon\0"
+  "scot\0"
+  "fund\0"
+  "rest\0"
+  "rich\0"
+  "fish\0"
+  "vote\0"
+  "farm\0"
+  "fail\0"
+  "name\0"
+  "gift\0"
+  "дети\0"
+  "care\0"
+  "cash\0"
+  "wang\0"
+  "camp\0"
+  "aero\0"
+  "buzz\0"
+  "blue\0"
+  "wien\0"
+  "wiki\0"
+  "bike\0"
+  "club\0"
+  "best\0"
+  "desi\0"
+  "army\0"
+  "موقع\0"
+  "شبكة\0"
+  "arpa\0"
+  "asia\0"
+  "组织机构\0"
+  "beer\0"
+  "сайт\0"
+  "zone\0"
+  "coop\0"
+  "cool\0"
+  "cards\0"
+  "cheap\0"
+  "miami\0"
+  "citic\0"
+  "media\0"
+  "space\0"
+  "mango\0"
+  "ninja\0"
+  "build\0"
+  "black\0"
+  "lotto\0"
+  "solar\0"
+  "codes\0"
+  "paris\0"
+  "संगठन\0"
+  "lease\0"
+  "parts\0"
+  "koeln\0"
+  "بازار\0"
+  "photo\0"
+  "jetzt\0"
+  "place\0"
+  "shoes\0"
+  "autos\0"
+  "loans\0"
+  "press\0"
+  "audio\0"
+  "house\0"
+  "horse\0"
+  "homes\0"
+  "tirol\0"
+  "today\0"
+  "dance\0"
+  "tokyo\0"
+  "tools\0"
+  "guide\0"
+  "gripe\0"
+  "green\0"
+  "archi\0"
+  "works\0"
+  "globo\0"
+  "rehab\0"
+  "glass\0"
+  "gives\0"
+  "reise\0"
+  "trade\0"
+  "email\0"
+  "vegas\0"
+  "watch\0"
+  "actor\0"
+  "vodka\0"
+  "rocks\0"
+  "rodeo\0"
+  "bayern\0"
+  "physio\0"
+  "photos\0"
+  "social\0"
+  "quebec\0"
+  "berlin\0"
+  "reisen\0"
+  "agency\0"
+  "schule\0"
+  "repair\0"
+  "report\0"
+  "ryukyu\0"
+  "camera\0"
+  "active\0"
+  "nagoya\0"
+  "museum\0"
+  "expert\0"
+  "supply\0"
+  "monash\0"
+  "career\0"
+  "center\0"
+  "church\0"
+  "market\0"
+  "claims\0"
+  "maison\0"
+  "luxury\0"
+  "clinic\0"
+  "london\0"
+  "events\0"
+  "suzuki\0"
+  "coffee\0"
+  "lawyer\0"
+  "condos\0"
+  "kaufen\0"
+  "juegos\0"
+  "joburg\0"
+  "tattoo\0"
+  "онлайн\0"
+  "москва\0"
+  "insure\0"
+  "tienda\0"
+  "credit\0"
+  "yachts\0"
+  "hiphop\0"
+  "dating\0"
+  "gratis\0"
+  "degree\0"
+  "dental\0"
+  "global\0"
+  "direct\0"
+  "futbol\0"
+  "durban\0"
+  "travel\0"
+  "webcam\0"
+  "viajes\0"
+  "villas\0"
+  "vision\0"
+  "voyage\0"
+  "estate\0"
+  "voting\0"
+  "moscow\0"
+  "spiegel\0"
+  "support\0"
+  "surgery\0"
+  "systems\0"
+  "singles\0"
+  "shiksha\0"
+  "website\0"
+  "schmidt\0"
+  "limited\0"
+  "reviews\0"
+  "rentals\0"
+  "recipes\0"
+  "capital\0"
+  "careers\0"
+  "organic\0"
+  "okinawa\0"
+  "neustar\0"
+  "college\0"
+  "cologne\0"
+  "company\0"
+  "academy\0"
+  "kitchen\0"
+  "cooking\0"
+  "country\0"
+  "cruises\0"
+  "dentist\0"
+  "holiday\0"
+  "hamburg\0"
+  "guitars\0"
+  "digital\0"
+  "gallery\0"
+  "domains\0"
+  "frogans\0"
+  "exposed\0"
+  "florist\0"
+  "flights\0"
+  "fitness\0"
+  "finance\0"
+  "fishing\0"
+  "airforce\0"
+  "attorney\0"
+  "bargains\0"
+  "boutique\0"
+  "brussels\0"
+  "builders\0"
+  "capetown\0"
+  "catering\0"
+  "cleaning\0"
+  "clothing\0"
+  "computer\0"
+  "yokohama\0"
+  "democrat\0"
+  "diamonds\0"
+  "discount\0"
+  "engineer\0"
+  "exchange\0"
+  "feedback\0"
+  "saarland\0"
+  "ventures\0"
+  "training\0"
+  "graphics\0"
+  "holdings\0"
+  "lighting\0"
+  "mortgage\0"
+  "supplies\0"
+  "partners\0"
+  "software\0"
+  "pictures\0"
+  "plumbing\0"
+  "services\0"
+  "vacations\0"
+  "equipment\0"
+  "education\0"
+  "furniture\0"
+  "directory\0"
+  "institute\0"
+  "community\0"
+  "marketing\0"
+  "christmas\0"
+  "solutions\0"
+  "financial\0"
+  "vlaanderen\0"
+  "foundation\0"
+  "university\0"
+  "immobilien\0"
+  "industries\0"
+  "cuisinella\0"
+  "technology\0"
+  "creditcard\0"
+  "consulting\0"
+  "management\0"
+  "properties\0"
+  "republican\0"
+  "associates\0"
+  "enterprises\0"
+  "engineering\0"
+  "investments\0"
+  "contractors\0"
+  "motorcycles\0"
+  "photography\0"
+  "productions\0"
+  "blackfriday\0"
+  "accountants\0"
+  "versicherung\0"
+  "construction\0"
+  "international\0"
+  "cancerresearch\0"
+;
+
+static const TldEntry GTLDS[] = {
+  {0, 2}, // 삼성
+  {7, 2}, // 集团
+  {14, 2}, // 网络
+  {21, 2}, // 网址
+  {28, 2}, // 移动
+  {35, 2}, // 游戏
+  {42, 2}, // 机构
+  {49, 2}, // 政务
+  {56, 2}, // 世界
+  {63, 2}, // 中信
+  {70, 2}, // 公司
+  {77, 2}, // 公益
+  {84, 2}, // 在线
+  {91, 2}, // 商标
+  {98, 2}, // 商城
+  {105, 3}, // eus
+  {109, 3}, // vet
+  {113, 3}, // foo
+  {117, 3}, // uno
+  {121, 3}, // edu
+  {125, 3}, // wed
+  {129, 3}, // dnp
+  {133, 3}, // gal
+  {137, 3}, // gmo
+  {141, 3}, // wtc
+  {145, 3}, // gop
+  {149, 3}, // wtf
+  {153, 3}, // gov
+  {157, 3}, // xxx
+  {161, 3}, // xyz
+  {165, 3}, // hiv
+  {169, 3}, // ink
+  {173, 3}, // tel
+  {177, 3}, // int
+  {181, 3}, // tax
+  {185, 3}, // орг
+  {192, 3}, // kim
+  {196, 3}, // com
+  {200, 3}, // みんな
+  {210, 3}, // mil
+  {214, 3}, // ceo
+  {218, 3}, // cat
+  {222, 3}, // moe
+  {226, 3}, // 中文网
+  {236, 3}, // net
+  {240, 3}, // cab
+  {244, 3}, // bzh
+  {248, 3}, // nhk
+  {252, 3}, // 我爱你
+  {262, 3}, // nyc
+  {266, 3}, // bmw
+  {270, 3}, // soy
+  {274, 3}, // onl
+  {278, 3}, // biz
+  {282, 3}, // bio
+  {286, 3}, // org
+  {290, 3}, // bid
+  {294, 3}, // ovh
+  {298, 3}, // bar
+  {302, 3}, // axa
+  {306, 3}, // pro
+  {310, 3}, // pub
+  {314, 3}, // red
+  {318, 3}, // ren
+  {322, 3}, // rio
+  {326, 4}, // moda
+  {331, 4}, // navy
+  {336, 4}, // mobi
+  {341, 4}, // mini
+  {346, 4}, // voto
+  {351, 4}, // menu
+  {356, 4}, // meet
+  {361, 4}, // surf
+  {366, 4}, // luxe
+  {371, 4}, // link
+  {376, 4}, // limo
+  {381, 4}, // life
+  {386, 4}, // lgbt
+  {391, 4}, // land
+  {396, 4}, // kred
+  {401, 4}, // kiwi
+  {406, 4}, // jobs
+  {411, 4}, // info
+  {416, 4}, // tips
+  {421, 4}, // host
+  {426, 4}, // sohu
+  {431, 4}, // pics
+  {436, 4}, // haus
+  {441, 4}, // guru
+  {446, 4}, // town
+  {451, 4}, // pink
+  {456, 4}, // post
+  {461, 4}, // sexy
+  {466, 4}, // ruhr
+  {471, 4}, // toys
+  {476, 4}, // qpon
+  {481, 4}, // scot
+  {486, 4}, // fund
+  {491, 4}, // rest
+  {496, 4}, // rich
+  {501, 4}, // fish
+  {506, 4}, // vote
+  {511, 4}, // farm
+  {516, 4}, // fail
+  {521, 4}, // name
+  {526, 4}, // gift
+  {531, 4}, // дети
+  {540, 4}, // care
+  {545, 4}, // cash
+  {550, 4}, // wang
+  {555, 4}, // camp
+  {560, 4}, // aero
+  {565, 4}, // buzz
+  {570, 4}, // blue
+  {575, 4}, // wien
+  {580, 4}, // wiki
+  {585, 4}, // bike
+  {590, 4}, // club
+  {595, 4}, // best
+  {600, 4}, // desi
+  {605, 4}, // army
+  {610, 4}, // موقع
+  {619, 4}, // شبكة
+  {628, 4}, // arpa
+  {633, 4}, // asia
+  {638, 4}, // 组织机构
+  {651, 4}, // beer
+  {656, 4}, // сайт
+  {665, 4}, // zone
+  {670, 4}, // coop
+  {675, 4}, // cool
+  {680, 5}, // cards
+  {686, 5}, // cheap
+  {692, 5}, // miami
+  {698, 5}, // citic
+  {704, 5}, // media
+  {710, 5}, // space
+  {716, 5}, // mango
+  {722, 5}, // ninja
+  {728, 5}, // build
+  {734, 5}, // black
+  {740, 5}, // lotto
+  {746, 5}, // solar
+  {752, 5}, // codes
+  {758, 5}, // paris
+  {764, 5}, // संगठन
+  {780, 5}, // lease
+  {786, 5}, // parts
+  {792, 5}, // koeln
+  {798, 5}, // بازار
+  {809, 5}, // photo
+  {815, 5}, // jetzt
+  {821, 5}, // place
+  {827, 5}, // shoes
+  {833, 5}, // autos
+  {839, 5}, // loans
+  {845, 5}, // press
+  {851, 5}, // audio
+  {857, 5}, // house
+  {863, 5}, // horse
+  {869, 5}, // homes
+  {875, 5}, // tirol
+  {881, 5}, // today
+  {887, 5}, // dance
+  {893, 5}, // tokyo
+  {899, 5}, // tools
+  {905, 5}, // guide
+  {911, 5}, // gripe
+  {917, 5}, // green
+  {923, 5}, // archi
+  {929, 5}, // works
+  {935, 5}, // globo
+  {941, 5}, // rehab
+  {947, 5}, // glass
+  {953, 5}, // gives
+  {959, 5}, // reise
+  {965, 5}, // trade
+  {971, 5}, // email
+  {977, 5}, // vegas
+  {983, 5}, // watch
+  {989, 5}, // actor
+  {995, 5}, // vodka
+  {1001, 5}, // rocks
+  {1007, 5}, // rodeo
+  {1013, 6}, // bayern
+  {1020, 6}, // physio
+  {1027, 6}, // photos
+  {1034, 6}, // social
+  {1041, 6}, // quebec
+  {1048, 6}, // berlin
+  {1055, 6}, // reisen
+  {1062, 6}, // agency
+  {1069, 6}, // schule
+  {1076, 6}, // repair
+  {1083, 6}, // report
+  {1090, 6}, // ryukyu
+  {1097, 6}, // camera
+  {1104, 6}, // active
+  {1111, 6}, // nagoya
+  {1118, 6}, // museum
+  {1125, 6}, // expert
+  {1132, 6}, // supply
+  {1139, 6}, // monash
+  {1146, 6}, // career
+  {1153, 6}, // center
+  {1160, 6}, // church
+  {1167, 6}, // market
+  {1174, 6}, // claims
+  {1181, 6}, // maison
+  {1188, 6}, // luxury
+  {1195, 6}, // clinic
+  {1202, 6}, // london
+  {1209, 6}, // events
+  {1216, 6}, // suzuki
+  {1223, 6}, // coffee
+  {1230, 6}, // lawyer
+  {1237, 6}, // condos
+  {1244, 6}, // kaufen
+  {1251, 6}, // juegos
+  {1258, 6}, // joburg
+  {1265, 6}, // tattoo
+  {1272, 6}, // онлайн
+  {1285, 6}, // москва
+  {1298, 6}, // insure
+  {1305, 6}, // tienda
+  {1312, 6}, // credit
+  {1319, 6}, // yachts
+  {1326, 6}, // hiphop
+  {1333, 6}, // dating
+  {1340, 6}, // gratis
+  {1347, 6}, // degree
+  {1354, 6}, // dental
+  {1361, 6}, // global
+  {1368, 6}, // direct
+  {1375, 6}, // futbol
+  {1382, 6}, // durban
+  {1389, 6}, // travel
+  {1396, 6}, // webcam
+  {1403, 6}, // viajes
+  {1410, 6}, // villas
+  {1417, 6}, // vision
+  {1424, 6}, // voyage
+  {1431, 6}, // estate
+  {1438, 6}, // voting
+  {1445, 6}, // moscow
+  {1452, 7}, // spiegel
+  {1460, 7}, // support
+  {1468, 7}, // surgery
+  {1476, 7}, // systems
+  {1484, 7}, // singles
+  {1492, 7}, // shiksha
+  {1500, 7}, // website
+  {1508, 7}, // schmidt
+  {1516, 7}, // limited
+  {1524, 7}, // reviews
+  {1532, 7}, // rentals
+  {1540, 7}, // recipes
+  {1548, 7}, // capital
+  {1556, 7}, // careers
+  {1564, 7}, // organic
+  {1572, 7}, // okinawa
+  {1580, 7}, // neustar
+  {1588, 7}, // college
+  {1596, 7}, // cologne
+  {1604, 7}, // company
+  {1612, 7}, // academy
+  {1620, 7}, // kitchen
+  {1628, 7}, // cooking
+  {1636, 7}, // country
+  {1644, 7}, // cruises
+  {1652, 7}, // dentist
+  {1660, 7}, // holiday
+  {1668, 7}, // hamburg
+  {1676, 7}, // guitars
+  {1684, 7}, // digital
+  {1692, 7}, // gallery
+  {1700, 7}, // domains
+  {1708, 7}, // frogans
+  {1716, 7}, // exposed
+  {1724, 7}, // florist
+  {1732, 7}, // flights
+  {1740, 7}, // fitness
+  {1748, 7}, // finance
+  {1756, 7}, // fishing
+  {1764, 8}, // airforce
+  {1773, 8}, // attorney
+  {1782, 8}, // bargains
+  {1791, 8}, // boutique
+  {1800, 8}, // brussels
+  {1809, 8}, // builders
+  {1818, 8}, // capetown
+  {1827, 8}, // catering
+  {1836, 8}, // cleaning
+  {1845, 8}, // clothing
+  {1854, 8}, // computer
+  {1863, 8}, // yokohama
+  {1872, 8}, // democrat
+  {1881, 8}, // diamonds
+  {1890, 8}, // discount
+  {1899, 8}, // engineer
+  {1908, 8}, // exchange
+  {1917, 8}, // feedback
+  {1926, 8}, // saarland
+  {1935, 8}, // ventures
+  {1944, 8}, // training
+  {1953, 8}, // graphics
+  {1962, 8}, // holdings
+  {1971, 8}, // lighting
+  {1980, 8}, // mortgage
+  {1989, 8}, // supplies
+  {1998, 8}, // partners
+  {2007, 8}, // software
+  {2016, 8}, // pictures
+  {2025, 8}, // plumbing
+  {2034, 8}, // services
+  {2043, 9}, // vacations
+  {2053, 9}, // equipment
+  {2063, 9}, // education
+  {2073, 9}, // furniture
+  {2083, 9}, // directory
+  {2093, 9}, // institute
+  {2103, 9}, // community
+  {2113, 9}, // marketing
+  {2123, 9}, // christmas
+  {2133, 9}, // solutions
+  {2143, 9}, // financial
+  {2153, 10}, // vlaanderen
+  {2164, 10}, // foundation
+  {2175, 10}, // university
+  {2186, 10}, // immobilien
+  {2197, 10}, // industries
+  {2208, 10}, // cuisinella
+  {2219, 10}, // technology
+  {2230, 10}, // creditcard
+  {2241, 10}, // consulting
+  {2252, 10}, // management
+  {2263, 10}, // properties
+  {2274, 10}, // republican
+  {2285, 10}, // associates
+  {2296, 11}, // enterprises
+  {2308, 11}, // engineering
+  {2320, 11}, // investments
+  {2332, 11}, // contractors
+  {2344, 11}, // motorcycles
+  {2356, 11}, // photography
+  {2368, 11}, // productions
+  {2380, 11}, // blackfriday
+  {2392, 11}, // accountants
+  {2404, 12}, // versicherung
+  {2417, 12}, // construction
+  {2430, 13}, // international
+  {2444, 14}, // cancerresearch
+};
+
+static const char CCTLDS_STRINGS[] =
+  "sa\0"
+  "rw\0"
+  "ru\0"
+  "rs\0"
+  "ro\0"
+  "re\0"
+  "qa\0"
+  "py\0"
+  "pw\0"
+  "pt\0"
+  "ps\0"
+  "pr\0"
+  "pn\0"
+  "pm\0"
+  "pl\0"
+  "pk\0"
+  "ph\0"
+  "pg\0"
+  "pf\0"
+  "pe\0"
+  "pa\0"
+  "om\0"
+  "nz\0"
+  "nu\0"
+  "nr\0"
+  "np\0"
+  "no\0"
+  "nl\0"
+  "ni\0"
+  "ng\0"
+  "nf\0"
+  "li\0"
+  "ne\0"
+  "na\0"
+  "mz\0"
+  "my\0"
+  "mx\0"
+  "mw\0"
+  "mv\0"
+  "mu\0"
+  "mt\0"
+  "ms\0"
+  "mr\0"
+  "mq\0"
+  "mp\0"
+  "mo\0"
+  "mn\0"
+  "한국\0"
+  "ml\0"
+  "mk\0"
+  "mh\0"
+  "mg\0"
+  "mf\0"
+  "me\0"
+  "md\0"
+  "mc\0"
+  "ma\0"
+  "ly\0"
+  "lv\0"
+  "lu\0"
+  "lt\0"
+  "ls\0"
+  "lr\0"
+  "lk\0"
+  "nc\0"
+  "sb\0"
+  "香港\0"
+  "台灣\0"
+  "台湾\0"
+  "中國\0"
+  "中国\0"
+  "გე\0"
+  "рф\0"
+  "zw\0"
+  "zm\0"
+  "za\0"
+  "yt\0"
+  "ye\0"
+  "ws\0"
+  "wf\0"
+  "vu\0"
+  "vn\0"
+  "vi\0"
+  "vg\0"
+  "ve\0"
+  "vc\0"
+  "va\0"
+  "uz\0"
+  "uy\0"
+  "us\0"
+  "um\0"
+  "uk\0"
+  "ug\0"
+  "ua\0"
+  "tz\0"
+  "tw\0"
+  "tv\0"
+  "sc\0"
+  "tt\0"
+  "tp\0"
+  "to\0"
+  "tn\0"
+  "tm\0"
+  "tl\0"
+  "tk\0"
+  "tj\0"
+  "th\0"
+  "tg\0"
+  "tf\0"
+  "td\0"
+  "tc\0"
+  "sz\0"
+  "sy\0"
+  "sx\0"
+  "sv\0"
+  "su\0"
+  "st\0"
+  "ss\0"
+  "sr\0"
+  "so\0"
+  "sn\0"
+  "sm\0"
+  "sl\0"
+  "sk\0"
+  "sj\0"
+  "si\0"
+  "sh\0"
+  "sg\0"
+  "se\0"
+  "sd\0"
+  "tr\0"
+  "mm\0"
+  "dz\0"
+  "do\0"
+  "dm\0"
+  "dk\0"
+  "dj\0"
+  "de\0"
+  "cz\0"
+  "cy\0"
+  "cx\0"
+  "cw\0"
+  "cv\0"
+  "cu\0"
+  "cr\0"
+  "co\0"
+  "cn\0"
+  "cm\0"
+  "lc\0"
+  "ck\0"
+  "ci\0"
+  "ch\0"
+  "cg\0"
+  "cf\0"
+  "cd\0"
+  "cc\0"
+  "ca\0"
+  "bz\0"
+  "by\0"
+  "bw\0"
+  "bv\0"
+  "bt\0"
+  "bs\0"
+  "ec\0"
+  "br\0"
+  "bo\0"
+  "bn\0"
+  "bm\0"
+  "bl\0"
+  "bj\0"
+  "bi\0"
+  "bh\0"
+  "bg\0"
+  "bf\0"
+  "be\0"
+  "bd\0"
+  "bb\0"
+  "ba\0"
+  "az\0"
+  "ax\0"
+  "aw\0"
+  "au\0"
+  "at\0"
+  "as\0"
+  "ar\0"
+  "aq\0"
+  "ao\0"
+  "an\0"
+  "am\0"
+  "al\0"
+  "ai\0"
+  "ag\0"
+  "af\0"
+  "ae\0"
+  "ad\0"
+  "ac\0"
+  "bq\0"
+  "cl\0"
+  "lb\0"
+  "la\0"
+  "kz\0"
+  "ky\0"
+  "kw\0"
+  "kr\0"
+  "kp\0"
+  "kn\0"
+  "km\0"
+  "ki\0"
+  "kh\0"
+  "kg\0"
+  "ke\0"
+  "jp\0"
+  "ee\0"
+  "jm\0"
+  "je\0"
+  "it\0"
+  "is\0"
+  "ir\0"
+  "iq\0"
+  "io\0"
+  "in\0"
+  "im\0"
+  "il\0"
+  "ie\0"
+  "id\0"
+  "hu\0"
+  "ht\0"
+  "hr\0"
+  "hn\0"
+  "hm\0"
+  "jo\0"
+  "eg\0"
+  "eh\0"
+  "er\0"
+  "es\0"
+  "et\0"
+  "eu\0"
+  "fi\0"
+  "fj\0"
+  "fk\0"
+  "fm\0"
+  "fo\0"
+  "fr\0"
+  "ga\0"
+  "gb\0"
+  "gd\0"
+  "hk\0"
+  "gf\0"
+  "gg\0"
+  "gh\0"
+  "gi\0"
+  "gl\0"
+  "gm\0"
+  "gn\0"
+  "gp\0"
+  "gq\0"
+  "gr\0"
+  "gs\0"
+  "gt\0"
+  "gu\0"
+  "gw\0"
+  "gy\0"
+  "ge\0"
+  "мкд\0"
+  "мон\0"
+  "срб\0"
+  "укр\0"
+  "қаз\0"
+  "قطر\0"
+  "مصر\0"
+  "ไทย\0"
+  "新加坡\0"
+  "تونس\0"
+  "عمان\0"
+  "भारत\0"
+  "ভারত\0"
+  "ਭਾਰਤ\0"
+  "ભારત\0"
+  "ලංකා\0"
+  "ایران\0"
+  "بھارت\0"
+  "سودان\0"
+  "سورية\0"
+  "বাংলা\0"
+  "భారత్\0"
+  "الاردن\0"
+  "المغرب\0"
+  "امارات\0"
+  "فلسطين\0"
+  "مليسيا\0"
+  "இலங்கை\0"
+  "الجزائر\0"
+  "پاکستان\0"
+  "இந்தியா\0"
+  "السعودية\0"
+  "சிங்கப்பூர்\0"
+;
+
+static const TldEntry CCTLDS[] = {
+  {0, 2}, // sa
+  {3, 2}, // rw
+  {6, 2}, // ru
+  {9, 2}, // rs
+  {12, 2}, // ro
+  {15, 2}, // re
+  {18, 2}, // qa
+  {21, 2}, // py
+  {24, 2}, // pw
+  {27, 2}, // pt
+  {30, 2}, // ps
+  {33, 2}, // pr
+  {36, 2}, // pn
+  {39, 2}, // pm
+  {42, 2}, // pl
+  {45, 2}, // pk
+  {48, 2}, // ph
+  {51, 2}, // pg
+  {54, 2}, // pf
+  {57, 2}, // pe
+  {60, 2}, // pa
+  {63, 2}, // om
+  {66, 2}, // nz
+  {69, 2}, // nu
+  {72, 2}, // nr
+  {75, 2}, // np
+  {78, 2}, // no
+  {81, 2}, // nl
+  {84, 2}, // ni
+  {87, 2}, // ng
+  {90, 2}, // nf
+  {93, 2}, // li
+  {96, 2}, // ne
+  {99, 2}, // na
+  {102, 2}, // mz
+  {105, 2}, // my
+  {108, 2}, // mx
+  {111, 2}, // mw
+  {114, 2}, // mv
+  {117, 2}, // mu
+  {120, 2}, // mt
+  {123, 2}, // ms
+  {126, 2}, // mr
+  {129, 2}, // mq
+  {132, 2}, // mp
+  {135, 2}, // mo
+  {138, 2}, // mn
+  {141, 2}, // 한국
+  {148, 2}, // ml
+  {151, 2}, // mk
+  {154, 2}, // mh
+  {157, 2}, // mg
+  {160, 2}, // mf
+  {163, 2}, // me
+  {166, 2}, // md
+  {169, 2}, // mc
+  {172, 2}, // ma
+  {175, 2}, // ly
+  {178, 2}, // lv
+  {181, 2}, // lu
+  {184, 2}, // lt
+  {187, 2}, // ls
+  {190, 2}, // lr
+  {193, 2}, // lk
+  {196, 2}, // nc
+  {199, 2}, // sb
+  {202, 2}, // 香港
+  {209, 2}, // 台灣
+  {216, 2}, // 台湾
+  {223, 2}, // 中國
+  {230, 2}, // 中国
+  {237, 2}, // გე
+  {244, 2}, // рф
+  {249, 2}, // zw
+  {252, 2}, // zm
+  {255, 2}, // za
+  {258, 2}, // yt
+  {261, 2}, // ye
+  {264, 2}, // ws
+  {267, 2}, // wf
+  {270, 2}, // vu
+  {273, 2}, // vn
+  {276, 2}, // vi
+  {279, 2}, // vg
+  {282, 2}, // ve
+  {285, 2}, // vc
+  {288, 2}, // va
+  {291, 2}, // uz
+  {294, 2}, // uy
+  {297, 2}, // us
+  {300, 2}, // um
+  {303, 2}, // uk
+  {306, 2}, // ug
+  {309, 2}, // ua
+  {312, 2}, // tz
+  {315, 2}, // tw
+  {318, 2}, // tv
+  {321, 2}, // sc
+  {324, 2}, // tt
+  {327, 2}, // tp
+  {330, 2}, // to
+  {333, 2}, // tn
+  {336, 2}, // tm
+  {339, 2}, // tl
+  {342, 2}, // tk
+  {345, 2}, // tj
+  {348, 2}, // th
+  {351, 2}, // tg
+  {354, 2}, // tf
+  {357, 2}, // td
+  {360, 2}, // tc
+  {363, 2}, // sz
+  {366, 2}, // sy
+  {369, 2}, // sx
+  {372, 2}, // sv
+  {375, 2}, // su
+  {378, 2}, // st
+  {381, 2}, // ss
+  {384, 2}, // sr
+  {387, 2}, // so
+  {390, 2}, // sn
+  {393, 2}, // sm
+  {396, 2}, // sl
+  {399, 2}, // sk
+  {402, 2}, // sj
+  {405, 2}, // si
+  {408, 2}, // sh
+  {411, 2}, // sg
+  {414, 2}, // se
+  {417, 2}, // sd
+  {420, 2}, // tr
+  {423, 2}, // mm
+  {426, 2}, // dz
+  {429, 2}, // do
+  {432, 2}, // dm
+  {435, 2}, // dk
+  {438, 2}, // dj
+  {441, 2}, // de
+  {444, 2}, // cz
+  {447, 2}, // cy
+  {450, 2}, // cx
+  {453, 2}, // cw
+  {456, 2}, // cv
+  {459, 2}, // cu
+  {462, 2}, // cr
+  {465, 2}, // co
+  {468, 2}, // cn
+  {471, 2}, // cm
+  {474, 2}, // lc
+  {477, 2}, // ck
+  {480, 2}, // ci
+  {483, 2}, // ch
+  {486, 2}, // cg
+  {489, 2}, // cf
+  {492, 2}, // cd
+  {495, 2}, // cc
+  {498, 2}, // ca
+  {501, 2}, // bz
+  {504, 2}, // by
+  {507, 2}, // bw
+  {510, 2}, // bv
+  {513, 2}, // bt
+  {516, 2}, // bs
+  {519, 2}, // ec
+  {522, 2}, // br
+  {525, 2}, // bo
+  {528, 2}, // bn
+  {531, 2}, // bm
+  {534, 2}, // bl
+  {537, 2}, // bj
+  {540, 2}, // bi
+  {543, 2}, // bh
+  {546, 2}, // bg
+  {549, 2}, // bf
+  {552, 2}, // be
+  {555, 2}, // bd
+  {558, 2}, // bb
+  {561, 2}, // ba
+  {564, 2}, // az
+  {567, 2}, // ax
+  {570, 2}, // aw
+  {573, 2}, // au
+  {576, 2}, // at
+  {579, 2}, // as
+  {582, 2}, // ar
+  {585, 2}, // aq
+  {588, 2}, // ao
+  {591, 2}, // an
+  {594, 2}, // am
+  {597, 2}, // al
+  {600, 2}, // ai
+  {603, 2}, // ag
+  {606, 2}, // af
+  {609, 2}, // ae
+  {612, 2}, // ad
+  {615, 2}, // ac
+  {618, 2}, // bq
+  {621, 2}, // cl
+  {624, 2}, // lb
+  {627, 2}, // la
+  {630, 2}, // kz
+  {633, 2}, // ky
+  {636, 2}, // kw
+  {639, 2}, // kr
+  {642, 2}, // kp
+  {645, 2}, // kn
+  {648, 2}, // km
+  {651, 2}, // ki
+  {654, 2}, // kh
+  {657, 2}, // kg
+  {660, 2}, // ke
+  {663, 2}, // jp
+  {666, 2}, // ee
+  {669, 2}, // jm
+  {672, 2}, // je
+  {675, 2}, // it
+  {678, 2}, // is
+  {681, 2}, // ir
+  {684, 2}, // iq
+  {687, 2}, // io
+  {690, 2}, // in
+  {693, 2}, // im
+  {696, 2}, // il
+  {699, 2}, // ie
+  {702, 2}, // id
+  {705, 2}, // hu
+  {708, 2}, // ht
+  {711, 2}, // hr
+  {714, 2}, // hn
+  {717, 2}, // hm
+  {720, 2}, // jo
+  {723, 2}, // eg
+  {726, 2}, // eh
+  {729, 2}, // er
+  {732, 2}, // es
+  {735, 2}, // et
+  {738, 2}, // eu
+  {741, 2}, // fi
+  {744, 2}, // fj
+  {747, 2}, // fk
+  {750, 2}, // fm
+  {753, 2}, // fo
+  {756, 2}, // fr
+  {759, 2}, // ga
+  {762, 2}, // gb
+  {765, 2}, // gd
+  {768, 2}, // hk
+  {771, 2}, // gf
+  {774, 2}, // gg
+  {777, 2}, // gh
+  {780, 2}, // gi
+  {783, 2}, // gl
+  {786, 2}, // gm
+  {789, 2}, // gn
+  {792, 2}, // gp
+  {795, 2}, // gq
+  {798, 2}, // gr
+  {801, 2}, // gs
+  {804, 2}, // gt
+  {807, 2}, // gu
+  {810, 2}, // gw
+  {813, 2}, // gy
+  {816, 2}, // ge
+  {819, 3}, // мкд
+  {826, 3}, // мон
+  {833, 3}, // срб
+  {840, 3}, // укр
+  {847, 3}, // қаз
+  {854, 3}, // قطر
+  {861, 3}, // مصر
+  {868, 3}, // ไทย
+  {878, 3}, // 新加坡
+  {888, 4}, // تونس
+  {897, 4}, // عمان
+  {906, 4}, // भारत
+  {919, 4}, // ভারত
+  {932, 4}, // ਭਾਰਤ
+  {945, 4}, // ભારત
+  {958, 4}, // ලංකා
+  {971, 5}, // ایران
+  {982, 5}, // بھارت
+  {993, 5}, // سودان
+  {1004, 5}, // سورية
+  {1015, 5}, // বাংলা
+  {1031, 5}, // భారత్
+  {1047, 6}, // الاردن
+  {1060, 6}, // المغرب
+  {1073, 6}, // امارات
+  {1086, 6}, // فلسطين
+  {1099, 6}, // مليسيا
+  {1112, 6}, // இலங்கை
+  {1131, 7}, // الجزائر
+  {1146, 7}, // پاکستان
+  {1161, 7}, // இந்தியா
+  {1183, 8}, // السعودية
+  {1200, 11}, // சிங்கப்பூர்
+};
+
+#endif
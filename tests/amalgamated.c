@@ -0,0 +1,64 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* The amalgamated engine compiled right into this file, the way an
+ * embedding project would use it */
+#define TL_CORE_API static inline
+#include "libtweetlength_amalgamated.c"
+
+#include <glib.h>
+
+static gsize
+count (const char *text)
+{
+  return tl_core_count_characters (text, strlen (text), NULL);
+}
+
+static void
+basic (void)
+{
+  g_assert_cmpuint (count ("a 😭 a"), ==, 5);
+  g_assert_cmpuint (count ("twitter.com"), ==, 23);
+  g_assert_cmpuint (count ("@foo #bar https://example.com baz"), ==, 37);
+}
+
+static void
+entities (void)
+{
+  const char *text = "@foo #bar https://example.com baz";
+  TlEntity *entities;
+  size_t n_entities;
+
+  entities = tl_core_extract_entities (text, strlen (text), false, &n_entities, NULL, NULL);
+  g_assert_cmpuint (n_entities, ==, 3);
+  g_assert_cmpuint (entities[0].type, ==, TL_ENT_MENTION);
+  g_assert_cmpuint (entities[1].type, ==, TL_ENT_HASHTAG);
+  g_assert_cmpuint (entities[2].type, ==, TL_ENT_LINK);
+  free (entities);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/amalgamated/basic", basic);
+  g_test_add_func ("/amalgamated/entities", entities);
+
+  return g_test_run ();
+}
@@ -0,0 +1,370 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tl-core.h"
+#include "tl-kernels.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  guint n_allocs;
+  guint n_frees;
+} Counts;
+
+static void *
+counting_alloc (size_t  size,
+                void   *user_data)
+{
+  Counts *counts = user_data;
+
+  g_assert_cmpuint (size, >, 0);
+  counts->n_allocs ++;
+
+  return g_malloc (size);
+}
+
+static void
+counting_free (void *mem,
+               void *user_data)
+{
+  Counts *counts = user_data;
+
+  counts->n_frees ++;
+  g_free (mem);
+}
+
+static void
+allocator (void)
+{
+  const char *text = "@foo #bar https://example.com baz";
+  Counts counts = { 0, 0 };
+  const TlAllocator allocator = { counting_alloc, counting_free, &counts };
+  TlEntity *entities;
+  size_t n_entities;
+  size_t text_length;
+  GString *long_text;
+
+  // Fits the stack, nothing to allocate
+  g_assert_cmpuint (tl_core_count_characters (text, strlen (text), &allocator), ==, 37);
+  g_assert_cmpuint (counts.n_allocs, ==, 0);
+
+  // Just the result
+  entities = tl_core_extract_entities (text, strlen (text), FALSE, &n_entities, &text_length, &allocator);
+  g_assert_cmpuint (n_entities, ==, 3);
+  g_assert_cmpuint (text_length, ==, 37);
+  g_assert_cmpuint (entities[2].type, ==, TL_ENT_LINK);
+  g_assert_cmpuint (counts.n_allocs, ==, 1);
+  counting_free (entities, &counts);
+
+  long_text = g_string_new (NULL);
+  while (long_text->len < 10000) {
+    g_string_append (long_text, "a b. ");
+  }
+
+  g_assert_cmpuint (tl_core_count_characters (long_text->str, long_text->len, &allocator), ==, long_text->len);
+  g_assert_cmpuint (counts.n_allocs, >, 1);
+  g_assert_cmpuint (counts.n_frees, ==, counts.n_allocs);
+
+  g_string_free (long_text, TRUE);
+}
+
+static void
+default_allocator (void)
+{
+  const char *text = "#foo bar";
+  TlTokens *tokens;
+  TlEntity *entities;
+  size_t n_entities;
+
+  tokens = tl_core_tokenize (text, strlen (text), NULL);
+  entities = tl_core_tokens_extract_entities (tokens, &n_entities, NULL, NULL);
+  g_assert_cmpuint (n_entities, ==, 1);
+  g_assert_cmpuint (entities[0].type, ==, TL_ENT_HASHTAG);
+  g_assert_cmpuint (entities[0].length_in_bytes, ==, 4);
+
+  free (entities);
+  tl_core_tokens_free (tokens, NULL);
+}
+
+static void
+append_type (const TlEntity *entity,
+             size_t          n_entities,
+             void           *user_data)
+{
+  GArray *types = user_data;
+
+  g_assert_cmpuint (n_entities, ==, 3);
+  g_array_append_val (types, entity->type);
+}
+
+static void
+foreach_entity (void)
+{
+  const char *text = "#foo bar @baz";
+  GArray *types = g_array_new (FALSE, FALSE, sizeof (unsigned int));
+  size_t text_length;
+  size_t n;
+
+  n = tl_core_foreach_entity (text, strlen (text), TRUE, append_type, types, &text_length, NULL);
+  g_assert_cmpuint (n, ==, 3);
+  g_assert_cmpuint (types->len, ==, 3);
+  g_assert_cmpuint (g_array_index (types, unsigned int, 0), ==, TL_ENT_HASHTAG);
+  g_assert_cmpuint (g_array_index (types, unsigned int, 1), ==, TL_ENT_TEXT);
+  g_assert_cmpuint (g_array_index (types, unsigned int, 2), ==, TL_ENT_MENTION);
+  g_assert_cmpuint (text_length, ==, 13);
+
+  g_assert_cmpuint (tl_core_foreach_entity (NULL, 0, TRUE, append_type, types, NULL, NULL), ==, 0);
+  g_assert_cmpuint (types->len, ==, 3);
+
+  g_array_free (types, TRUE);
+}
+
+static gboolean
+in_run (unsigned char c,
+        gboolean      digits)
+{
+  static const char splits[] = ",./?():;=@#-_\n\t '\"$|&^%+*\\{}[]`~!";
+
+  if (c >= '0' && c <= '9') {
+    return digits;
+  }
+
+  return !digits && c != '\0' && strchr (splits, c) == NULL;
+}
+
+/* Like utf8_skip in tl-core.c */
+static size_t
+utf8_length (guchar c)
+{
+  if (c >= 0xf8) {
+    return 1;
+  } else if (c >= 0xf0) {
+    return 4;
+  } else if (c >= 0xe0) {
+    return 3;
+  } else if (c >= 0xc0) {
+    return 2;
+  }
+
+  return 1;
+}
+
+/*
+ * Every level the CPU can run has to count the same tokens as the scalar
+ * one, and its runs have to be what the tokenizer expects. Invalid UTF-8
+ * included, the runs just have to stop before it.
+ */
+static void
+kernels (void)
+{
+  static const char * const pieces[] = {
+    "a", "foo", "1", "42", " ", ".", "#", "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x8e\x89",
+    "\x80", "\xc3", "\xf8",
+  };
+  const TlKernels *scalar = _tl_kernels_get ("scalar");
+  guint level;
+
+  g_assert_nonnull (scalar);
+  g_assert_nonnull (_tl_kernels ());
+
+  for (level = 0; _tl_kernel_levels[level] != NULL; level ++) {
+    const TlKernels *k = _tl_kernels_get (_tl_kernel_levels[level]);
+    guint round;
+
+    if (k == NULL) {
+      g_test_message ("Level %s not supported here", _tl_kernel_levels[level]);
+      continue;
+    }
+
+    for (round = 0; round < 2000; round ++) {
+      GString *s = g_string_new (NULL);
+      // Few different pieces for long runs, invalid UTF-8 only sometimes
+      const guint n_pieces = round % 4 == 0 ? G_N_ELEMENTS (pieces) : G_N_ELEMENTS (pieces) - 3;
+      const guint first = g_test_rand_int_range (0, n_pieces);
+      const guint n_used = g_test_rand_int_range (1, 4);
+      const guint length = g_test_rand_int_range (0, 300);
+      gsize offset;
+
+      while (s->len < length) {
+        g_string_append (s, pieces[(first + g_test_rand_int_range (0, n_used)) % n_pieces]);
+      }
+
+      g_assert_cmpuint (k->count_tokens (s->str, s->len), ==, scalar->count_tokens (s->str, s->len));
+
+      for (offset = 0; offset < s->len && k->scan_run != NULL; offset ++) {
+        const char *p = s->str + offset;
+        const gboolean digits = p[0] >= '0' && p[0] <= '9';
+        size_t n_characters;
+        size_t n;
+        size_t i;
+
+        n = k->scan_run (p, s->len - offset, digits, &n_characters);
+
+        for (i = 0; i < n; i ++) {
+          g_assert_true (in_run (p[i], digits));
+        }
+
+        // Stepping through the run like the tokenizer has to end right on
+        // the next character and agree on the number of characters
+        if (n > 0) {
+          size_t n_steps = 0;
+
+          g_assert_true (offset + n == s->len || ((guchar)p[n] & 0xc0) != 0x80);
+          for (i = 0; i < n; n_steps ++) {
+            i += utf8_length ((guchar)p[i]);
+          }
+          g_assert_cmpuint (i, ==, n);
+          g_assert_cmpuint (n_characters, ==, n_steps);
+        }
+      }
+
+      g_string_free (s, TRUE);
+    }
+  }
+}
+
+/*
+ * Every level's lanes have to count what the bytes say and pick out dotted
+ * and invalid texts, for any bytes and any mix of lengths. Each text has an allocation of its own, so reading
+ * past one trips ASan.
+ */
+static void
+lanes (void)
+{
+  static const char * const pieces[] = {
+    "a", "foo bar", "1", ".", "@", "#", "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x8e\x89", "\x80", "\xff",
+    "\xc0\xae", "\xe0\x80\xae", "\xed\xa0\x80",
+  };
+  guint level;
+
+  for (level = 0; _tl_kernel_levels[level] != NULL; level ++) {
+    const TlKernels *k = _tl_kernels_get (_tl_kernel_levels[level]);
+    guint round;
+
+    if (k == NULL) {
+      continue;
+    }
+
+    for (round = 0; round < 500; round ++) {
+      const guint n_texts = g_test_rand_int_range (1, TL_KERNEL_LANES + 1);
+      char *texts[TL_KERNEL_LANES];
+      size_t lengths[TL_KERNEL_LANES];
+      size_t n_characters[TL_KERNEL_LANES];
+      uint32_t expected_parse = 0;
+      uint32_t parse;
+      guint lane;
+
+      for (lane = 0; lane < n_texts; lane ++) {
+        // Mostly short, sometimes a lot longer than the rest
+        const guint length = g_test_rand_int_range (0, lane % 5 == 0 ? 300 : 40);
+        GString *s = g_string_new (NULL);
+
+        while (s->len < length) {
+          g_string_append (s, pieces[g_test_rand_int_range (0, round % 3 == 0 ? G_N_ELEMENTS (pieces) : 3)]);
+        }
+
+        lengths[lane] = s->len;
+        texts[lane] = g_malloc (MAX (s->len, 1));
+        memcpy (texts[lane], s->str, s->len);
+        g_string_free (s, TRUE);
+      }
+
+      parse = k->scan_lanes ((const char * const *)texts, lengths, n_texts, n_characters);
+
+      for (lane = 0; lane < n_texts; lane ++) {
+        size_t expected = 0;
+        size_t i;
+
+        for (i = 0; i < lengths[lane]; i ++) {
+          expected += ((guchar)texts[lane][i] & 0xc0) != 0x80;
+        }
+
+        g_assert_cmpuint (n_characters[lane], ==, expected);
+        if (memchr (texts[lane], '.', lengths[lane]) != NULL ||
+            !g_utf8_validate (texts[lane], lengths[lane], NULL)) {
+          expected_parse |= 1u << lane;
+        }
+        g_free (texts[lane]);
+      }
+
+      g_assert_cmpuint (parse, ==, expected_parse);
+    }
+  }
+}
+
+static void
+count_batch (void)
+{
+  // A length of -1 means strlen ()
+  static const struct {
+    const char *text;
+    gssize length;
+  } texts[] = {
+    { "abc", -1 }, { "", -1 }, { NULL, 0 }, { "@foo #bar", -1 }, { "https://example.com", -1 },
+    { "\0abc", sizeof ("\0abc") - 1 }, { "h\xc3\xa9llo w\xc3\xb6rld", -1 }, { "a.b", -1 },
+    { "#tag", -1 }, { "example.com is a link", -1 }, { "\xf0\x9f\x8e\x89 \xe6\x97\xa5", -1 },
+    { "1.5", -1 }, { "no dots here", -1 }, { "foo@bar.com", -1 }, { "t.co", -1 }, { "x", -1 },
+    { "The end.", -1 }, { NULL, 0 }, { "example\xc0\xae" "com", -1 }, { "\xe6\x97", -1 },
+    { "\x80\x80" "abc", -1 },
+  };
+  size_t lengths[G_N_ELEMENTS (texts) + 1];
+  size_t out[G_N_ELEMENTS (texts) + 1];
+  const char *all[G_N_ELEMENTS (texts) + 1];
+  GString *long_text = g_string_new (NULL);
+  guint i;
+
+  // Longer than the lanes take
+  while (long_text->len < 3000) {
+    g_string_append (long_text, "word example.com \xc3\xa9 ");
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i ++) {
+    all[i] = texts[i].text;
+    lengths[i] = texts[i].length >= 0 ? (size_t)texts[i].length : strlen (texts[i].text);
+  }
+  all[i] = long_text->str;
+  lengths[i] = long_text->len;
+
+  tl_core_count_characters_batch (all, lengths, G_N_ELEMENTS (all), out, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (all); i ++) {
+    g_assert_cmpuint (out[i], ==, tl_core_count_characters (all[i], lengths[i], NULL));
+  }
+  g_assert_cmpuint (out[4], ==, 23);
+
+  // Nothing to do, nothing touched
+  tl_core_count_characters_batch (NULL, NULL, 0, NULL, NULL);
+
+  g_string_free (long_text, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/core/allocator", allocator);
+  g_test_add_func ("/core/default-allocator", default_allocator);
+  g_test_add_func ("/core/foreach-entity", foreach_entity);
+  g_test_add_func ("/core/kernels", kernels);
+  g_test_add_func ("/core/lanes", lanes);
+  g_test_add_func ("/core/count-batch", count_batch);
+
+  return g_test_run ();
+}
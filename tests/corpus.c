@@ -0,0 +1,212 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libtweetlength.h"
+#include "tl-corpus.h"
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static void
+empty (void)
+{
+  TlCorpusStats stats;
+
+  tl_corpus_scan (NULL, 0, 1, NULL, NULL, &stats);
+  g_assert_cmpint (stats.n_records, ==, 0);
+
+  tl_corpus_scan ("", 0, 4, NULL, NULL, &stats);
+  g_assert_cmpint (stats.n_records, ==, 0);
+  g_assert_cmpint (stats.n_characters, ==, 0);
+}
+
+static void
+lines (void)
+{
+  const char *corpus = "abc\n"
+                       "@foo #bar\r\n"
+                       "\n"
+                       "https://twitter.com";
+  TlCorpusStats stats;
+
+  tl_corpus_scan (corpus, strlen (corpus), 1, NULL, NULL, &stats);
+  g_assert_cmpint (stats.n_records, ==, 4);
+  g_assert_cmpint (stats.n_skipped, ==, 0);
+  g_assert_cmpint (stats.n_bytes, ==, 3 + 9 + 0 + 19);
+  g_assert_cmpint (stats.n_characters, ==, 3 + 9 + 0 + 23);
+  g_assert_cmpint (stats.max_characters, ==, 23);
+  g_assert_cmpint (stats.n_mentions, ==, 1);
+  g_assert_cmpint (stats.n_hashtags, ==, 1);
+  g_assert_cmpint (stats.n_links, ==, 1);
+}
+
+static void
+threads (void)
+{
+  GString *corpus = g_string_new (NULL);
+  TlCorpusStats single;
+  TlCorpusStats multi;
+  guint i;
+
+  // Big enough to get split into several shards
+  for (i = 0; i < 100000; i ++) {
+    g_string_append_printf (corpus, "%u @mention%u twitter.com/%u #tag\n", i, i, i);
+  }
+
+  tl_corpus_scan (corpus->str, corpus->len, 1, NULL, NULL, &single);
+  tl_corpus_scan (corpus->str, corpus->len, 4, NULL, NULL, &multi);
+
+  g_assert_cmpint (single.n_records, ==, 100000);
+  g_assert_cmpint (single.n_mentions, ==, 100000);
+  g_assert_cmpint (single.n_links, ==, 100000);
+  g_assert_cmpint (single.n_hashtags, ==, 100000);
+  g_assert (memcmp (&single, &multi, sizeof (TlCorpusStats)) == 0);
+
+  g_string_free (corpus, TRUE);
+}
+
+static gboolean
+second_word (const char  *record,
+             gsize        record_length,
+             GString     *scratch,
+             const char **out_text,
+             gsize       *out_text_length,
+             gpointer     user_data)
+{
+  const char *space = memchr (record, ' ', record_length);
+
+  if (space == NULL) {
+    return FALSE;
+  }
+
+  *out_text = space + 1;
+  *out_text_length = record_length - (space + 1 - record);
+  return TRUE;
+}
+
+static void
+text_func (void)
+{
+  const char *corpus = "skip\n"
+                       "1 @foo\n"
+                       "2 abcd\n";
+  TlCorpusStats stats;
+
+  tl_corpus_scan (corpus, strlen (corpus), 2, second_word, NULL, &stats);
+  g_assert_cmpint (stats.n_records, ==, 3);
+  g_assert_cmpint (stats.n_skipped, ==, 1);
+  g_assert_cmpint (stats.n_characters, ==, 8);
+  g_assert_cmpint (stats.n_mentions, ==, 1);
+}
+
+static void
+file (void)
+{
+  const char *corpus = "foo bar\n#baz";
+  GError *error = NULL;
+  TlCorpusStats stats;
+  char *filename;
+  int fd;
+
+  fd = g_file_open_tmp ("tl-corpus-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+  g_file_set_contents (filename, corpus, -1, &error);
+  g_assert_no_error (error);
+
+  g_assert (tl_corpus_scan_file (filename, 0, NULL, NULL, &stats, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (stats.n_records, ==, 2);
+  g_assert_cmpint (stats.n_characters, ==, 11);
+  g_assert_cmpint (stats.n_hashtags, ==, 1);
+
+  g_unlink (filename);
+  g_free (filename);
+
+  g_assert (!tl_corpus_scan_file ("/does/not/exist", 1, NULL, NULL, &stats, &error));
+  g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+  g_error_free (error);
+}
+
+/*
+ * Files that fill their last page exactly, ending in records with a
+ * truncated character. Reading past the mapping has to fault for this to
+ * catch anything, so the file is mapped into a hole right below an
+ * inaccessible page, where Linux puts the next small mapping.
+ */
+static void
+page_sized_file (void)
+{
+  const char * const tails[] = { "\xf0\n", "\xf0\r\n", "\xe6\x97\n", "\xf0", "\xf0\r" };
+  const gsize page_size = sysconf (_SC_PAGESIZE);
+  guint t;
+
+  for (t = 0; t < G_N_ELEMENTS (tails); t ++) {
+    const gsize tail_length = strlen (tails[t]);
+    GError *error = NULL;
+    TlCorpusStats file_stats, stats;
+    char *data = g_malloc0 (page_size + 8);
+    char *filename;
+    void *guard;
+    gsize i;
+    int fd;
+
+    for (i = 0; i < page_size - tail_length; i ++) {
+      data[i] = i % 64 == 63 ? '\n' : 'a';
+    }
+    memcpy (data + page_size - tail_length, tails[t], tail_length);
+
+    fd = g_file_open_tmp ("tl-corpus-XXXXXX", &filename, &error);
+    g_assert_no_error (error);
+    close (fd);
+    g_file_set_contents (filename, data, page_size, &error);
+    g_assert_no_error (error);
+
+    guard = mmap (NULL, 2 * page_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    g_assert (guard != MAP_FAILED);
+    munmap (guard, page_size);
+
+    g_assert (tl_corpus_scan_file (filename, 1, NULL, NULL, &file_stats, &error));
+    g_assert_no_error (error);
+    munmap ((char *)guard + page_size, page_size);
+
+    // The same from memory that has padding after it
+    tl_corpus_scan (data, page_size, 1, NULL, NULL, &stats);
+    g_assert_cmpint (file_stats.n_records, ==, stats.n_records);
+    g_assert_cmpint (file_stats.n_characters, ==, stats.n_characters);
+
+    g_unlink (filename);
+    g_free (filename);
+    g_free (data);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/corpus/empty", empty);
+  g_test_add_func ("/corpus/lines", lines);
+  g_test_add_func ("/corpus/threads", threads);
+  g_test_add_func ("/corpus/text-func", text_func);
+  g_test_add_func ("/corpus/file", file);
+  g_test_add_func ("/corpus/page-sized-file", page_sized_file);
+
+  return g_test_run ();
+}
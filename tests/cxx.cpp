@@ -0,0 +1,204 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "libtweetlength.hpp"
+#include <glib.h>
+#include <array>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+static_assert (tl::to_entity (TlEntity { TL_ENT_MENTION, "@foo", 4, 1, 4 }).type == tl::EntityType::mention);
+static_assert (tl::to_entity (TlEntity { TL_ENT_MENTION, "@foo", 4, 1, 4 }).text == "@foo");
+
+// Counts what is still allocated, so leaks and size mismatches show up
+class CountingResource : public std::pmr::memory_resource {
+public:
+  std::size_t n_allocs = 0;
+  std::size_t n_bytes = 0;
+
+private:
+  void *
+  do_allocate (std::size_t bytes,
+               std::size_t alignment) override
+  {
+    n_allocs ++;
+    n_bytes += bytes;
+    return std::pmr::new_delete_resource ()->allocate (bytes, alignment);
+  }
+
+  void
+  do_deallocate (void        *mem,
+                 std::size_t  bytes,
+                 std::size_t  alignment) override
+  {
+    g_assert_cmpuint (n_bytes, >=, bytes);
+    n_bytes -= bytes;
+    std::pmr::new_delete_resource ()->deallocate (mem, bytes, alignment);
+  }
+
+  bool
+  do_is_equal (const std::pmr::memory_resource &other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+static void
+count (void)
+{
+  g_assert_cmpuint (tl::count (""), ==, 0);
+  g_assert_cmpuint (tl::count ("abc"), ==, 3);
+  g_assert_cmpuint (tl::count ("@foo #bar https://example.com baz"), ==, 37);
+
+  const std::array<std::string_view, 3> texts = { "abc", "@foo #bar https://example.com baz", "" };
+  std::array<std::size_t, 3> lengths;
+
+  tl::count (texts, lengths);
+  g_assert_cmpuint (lengths[0], ==, 3);
+  g_assert_cmpuint (lengths[1], ==, 37);
+  g_assert_cmpuint (lengths[2], ==, 0);
+}
+
+static void
+extract (void)
+{
+  const std::string_view text = "@foo #bar https://example.com baz";
+  std::size_t text_length;
+  auto entities = tl::extract (text, std::pmr::get_default_resource (), &text_length);
+
+  g_assert_cmpuint (text_length, ==, 37);
+  g_assert_cmpuint (entities.size (), ==, 3);
+  g_assert (entities[0].type == tl::EntityType::mention);
+  g_assert (entities[0].text == "@foo");
+  g_assert (entities[1].type == tl::EntityType::hashtag);
+  g_assert (entities[1].text == "#bar");
+  g_assert (entities[2].type == tl::EntityType::link);
+  g_assert (entities[2].text == "https://example.com");
+  g_assert_cmpuint (entities[2].start_character_index, ==, 10);
+  g_assert_cmpuint (entities[2].length_in_characters, ==, 19);
+
+  // Views into the text, not copies
+  g_assert (entities[0].text.data () == text.data ());
+
+  entities = tl::extract_and_text (text);
+  g_assert_cmpuint (entities.size (), ==, 4);
+  g_assert (entities[3].type == tl::EntityType::text);
+  g_assert (entities[3].text == "baz");
+
+  g_assert (tl::extract ("").empty ());
+  g_assert (tl::extract ("no entities here").empty ());
+}
+
+static void
+memory_resource (void)
+{
+  CountingResource counting;
+  std::string long_text;
+
+  // Tweet-sized text only needs the result, reserved exactly once
+  {
+    auto entities = tl::extract ("#a #b #c #d", &counting);
+
+    g_assert_cmpuint (entities.size (), ==, 4);
+    g_assert_cmpuint (counting.n_allocs, ==, 1);
+    g_assert (entities.get_allocator ().resource () == &counting);
+  }
+  g_assert_cmpuint (counting.n_bytes, ==, 0);
+
+  // Scratch buffers for long text come from the resource too
+  while (long_text.size () < 10000) {
+    long_text += "#a b. ";
+  }
+  counting.n_allocs = 0;
+  g_assert_cmpuint (tl::count (long_text, &counting), ==, long_text.size ());
+  g_assert_cmpuint (counting.n_allocs, >, 0);
+  g_assert_cmpuint (counting.n_bytes, ==, 0);
+
+  // A buffer on the stack is enough, nothing reaches the upstream resource
+  {
+    std::array<std::byte, 1024> buffer;
+    std::pmr::monotonic_buffer_resource stack_resource (buffer.data (), buffer.size (),
+                                                        std::pmr::null_memory_resource ());
+    auto entities = tl::extract ("@foo #bar https://example.com baz", &stack_resource);
+
+    g_assert_cmpuint (entities.size (), ==, 3);
+  }
+}
+
+static void
+for_each_entity (void)
+{
+  std::size_t n_calls = 0;
+  std::size_t n;
+
+  n = tl::for_each_entity ("#a b #c", [&n_calls] (const tl::Entity &entity, std::size_t n_entities) {
+    g_assert (entity.type == tl::EntityType::hashtag);
+    g_assert_cmpuint (n_entities, ==, 2);
+    n_calls ++;
+  });
+  g_assert_cmpuint (n, ==, 2);
+  g_assert_cmpuint (n_calls, ==, 2);
+
+  // Thrown from the callback, rethrown after the core returned
+  n_calls = 0;
+  try {
+    tl::for_each_entity ("#a b #c", [&n_calls] (const tl::Entity &) {
+      n_calls ++;
+      throw std::runtime_error ("stop");
+    });
+    g_assert_not_reached ();
+  } catch (const std::runtime_error &) {
+  }
+  g_assert_cmpuint (n_calls, ==, 1);
+}
+
+static void
+entities_view (void)
+{
+  const char *text = "@foo bar #baz";
+  TlEntity *entities;
+  std::size_t n_entities;
+  std::size_t i = 0;
+
+  entities = tl_core_extract_entities (text, strlen (text), false, &n_entities, nullptr, nullptr);
+  g_assert_cmpuint (n_entities, ==, 2);
+
+  for (const tl::Entity &entity : tl::entities ({ entities, n_entities })) {
+    g_assert (entity.text.data () == entities[i].start);
+    g_assert_cmpuint (entity.text.size (), ==, entities[i].length_in_bytes);
+    i ++;
+  }
+  g_assert_cmpuint (i, ==, 2);
+
+  std::free (entities);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/cxx/count", count);
+  g_test_add_func ("/cxx/extract", extract);
+  g_test_add_func ("/cxx/memory-resource", memory_resource);
+  g_test_add_func ("/cxx/for-each-entity", for_each_entity);
+  g_test_add_func ("/cxx/entities-view", entities_view);
+
+  return g_test_run ();
+}
@@ -0,0 +1,388 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Runs the library and the reference engine (src/tl-reference.c) on random
+ * text, the fuzzing corpora and mutations of them, and fails on the first
+ * difference in counts or in any field of any entity. Differences get shrunk
+ * to a minimal input before they are reported.
+ *
+ * Run with -m slow for many more inputs.
+ */
+
+#include "libtweetlength.h"
+#include "tl-reference.h"
+#include <string.h>
+
+static const char * const pieces[] = {
+  "a", "b", "foo", "http", "https", "www", "com", "org", "co", "de", "jp", "xn--p1ai",
+  "1", "23", "8080", "_", "-", ".", ",", ":", "/", "//", "?", "=", "&", "(", ")",
+  "@", "#", "'", "\"", "!", "~", "$", "%", " ", "  ", "\n", "\t",
+  "\xc3\xa9", "\xc3\xa4", "\xe6\x97\xa5", "\xe6\x9c\xac", "\xf0\x9f\x8e\x89", "\xd9\x85",
+  "://", "@foo", "#bar", "example.com", "t.co", "a.b.c",
+};
+
+/* Everything one call of an API returns */
+typedef struct {
+  TlEntity *entities;
+  gsize n_entities;
+  gsize text_length;
+} Result;
+
+static gboolean
+same_result (const Result *a,
+             const Result *b)
+{
+  gsize i;
+
+  if (a->n_entities != b->n_entities ||
+      a->text_length != b->text_length) {
+    return FALSE;
+  }
+
+  // Both ran on the same text, so the start pointers have to match exactly
+  for (i = 0; i < a->n_entities; i ++) {
+    const TlEntity *x = &a->entities[i];
+    const TlEntity *y = &b->entities[i];
+
+    if (x->type != y->type ||
+        x->start != y->start ||
+        x->length_in_bytes != y->length_in_bytes ||
+        x->start_character_index != y->start_character_index ||
+        x->length_in_characters != y->length_in_characters) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Returns: %TRUE if every API of the library agrees with the reference on
+ *   the first @length bytes of @text.
+ */
+static gboolean
+engines_agree (const char *text,
+               gsize       length)
+{
+  gboolean agree = TRUE;
+  int extract_text;
+
+  if (tl_count_characters_n (text, length) != tl_reference_count_characters_n (text, length)) {
+    return FALSE;
+  }
+
+  for (extract_text = 0; extract_text <= 1 && agree; extract_text ++) {
+    Result expected;
+    Result actual;
+
+    expected.entities = tl_reference_extract_entities_n (text, length, extract_text,
+                                                         &expected.n_entities,
+                                                         &expected.text_length);
+    if (extract_text) {
+      actual.entities = tl_extract_entities_and_text_n (text, length, &actual.n_entities,
+                                                        &actual.text_length);
+    } else {
+      actual.entities = tl_extract_entities_n (text, length, &actual.n_entities,
+                                               &actual.text_length);
+    }
+    agree = same_result (&expected, &actual);
+    g_free (actual.entities);
+
+    // The staged API has to give the same as tl_extract_entities_n()
+    if (agree && !extract_text && length > 0) {
+      TlTokens *tokens = tl_tokenize_n (text, length);
+
+      actual.entities = tl_tokens_extract_entities (tokens, &actual.n_entities,
+                                                    &actual.text_length);
+      agree = same_result (&expected, &actual);
+      g_free (actual.entities);
+      tl_tokens_free (tokens);
+    }
+
+    g_free (expected.entities);
+  }
+
+  return agree;
+}
+
+/*
+ * Removes ever smaller runs of characters from @text as long as the engines
+ * still disagree on it.
+ */
+static char *
+shrink (const char *text,
+        gsize       length)
+{
+  char *current = g_strndup (text, length);
+  gsize n_chars = g_utf8_strlen (current, -1);
+  gsize chunk;
+
+  for (chunk = MAX (n_chars / 2, 1); chunk > 0; chunk /= 2) {
+    gsize start = 0;
+
+    while (start + chunk <= n_chars) {
+      const char *cut_start = g_utf8_offset_to_pointer (current, start);
+      const char *cut_end = g_utf8_offset_to_pointer (current, start + chunk);
+      GString *candidate = g_string_new_len (current, cut_start - current);
+
+      g_string_append (candidate, cut_end);
+
+      if (!engines_agree (candidate->str, candidate->len)) {
+        g_free (current);
+        current = g_string_free (candidate, FALSE);
+        n_chars -= chunk;
+      } else {
+        g_string_free (candidate, TRUE);
+        start ++;
+      }
+    }
+  }
+
+  return current;
+}
+
+static gboolean
+check (const char *text,
+       gsize       length)
+{
+  char *shrunk;
+  char *escaped;
+
+  if (engines_agree (text, length)) {
+    return TRUE;
+  }
+
+  shrunk = shrink (text, length);
+  escaped = g_strescape (shrunk, NULL);
+  g_test_message ("Engines disagree on \"%s\" (shrunk from %" G_GSIZE_FORMAT " bytes)",
+                  escaped, length);
+  g_printerr ("Engines disagree on \"%s\"\n", escaped);
+  g_test_fail ();
+
+  g_free (escaped);
+  g_free (shrunk);
+
+  return FALSE;
+}
+
+static void
+append_random_pieces (GString *s,
+                      guint    n_pieces)
+{
+  // Most inputs only use a few pieces, so they repeat like real text does
+  const guint n_used = g_test_rand_int_range (1, G_N_ELEMENTS (pieces) + 1);
+  const guint first = g_test_rand_int_range (0, G_N_ELEMENTS (pieces));
+  guint i;
+
+  for (i = 0; i < n_pieces; i ++) {
+    g_string_append (s, pieces[(first + g_test_rand_int_range (0, n_used)) % G_N_ELEMENTS (pieces)]);
+  }
+}
+
+static void
+random_text (void)
+{
+  const guint n_inputs = g_test_slow () ? 1000000 : 20000;
+  GString *s = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; i < n_inputs; i ++) {
+    g_string_truncate (s, 0);
+    append_random_pieces (s, g_test_rand_int_range (0, 80));
+
+    if (!check (s->str, s->len)) {
+      break;
+    }
+  }
+
+  g_string_free (s, TRUE);
+}
+
+static void
+random_characters (void)
+{
+  const guint n_inputs = g_test_slow () ? 200000 : 5000;
+  GString *s = g_string_new (NULL);
+  guint i, k;
+
+  for (i = 0; i < n_inputs; i ++) {
+    const guint n_chars = g_test_rand_int_range (0, 64);
+
+    g_string_truncate (s, 0);
+    for (k = 0; k < n_chars; k ++) {
+      gunichar c;
+
+      // Mostly ASCII, where all the rules are
+      if (g_test_rand_int_range (0, 4) != 0) {
+        c = g_test_rand_int_range (1, 128);
+      } else {
+        do {
+          c = g_test_rand_int_range (128, 0x110000);
+        } while (c >= 0xD800 && c <= 0xDFFF);
+      }
+      g_string_append_unichar (s, c);
+    }
+
+    if (!check (s->str, s->len)) {
+      break;
+    }
+  }
+
+  g_string_free (s, TRUE);
+}
+
+/*
+ * Batches take a shortcut for texts without a '.', so half of the texts
+ * have theirs removed.
+ */
+static void
+count_batch (void)
+{
+  const guint n_batches = g_test_slow () ? 50000 : 1000;
+  GString *texts[40];
+  const char *inputs[G_N_ELEMENTS (texts)];
+  gsize lengths[G_N_ELEMENTS (texts)];
+  gsize out[G_N_ELEMENTS (texts)];
+  gboolean failed = FALSE;
+  guint i, k;
+
+  for (k = 0; k < G_N_ELEMENTS (texts); k ++) {
+    texts[k] = g_string_new (NULL);
+  }
+
+  for (i = 0; i < n_batches && !failed; i ++) {
+    const guint n_inputs = g_test_rand_int_range (1, G_N_ELEMENTS (texts) + 1);
+
+    for (k = 0; k < n_inputs; k ++) {
+      GString *s = texts[k];
+
+      g_string_truncate (s, 0);
+      append_random_pieces (s, g_test_rand_int_range (0, k % 8 == 0 ? 400 : 40));
+
+      if (g_test_rand_int_range (0, 2) == 0) {
+        char *p;
+
+        while ((p = memchr (s->str, '.', s->len)) != NULL) {
+          g_string_erase (s, p - s->str, 1);
+        }
+      }
+
+      inputs[k] = s->str;
+      lengths[k] = s->len;
+    }
+
+    tl_count_characters_batch (inputs, lengths, n_inputs, out);
+
+    for (k = 0; k < n_inputs; k ++) {
+      if (out[k] != tl_reference_count_characters_n (inputs[k], lengths[k])) {
+        char *escaped = g_strescape (inputs[k], NULL);
+
+        g_printerr ("Batch count differs on \"%s\"\n", escaped);
+        g_test_fail ();
+        g_free (escaped);
+        failed = TRUE;
+        break;
+      }
+    }
+  }
+
+  for (k = 0; k < G_N_ELEMENTS (texts); k ++) {
+    g_string_free (texts[k], TRUE);
+  }
+}
+
+static void
+check_dir (const char *dir_name,
+           guint       n_mutations)
+{
+  char *path = g_test_build_filename (G_TEST_DIST, "..", "fuzz", dir_name, NULL);
+  GDir *dir = g_dir_open (path, 0, NULL);
+  GString *s = g_string_new (NULL);
+  const char *name;
+
+  if (dir == NULL) {
+    g_test_skip ("Fuzzing corpus not found");
+    g_free (path);
+    return;
+  }
+
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    char *filename = g_build_filename (path, name, NULL);
+    char *contents;
+    gsize length;
+    guint i;
+
+    g_assert (g_file_get_contents (filename, &contents, &length, NULL));
+    g_free (filename);
+
+    if (!check (contents, length)) {
+      g_free (contents);
+      break;
+    }
+
+    // Splice random pieces into it
+    for (i = 0; i < n_mutations; i ++) {
+      const gsize n_chars = g_utf8_strlen (contents, length);
+      const gsize at = g_test_rand_int_range (0, n_chars + 1);
+      const gsize cut = g_test_rand_int_range (0, MIN (n_chars - at, 4) + 1);
+      const char *at_p = g_utf8_offset_to_pointer (contents, at);
+
+      g_string_assign (s, "");
+      g_string_append_len (s, contents, at_p - contents);
+      append_random_pieces (s, g_test_rand_int_range (0, 4));
+      g_string_append (s, g_utf8_offset_to_pointer (at_p, cut));
+
+      if (!check (s->str, s->len)) {
+        break;
+      }
+    }
+
+    g_free (contents);
+  }
+
+  g_string_free (s, TRUE);
+  g_dir_close (dir);
+  g_free (path);
+}
+
+static void
+fuzz_corpus (void)
+{
+  check_dir ("corpus", g_test_slow () ? 100000 : 2000);
+}
+
+static void
+slow_inputs (void)
+{
+  check_dir ("slow", g_test_slow () ? 10000 : 200);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/differential/random-text", random_text);
+  g_test_add_func ("/differential/random-characters", random_characters);
+  g_test_add_func ("/differential/count-batch", count_batch);
+  g_test_add_func ("/differential/fuzz-corpus", fuzz_corpus);
+  g_test_add_func ("/differential/slow-inputs", slow_inputs);
+
+  return g_test_run ();
+}
@@ -16,6 +16,7 @@
  */
 
 #include "libtweetlength.h"
+#include <string.h>
 
 static void
 empty (void)
@@ -1052,6 +1053,48 @@ and_text (void)
   g_free (entities);
 }
 
+static void
+tokens (void)
+{
+  const char *inputs[] = {
+    "",
+    "foo",
+    "@baedert #hashtag https://twitter.com",
+    "twitter.com/foo(.html) @_@ #1 #a1 ä@foo",
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (inputs); i ++) {
+    const gsize length = strlen (inputs[i]);
+    TlTokens *tokens;
+    TlEntity *entities;
+    TlEntity *staged_entities;
+    gsize n_entities, staged_n_entities;
+    gsize text_length, staged_text_length;
+    gsize j;
+
+    entities = tl_extract_entities_n (inputs[i], length, &n_entities, &text_length);
+
+    tokens = tl_tokenize_n (inputs[i], length);
+    staged_entities = tl_tokens_extract_entities (tokens, &staged_n_entities, &staged_text_length);
+    tl_tokens_free (tokens);
+
+    g_assert_cmpint (staged_n_entities, ==, n_entities);
+    g_assert_cmpint (staged_text_length, ==, text_length);
+    // Field by field, padding bytes are not initialized
+    for (j = 0; j < n_entities; j ++) {
+      g_assert_cmpint (staged_entities[j].type, ==, entities[j].type);
+      g_assert (staged_entities[j].start == entities[j].start);
+      g_assert_cmpint (staged_entities[j].length_in_bytes, ==, entities[j].length_in_bytes);
+      g_assert_cmpint (staged_entities[j].start_character_index, ==, entities[j].start_character_index);
+      g_assert_cmpint (staged_entities[j].length_in_characters, ==, entities[j].length_in_characters);
+    }
+
+    g_free (entities);
+    g_free (staged_entities);
+  }
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1070,6 +1113,7 @@ main (int argc, char **argv)
   g_test_add_func ("/entities/combined", combined);
   g_test_add_func ("/entities/link-conformance1", link_conformance1);
   g_test_add_func ("/entities/and-text", and_text);
+  g_test_add_func ("/entities/tokens", tokens);
 
   return g_test_run ();
 }
@@ -0,0 +1,262 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * The decompression in tools/input.c, built into this test. Data is
+ * compressed in memory as two gzip members/zstd frames, written to a temporary
+ * file and read back. The second one starts at an odd offset, so its blocks
+ * end in the middle of chunks.
+ */
+
+#include "input.h"
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// The same as in tools/input.c
+#define RAW_BUFFER_SIZE (256 * 1024)
+#define CHUNK_SIZE      (1024 * 1024)
+
+#define SPLIT_OFFSET    1000
+
+typedef char * (*CompressFunc) (const char *data,
+                                gsize       length,
+                                gsize      *out_length);
+
+static char *
+gzip_compress (const char *data,
+               gsize       length,
+               gsize      *out_length)
+{
+  GConverter *compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1));
+  // Enough for incompressible data too
+  gsize capacity = length + length / 100 + 1024;
+  char *compressed = g_malloc (capacity);
+  gsize bytes_read;
+  GConverterResult result;
+  GError *error = NULL;
+
+  result = g_converter_convert (compressor, data, length, compressed, capacity,
+                                G_CONVERTER_INPUT_AT_END, &bytes_read, out_length, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (result, ==, G_CONVERTER_FINISHED);
+  g_assert_cmpuint (bytes_read, ==, length);
+
+  g_object_unref (compressor);
+
+  return compressed;
+}
+
+#ifdef HAVE_ZSTD
+static char *
+zstd_compress (const char *data,
+               gsize       length,
+               gsize      *out_length)
+{
+  gsize capacity = ZSTD_compressBound (length);
+  char *compressed = g_malloc (capacity);
+  size_t result;
+
+  result = ZSTD_compress (compressed, capacity, data, length, 3);
+  g_assert (!ZSTD_isError (result));
+  *out_length = result;
+
+  return compressed;
+}
+#endif
+
+/*
+ * @n_random bytes that don't compress, so the compressed file takes several
+ * reads, then repeated lines up to @length. Those compress so well that all of
+ * their output comes from the last read.
+ */
+static char *
+make_data (gsize n_random,
+           gsize length)
+{
+  static const char line[] = "@foo #bar https://example.com/baz\n";
+  char *data = g_malloc (length);
+  guint32 state = 1;
+  gsize i;
+
+  for (i = 0; i < n_random; i ++) {
+    state = state * 1103515245 + 12345;
+    data[i] = state >> 24;
+  }
+
+  for (; i < length; i ++) {
+    data[i] = line[i % (sizeof (line) - 1)];
+  }
+
+  return data;
+}
+
+static void
+check_decompress (CompressFunc  compress,
+                  gsize         n_random,
+                  gsize         length)
+{
+  char *data = make_data (n_random, length);
+  char *first;
+  char *second;
+  gsize first_length;
+  gsize second_length;
+  char *filename;
+  char *buffer = g_malloc (length + 1);
+  gsize buffer_length = 0;
+  GError *error = NULL;
+  Input *input;
+  int fd;
+
+  first = compress (data, SPLIT_OFFSET, &first_length);
+  second = compress (data + SPLIT_OFFSET, length - SPLIT_OFFSET, &second_length);
+
+  fd = g_file_open_tmp ("tl-input-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (write (fd, first, first_length), ==, first_length);
+  g_assert_cmpint (write (fd, second, second_length), ==, second_length);
+  g_assert_cmpint (lseek (fd, 0, SEEK_SET), ==, 0);
+
+  input = input_open (fd, filename, &error);
+  g_assert_no_error (error);
+
+  for (;;) {
+    // One byte more than expected, to see the EOF
+    gssize n_read = input_read (input, buffer + buffer_length,
+                                MIN (64 * 1024, length + 1 - buffer_length), &error);
+
+    g_assert_no_error (error);
+    g_assert_cmpint (n_read, >=, 0);
+    if (n_read == 0) {
+      break;
+    }
+    buffer_length += n_read;
+  }
+
+  g_assert_cmpuint (buffer_length, ==, length);
+  g_assert (memcmp (buffer, data, length) == 0);
+
+  input_free (input);
+  close (fd);
+  g_unlink (filename);
+  g_free (filename);
+  g_free (first);
+  g_free (second);
+  g_free (buffer);
+  g_free (data);
+}
+
+static void
+check_truncated (CompressFunc compress)
+{
+  char *data = make_data (0, CHUNK_SIZE);
+  char *compressed;
+  gsize compressed_length;
+  char *filename;
+  char buffer[64 * 1024];
+  GError *error = NULL;
+  Input *input;
+  gssize n_read;
+  int fd;
+
+  compressed = compress (data, CHUNK_SIZE, &compressed_length);
+
+  fd = g_file_open_tmp ("tl-input-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (write (fd, compressed, compressed_length - 4), ==, compressed_length - 4);
+  g_assert_cmpint (lseek (fd, 0, SEEK_SET), ==, 0);
+
+  input = input_open (fd, filename, &error);
+  g_assert_no_error (error);
+
+  do {
+    n_read = input_read (input, buffer, sizeof (buffer), &error);
+  } while (n_read > 0);
+
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT);
+  g_assert_cmpint (n_read, ==, -1);
+  g_error_free (error);
+
+  input_free (input);
+  close (fd);
+  g_unlink (filename);
+  g_free (filename);
+  g_free (compressed);
+  g_free (data);
+}
+
+static void
+gzip_chunk_multiple (void)
+{
+  check_decompress (gzip_compress, 0, 2 * CHUNK_SIZE);
+  check_decompress (gzip_compress, 2 * RAW_BUFFER_SIZE, 3 * CHUNK_SIZE);
+}
+
+static void
+gzip_last_read (void)
+{
+  check_decompress (gzip_compress, 2 * RAW_BUFFER_SIZE, 2 * RAW_BUFFER_SIZE + 3 * CHUNK_SIZE + 17);
+}
+
+static void
+gzip_truncated (void)
+{
+  check_truncated (gzip_compress);
+}
+
+#ifdef HAVE_ZSTD
+static void
+zstd_chunk_multiple (void)
+{
+  check_decompress (zstd_compress, 0, 2 * CHUNK_SIZE);
+  check_decompress (zstd_compress, 2 * RAW_BUFFER_SIZE, 3 * CHUNK_SIZE);
+}
+
+static void
+zstd_last_read (void)
+{
+  check_decompress (zstd_compress, 2 * RAW_BUFFER_SIZE, 2 * RAW_BUFFER_SIZE + 3 * CHUNK_SIZE + 17);
+}
+
+static void
+zstd_truncated (void)
+{
+  check_truncated (zstd_compress);
+}
+#endif
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/input/gzip/chunk-multiple", gzip_chunk_multiple);
+  g_test_add_func ("/input/gzip/last-read", gzip_last_read);
+  g_test_add_func ("/input/gzip/truncated", gzip_truncated);
+#ifdef HAVE_ZSTD
+  g_test_add_func ("/input/zstd/chunk-multiple", zstd_chunk_multiple);
+  g_test_add_func ("/input/zstd/last-read", zstd_last_read);
+  g_test_add_func ("/input/zstd/truncated", zstd_truncated);
+#endif
+
+  return g_test_run ();
+}
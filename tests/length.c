@@ -148,6 +148,15 @@ validate (void)
   // [1] https://github.com/twitter/twitter-text/blob/master/conformance/validate.yml
 }
 
+static void
+scratch_size (void)
+{
+  g_assert_cmpuint (tl_estimate_scratch_size (0), ==, 0);
+  // At least one token and one entity per byte
+  g_assert_cmpuint (tl_estimate_scratch_size (1), >=, 2 * sizeof (TlEntity));
+  g_assert_cmpuint (tl_estimate_scratch_size (280), ==, 280 * tl_estimate_scratch_size (1));
+}
+
 int
 main (int argc, char **argv)
 {
@@ -165,6 +174,7 @@ main (int argc, char **argv)
   g_test_add_func ("/length/advanced-links", advanced_links);
   g_test_add_func ("/length/utf8", utf8);
   g_test_add_func ("/length/validate", validate);
+  g_test_add_func ("/length/scratch-size", scratch_size);
 
   return g_test_run ();
 }
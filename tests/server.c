@@ -0,0 +1,340 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Runs tools/tl-server (TL_SERVER in the environment) on a socket in a
+ * temporary directory and talks to it like a client would.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define REQUEST_COUNT 1
+
+static GPid server_pid;
+static char *socket_dir;
+static char *socket_path;
+
+static int
+connect_server (void)
+{
+  struct sockaddr_un address = { 0 };
+  int fd;
+
+  address.sun_family = AF_UNIX;
+  g_assert_cmpuint (strlen (socket_path), <, sizeof (address.sun_path));
+  strcpy (address.sun_path, socket_path);
+
+  fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  g_assert_cmpint (fd, >=, 0);
+
+  if (connect (fd, (struct sockaddr *)&address, sizeof (address)) != 0) {
+    close (fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static void
+append_u32 (GString *s,
+            guint32  v)
+{
+  v = GUINT32_TO_LE (v);
+  g_string_append_len (s, (const char *)&v, sizeof (v));
+}
+
+static void
+append_u16 (GString *s,
+            guint16  v)
+{
+  v = GUINT16_TO_LE (v);
+  g_string_append_len (s, (const char *)&v, sizeof (v));
+}
+
+static guint32
+read_u32 (const char *p)
+{
+  guint32 v;
+
+  memcpy (&v, p, sizeof (v));
+  return GUINT32_FROM_LE (v);
+}
+
+/* A REQUEST_COUNT frame for the single text @text */
+static void
+append_count_request (GString    *frame,
+                      guint32     id,
+                      const char *text)
+{
+  const gsize start = frame->len;
+
+  append_u32 (frame, 0); // Length, set below
+  append_u32 (frame, id);
+  append_u16 (frame, REQUEST_COUNT);
+  append_u16 (frame, 0);
+  append_u32 (frame, 1);
+  append_u32 (frame, strlen (text));
+  g_string_append (frame, text);
+
+  {
+    const guint32 length = GUINT32_TO_LE (frame->len - start - 4);
+
+    memcpy (frame->str + start, &length, sizeof (length));
+  }
+}
+
+static void
+send_all (int         fd,
+          const char *data,
+          gsize       length)
+{
+  while (length > 0) {
+    gssize n = send (fd, data, length, MSG_NOSIGNAL);
+
+    g_assert_cmpint (n, >, 0);
+    data += n;
+    length -= n;
+  }
+}
+
+static gboolean
+recv_all (int   fd,
+          char *data,
+          gsize length)
+{
+  while (length > 0) {
+    gssize n = recv (fd, data, length, 0);
+
+    if (n <= 0) {
+      return FALSE;
+    }
+    data += n;
+    length -= n;
+  }
+
+  return TRUE;
+}
+
+/*
+ * Reads one response to a single-text REQUEST_COUNT. Returns FALSE on EOF.
+ */
+static gboolean
+read_count_response (int      fd,
+                     guint32 *out_id,
+                     guint32 *out_weighted_length)
+{
+  char header[4];
+  char *frame;
+  guint32 length;
+
+  if (!recv_all (fd, header, sizeof (header))) {
+    return FALSE;
+  }
+
+  length = read_u32 (header);
+  g_assert_cmpuint (length, ==, 8 + 4 + 8);
+  frame = g_malloc (length);
+  g_assert (recv_all (fd, frame, length));
+
+  *out_id = read_u32 (frame);
+  g_assert_cmpuint (read_u32 (frame + 4) >> 16, ==, 0); // Status
+  g_assert_cmpuint (read_u32 (frame + 8), ==, 1);
+  *out_weighted_length = read_u32 (frame + 12);
+  g_free (frame);
+
+  return TRUE;
+}
+
+/* The resident set size of the server, in KiB */
+static guint64
+server_rss (void)
+{
+  char *path = g_strdup_printf ("/proc/%d/status", (int)server_pid);
+  char *contents;
+  const char *line;
+  guint64 rss;
+
+  g_assert (g_file_get_contents (path, &contents, NULL, NULL));
+  line = strstr (contents, "VmRSS:");
+  g_assert (line != NULL);
+  rss = g_ascii_strtoull (line + strlen ("VmRSS:"), NULL, 10);
+
+  g_free (contents);
+  g_free (path);
+
+  return rss;
+}
+
+/* Connects, counts one text and disconnects @n times */
+static void
+connect_many (guint n)
+{
+  GString *frame = g_string_new (NULL);
+  guint i;
+
+  append_count_request (frame, 7, "@foo #bar https://example.com baz");
+
+  for (i = 0; i < n; i ++) {
+    const int fd = connect_server ();
+    guint32 id, weighted_length;
+
+    g_assert_cmpint (fd, >=, 0);
+    send_all (fd, frame->str, frame->len);
+    g_assert (read_count_response (fd, &id, &weighted_length));
+    g_assert_cmpuint (id, ==, 7);
+    g_assert_cmpuint (weighted_length, ==, 37);
+    close (fd);
+  }
+
+  g_string_free (frame, TRUE);
+}
+
+static void
+many_connections (void)
+{
+  guint64 rss_before;
+  guint64 rss_after;
+
+  // Thread pool, allocator caches etc. are set up after this
+  connect_many (200);
+  rss_before = server_rss ();
+
+  // Every connection has two 64 KiB buffers, so leaking them shows
+  connect_many (2000);
+  rss_after = server_rss ();
+
+  g_test_message ("RSS %" G_GUINT64_FORMAT " KiB before, %" G_GUINT64_FORMAT " KiB after",
+                  rss_before, rss_after);
+  g_assert_cmpuint (rss_after, <, rss_before + 8 * 1024);
+}
+
+/* Requests sent right before a shutdown (SHUT_WR) still get answered */
+static void
+half_close (void)
+{
+  GString *frame = g_string_new (NULL);
+  const int fd = connect_server ();
+  guint32 seen = 0;
+  guint32 id, weighted_length;
+  guint i;
+
+  g_assert_cmpint (fd, >=, 0);
+
+  for (i = 0; i < 8; i ++) {
+    append_count_request (frame, i, i % 2 == 0 ? "abc" : "@foo #bar https://example.com baz");
+  }
+  send_all (fd, frame->str, frame->len);
+  g_assert_cmpint (shutdown (fd, SHUT_WR), ==, 0);
+
+  for (i = 0; i < 8; i ++) {
+    g_assert (read_count_response (fd, &id, &weighted_length));
+    g_assert_cmpuint (id, <, 8);
+    g_assert_cmpuint (weighted_length, ==, id % 2 == 0 ? 3 : 37);
+    seen |= 1u << id;
+  }
+  g_assert_cmpuint (seen, ==, 0xff);
+
+  // Then the server closes its end too
+  g_assert (!read_count_response (fd, &id, &weighted_length));
+
+  close (fd);
+  g_string_free (frame, TRUE);
+}
+
+static gboolean
+start_server (void)
+{
+  const char *server = g_getenv ("TL_SERVER");
+  GError *error = NULL;
+  char *argv[] = { NULL, "--socket", NULL, "--threads", "2", NULL };
+  guint i;
+
+  if (server == NULL) {
+    return FALSE;
+  }
+
+  socket_dir = g_dir_make_tmp ("tl-server-XXXXXX", &error);
+  g_assert_no_error (error);
+  socket_path = g_build_filename (socket_dir, "socket", NULL);
+
+  argv[0] = (char *)server;
+  argv[2] = socket_path;
+  g_spawn_async (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDERR_TO_DEV_NULL,
+                 NULL, NULL, &server_pid, &error);
+  g_assert_no_error (error);
+
+  // Wait for it to listen
+  for (i = 0; i < 500; i ++) {
+    const int fd = connect_server ();
+
+    if (fd >= 0) {
+      close (fd);
+      return TRUE;
+    }
+    g_usleep (10 * 1000);
+  }
+
+  g_error ("tl-server did not start listening on %s", socket_path);
+}
+
+static void
+stop_server (void)
+{
+  int status;
+
+  kill (server_pid, SIGTERM);
+  waitpid (server_pid, &status, 0);
+  g_spawn_close_pid (server_pid);
+
+  g_assert (WIFEXITED (status));
+  g_assert_cmpint (WEXITSTATUS (status), ==, 0);
+
+  g_rmdir (socket_dir);
+  g_free (socket_path);
+  g_free (socket_dir);
+}
+
+int
+main (int argc, char **argv)
+{
+  int result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  if (!start_server ()) {
+    g_printerr ("TL_SERVER is not set\n");
+    return 77;
+  }
+
+  g_test_add_func ("/server/many-connections", many_connections);
+  g_test_add_func ("/server/half-close", half_close);
+
+  result = g_test_run ();
+  stop_server ();
+
+  return result;
+}
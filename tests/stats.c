@@ -0,0 +1,106 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libtweetlength.h"
+#include "tl-stats.h"
+#include <string.h>
+
+static void
+counters (void)
+{
+  const char *text = "@foo #bar https://example.com baz";
+  TlEntity *entities;
+  gsize n_entities;
+  TlStats stats;
+
+  tl_stats_reset ();
+
+  if (!tl_stats_get (&stats)) {
+    // Built without -Dstats=true, everything has to be zero
+    g_assert_cmpint (stats.n_calls, ==, 0);
+    g_assert_cmpint (stats.tokenize_ns, ==, 0);
+    return;
+  }
+
+  g_assert_cmpint (stats.n_calls, ==, 0);
+
+  tl_count_characters (text);
+  entities = tl_extract_entities (text, &n_entities, NULL);
+  g_free (entities);
+
+  g_assert (tl_stats_get (&stats));
+  g_assert_cmpint (stats.n_calls, ==, 2);
+  g_assert_cmpint (stats.n_bytes, ==, 2 * strlen (text));
+  g_assert_cmpint (stats.n_links, ==, 2);
+  g_assert_cmpint (stats.n_link_attempts, >, stats.n_links);
+  g_assert_cmpint (stats.n_tld_lookups, >, 0);
+  g_assert_cmpint (stats.n_tokens, >, 0);
+  g_assert_cmpint (stats.n_token_visits, >=, stats.n_link_attempts);
+  g_assert_cmpint (stats.n_entities, >, 0);
+  // Only the array tl_extract_entities() returns
+  g_assert_cmpint (stats.n_allocations, ==, 1);
+  g_assert_cmpint (stats.parse_ns, >=, stats.parse_link_ns);
+
+  tl_stats_reset ();
+  g_assert (tl_stats_get (&stats));
+  g_assert_cmpint (stats.n_calls, ==, 0);
+}
+
+static gpointer
+count_in_thread (gpointer user_data)
+{
+  guint i;
+
+  for (i = 0; i < 100; i ++) {
+    tl_count_characters ("abc def");
+  }
+
+  return NULL;
+}
+
+static void
+threads (void)
+{
+  GThread *threads[4];
+  TlStats stats;
+  guint i;
+
+  tl_stats_reset ();
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i ++) {
+    threads[i] = g_thread_new ("stats", count_in_thread, NULL);
+  }
+  for (i = 0; i < G_N_ELEMENTS (threads); i ++) {
+    g_thread_join (threads[i]);
+  }
+
+  // Exited threads still count
+  if (tl_stats_get (&stats)) {
+    g_assert_cmpint (stats.n_calls, ==, 400);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/stats/counters", counters);
+  g_test_add_func ("/stats/threads", threads);
+
+  return g_test_run ();
+}
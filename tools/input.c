@@ -0,0 +1,457 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input.h"
+#include <gio/gio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define MAGIC_LENGTH    4
+#define RAW_BUFFER_SIZE (256 * 1024)
+#define CHUNK_SIZE      (1024 * 1024)
+// Bounds how far the decompression thread can run ahead of the counting
+#define N_CHUNKS        8
+
+typedef struct {
+  gsize length;
+  char *data;
+} Chunk;
+
+struct _Input {
+  int fd;
+  char *name;
+  Compression compression;
+
+  // Bytes read while sniffing the format
+  char magic[MAGIC_LENGTH];
+  gsize magic_length;
+  gsize magic_pos;
+
+  // Compressed input only. The decompression thread fills chunks from
+  // free_chunks and pushes them to full_chunks, an empty one means EOF.
+  GThread *thread;
+  GAsyncQueue *free_chunks;
+  GAsyncQueue *full_chunks;
+  Chunk *chunks;
+  Chunk *current;
+  gsize current_pos;
+  gboolean at_eof;
+  gint cancelled;
+  GError *error;
+
+  GConverter *gzip;
+#ifdef HAVE_ZSTD
+  ZSTD_DStream *zstd;
+#endif
+};
+
+static gssize
+read_raw (Input   *input,
+          char    *buffer,
+          gsize    size,
+          GError **error)
+{
+  gssize n_read;
+
+  do {
+    n_read = read (input->fd, buffer, size);
+  } while (n_read < 0 && errno == EINTR);
+
+  if (n_read < 0) {
+    int saved_errno = errno;
+
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                 "Could not read from %s: %s", input->name, g_strerror (saved_errno));
+  }
+
+  return n_read;
+}
+
+/*
+ * Both decompressors consume some of @in and produce some of @out, neither
+ * when there is nothing they can do without more input. @out_at_boundary is
+ * set whenever a complete gzip member/zstd frame has been decoded and flushed,
+ * which is the only state in which the input may end. Calls that do nothing
+ * leave it alone.
+ */
+static gboolean
+gzip_decompress (Input       *input,
+                 const char  *in,
+                 gsize        in_length,
+                 gboolean     in_at_eof,
+                 char        *out,
+                 gsize        out_length,
+                 gsize       *out_bytes_read,
+                 gsize       *out_bytes_written,
+                 gboolean    *out_at_boundary,
+                 GError     **error)
+{
+  GError *local_error = NULL;
+  GConverterResult result;
+
+  *out_bytes_read = 0;
+  *out_bytes_written = 0;
+
+  result = g_converter_convert (input->gzip,
+                                in, in_length,
+                                out, out_length,
+                                in_at_eof ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_NO_FLAGS,
+                                out_bytes_read, out_bytes_written,
+                                &local_error);
+
+  if (result == G_CONVERTER_ERROR) {
+    if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT)) {
+      // Nothing consumed or produced, the caller reads more or stops
+      g_error_free (local_error);
+      return TRUE;
+    }
+
+    g_propagate_prefixed_error (error, local_error, "Could not decompress %s: ", input->name);
+    return FALSE;
+  }
+
+  if (result == G_CONVERTER_FINISHED) {
+    // Concatenated members are valid gzip
+    g_converter_reset (input->gzip);
+    *out_at_boundary = TRUE;
+  } else if (*out_bytes_read > 0) {
+    *out_at_boundary = FALSE;
+  }
+
+  return TRUE;
+}
+
+#ifdef HAVE_ZSTD
+static gboolean
+zstd_decompress (Input       *input,
+                 const char  *in,
+                 gsize        in_length,
+                 gboolean     in_at_eof,
+                 char        *out,
+                 gsize        out_length,
+                 gsize       *out_bytes_read,
+                 gsize       *out_bytes_written,
+                 gboolean    *out_at_boundary,
+                 GError     **error)
+{
+  ZSTD_inBuffer in_buffer = { in, in_length, 0 };
+  ZSTD_outBuffer out_buffer = { out, out_length, 0 };
+  size_t result;
+
+  result = ZSTD_decompressStream (input->zstd, &out_buffer, &in_buffer);
+  if (ZSTD_isError (result)) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "Could not decompress %s: %s", input->name, ZSTD_getErrorName (result));
+    return FALSE;
+  }
+
+  *out_bytes_read = in_buffer.pos;
+  *out_bytes_written = out_buffer.pos;
+  // 0 means a frame is complete and flushed. Without any input at the start of
+  // a frame, it asks for the header instead.
+  if (in_buffer.pos > 0 || out_buffer.pos > 0) {
+    *out_at_boundary = result == 0;
+  }
+
+  return TRUE;
+}
+#endif
+
+static gpointer
+decompress_thread_func (gpointer user_data)
+{
+  Input *input = user_data;
+  char *raw = g_malloc (RAW_BUFFER_SIZE);
+  gsize raw_length = 0;
+  gsize raw_pos = 0;
+  gboolean raw_at_eof = FALSE;
+  gboolean at_boundary = TRUE;
+  gboolean need_input = TRUE;
+  Chunk *chunk = g_async_queue_pop (input->free_chunks);
+  GError *error = NULL;
+
+  memcpy (raw, input->magic, input->magic_length);
+  raw_length = input->magic_length;
+  chunk->length = 0;
+
+  while (!g_atomic_int_get (&input->cancelled)) {
+    gsize bytes_read;
+    gsize bytes_written;
+    gboolean success;
+
+    if (need_input && !raw_at_eof) {
+      gssize n_read;
+
+      // Keep what the decompressor has not consumed yet
+      memmove (raw, raw + raw_pos, raw_length - raw_pos);
+      raw_length -= raw_pos;
+      raw_pos = 0;
+
+      n_read = read_raw (input, raw + raw_length, RAW_BUFFER_SIZE - raw_length, &error);
+      if (n_read < 0) {
+        break;
+      }
+
+      raw_at_eof = n_read == 0;
+      raw_length += n_read;
+      need_input = FALSE;
+    }
+
+    if (chunk->length == CHUNK_SIZE) {
+      g_async_queue_push (input->full_chunks, chunk);
+      chunk = g_async_queue_pop (input->free_chunks);
+      chunk->length = 0;
+    }
+
+    if (input->compression == COMPRESSION_GZIP) {
+      success = gzip_decompress (input, raw + raw_pos, raw_length - raw_pos, raw_at_eof,
+                                 chunk->data + chunk->length, CHUNK_SIZE - chunk->length,
+                                 &bytes_read, &bytes_written, &at_boundary, &error);
+    } else {
+#ifdef HAVE_ZSTD
+      success = zstd_decompress (input, raw + raw_pos, raw_length - raw_pos, raw_at_eof,
+                                 chunk->data + chunk->length, CHUNK_SIZE - chunk->length,
+                                 &bytes_read, &bytes_written, &at_boundary, &error);
+#else
+      g_assert_not_reached ();
+#endif
+    }
+
+    if (!success) {
+      break;
+    }
+
+    raw_pos += bytes_read;
+    chunk->length += bytes_written;
+
+    if (bytes_read == 0 && bytes_written == 0) {
+      // Even with all input consumed, the decoder may still hold output, so
+      // the end is only when it can't produce any more
+      if (raw_at_eof) {
+        if (raw_pos < raw_length || !at_boundary) {
+          g_set_error (&error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                       "%s is truncated", input->name);
+        }
+        break;
+      }
+      need_input = TRUE;
+    } else if (raw_pos == raw_length) {
+      need_input = TRUE;
+    }
+  }
+
+  if (chunk->length > 0) {
+    g_async_queue_push (input->full_chunks, chunk);
+    chunk = g_async_queue_pop (input->free_chunks);
+  }
+
+  // The reader only looks at the error after popping the EOF chunk
+  input->error = error;
+  chunk->length = 0;
+  g_async_queue_push (input->full_chunks, chunk);
+
+  g_free (raw);
+
+  return NULL;
+}
+
+/*
+ * input_open:
+ * @fd: File descriptor to read from, not owned by the returned #Input
+ * @name: Name of @fd for error messages
+ *
+ * Looks at the first bytes of @fd and transparently decompresses gzip and, if
+ * available at build time, zstd data. Decompression happens in its own thread,
+ * a few chunks ahead of the input_read() calls.
+ *
+ * Returns: (transfer full): A new #Input, or %NULL on error
+ */
+Input *
+input_open (int          fd,
+            const char  *name,
+            GError     **error)
+{
+  Input *input = g_new0 (Input, 1);
+  static const guchar gzip_magic[] = { 0x1f, 0x8b };
+  static const guchar zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+  guint i;
+
+  input->fd = fd;
+  input->name = g_strdup (name);
+
+  while (input->magic_length < MAGIC_LENGTH) {
+    gssize n_read = read_raw (input, input->magic + input->magic_length,
+                              MAGIC_LENGTH - input->magic_length, error);
+
+    if (n_read < 0) {
+      input_free (input);
+      return NULL;
+    }
+
+    if (n_read == 0) {
+      break;
+    }
+
+    input->magic_length += n_read;
+  }
+
+  if (input->magic_length >= sizeof (gzip_magic) &&
+      memcmp (input->magic, gzip_magic, sizeof (gzip_magic)) == 0) {
+    input->compression = COMPRESSION_GZIP;
+    input->gzip = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+  } else if (input->magic_length >= sizeof (zstd_magic) &&
+             memcmp (input->magic, zstd_magic, sizeof (zstd_magic)) == 0) {
+#ifdef HAVE_ZSTD
+    input->compression = COMPRESSION_ZSTD;
+    input->zstd = ZSTD_createDStream ();
+    ZSTD_initDStream (input->zstd);
+#else
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                 "%s is zstd-compressed, but zstd support is not built in", name);
+    input_free (input);
+    return NULL;
+#endif
+  }
+
+  if (input->compression == COMPRESSION_NONE) {
+    return input;
+  }
+
+  input->free_chunks = g_async_queue_new ();
+  input->full_chunks = g_async_queue_new ();
+  input->chunks = g_new0 (Chunk, N_CHUNKS);
+  for (i = 0; i < N_CHUNKS; i ++) {
+    input->chunks[i].data = g_malloc (CHUNK_SIZE);
+    g_async_queue_push (input->free_chunks, &input->chunks[i]);
+  }
+
+  input->thread = g_thread_new ("tl-decompress", decompress_thread_func, input);
+
+  return input;
+}
+
+Compression
+input_get_compression (Input *input)
+{
+  return input->compression;
+}
+
+/*
+ * input_read:
+ *
+ * Reads up to @size bytes of (decompressed) data into @buffer.
+ *
+ * Returns: The number of bytes read, 0 at EOF or -1 on error.
+ */
+gssize
+input_read (Input   *input,
+            char    *buffer,
+            gsize    size,
+            GError **error)
+{
+  gsize n;
+
+  if (input->magic_pos < input->magic_length && input->compression == COMPRESSION_NONE) {
+    n = MIN (size, input->magic_length - input->magic_pos);
+    memcpy (buffer, input->magic + input->magic_pos, n);
+    input->magic_pos += n;
+    return n;
+  }
+
+  if (input->compression == COMPRESSION_NONE) {
+    return read_raw (input, buffer, size, error);
+  }
+
+  if (input->current == NULL) {
+    if (input->at_eof) {
+      return 0;
+    }
+
+    input->current = g_async_queue_pop (input->full_chunks);
+    input->current_pos = 0;
+
+    if (input->current->length == 0) {
+      g_async_queue_push (input->free_chunks, input->current);
+      input->current = NULL;
+      input->at_eof = TRUE;
+
+      if (input->error != NULL) {
+        g_propagate_error (error, g_steal_pointer (&input->error));
+        return -1;
+      }
+
+      return 0;
+    }
+  }
+
+  n = MIN (size, input->current->length - input->current_pos);
+  memcpy (buffer, input->current->data + input->current_pos, n);
+  input->current_pos += n;
+
+  if (input->current_pos == input->current->length) {
+    g_async_queue_push (input->free_chunks, input->current);
+    input->current = NULL;
+  }
+
+  return n;
+}
+
+void
+input_free (Input *input)
+{
+  guint i;
+
+  if (input->thread != NULL) {
+    g_atomic_int_set (&input->cancelled, TRUE);
+
+    // Hand everything back so the thread can't block on free_chunks
+    if (input->current != NULL) {
+      g_async_queue_push (input->free_chunks, input->current);
+    }
+    while (!input->at_eof) {
+      Chunk *chunk = g_async_queue_pop (input->full_chunks);
+
+      input->at_eof = chunk->length == 0;
+      g_async_queue_push (input->free_chunks, chunk);
+    }
+
+    g_thread_join (input->thread);
+  }
+
+  if (input->chunks != NULL) {
+    for (i = 0; i < N_CHUNKS; i ++) {
+      g_free (input->chunks[i].data);
+    }
+    g_free (input->chunks);
+    g_async_queue_unref (input->free_chunks);
+    g_async_queue_unref (input->full_chunks);
+  }
+
+  g_clear_object (&input->gzip);
+#ifdef HAVE_ZSTD
+  if (input->zstd != NULL) {
+    ZSTD_freeDStream (input->zstd);
+  }
+#endif
+  g_clear_error (&input->error);
+  g_free (input->name);
+  g_free (input);
+}
@@ -0,0 +1,41 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_INPUT_H__
+#define __TL_INPUT_H__
+
+#include <glib.h>
+
+typedef enum {
+  COMPRESSION_NONE,
+  COMPRESSION_GZIP,
+  COMPRESSION_ZSTD
+} Compression;
+
+typedef struct _Input Input;
+
+Input       *input_open            (int          fd,
+                                    const char  *name,
+                                    GError     **error);
+Compression  input_get_compression (Input       *input);
+gssize       input_read            (Input       *input,
+                                    char        *buffer,
+                                    gsize        size,
+                                    GError     **error);
+void         input_free            (Input       *input);
+
+#endif
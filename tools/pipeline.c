@@ -0,0 +1,342 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline.h"
+#include "ring.h"
+#include <string.h>
+
+#define BLOCK_SIZE         (1024 * 1024)
+#define N_BLOCKS           16
+#define N_ITEMS            1024
+#define OUTPUT_FLUSH_SIZE  (64 * 1024)
+
+/*
+ * The reader slices records out of blocks and sends them down the stages
+ * below. Everything is strictly FIFO, so once the writer sees an item from a
+ * different block, all records of the previous block are done and it goes back
+ * to the reader.
+ *
+ *   reader --items--> tokenizer --items--> parser --items--> writer
+ *     ^                                                        |
+ *     +---------------------------blocks-----------------------+
+ */
+
+typedef struct {
+  char *data;
+  gsize capacity;
+} Block;
+
+typedef struct {
+  Block *block; // NULL marks the end of the stream
+
+  const char *record;
+  gsize record_length;
+
+  const char *text; // NULL if the record has nothing to count
+  gsize text_length;
+  char *owned_text; // Unescaped copy of the text, if needed
+
+  TlTokens *tokens;
+
+  TlEntity *entities;
+  gsize n_entities;
+  gsize weighted_length;
+} Item;
+
+typedef struct {
+  const RecordFormat *format;
+  FILE *output;
+
+  Ring *read_items;
+  Ring *token_items;
+  Ring *parse_items;
+  Ring *free_blocks;
+} Pipeline;
+
+static gpointer
+tokenize_stage (gpointer user_data)
+{
+  Pipeline *pipeline = user_data;
+  GString *scratch = g_string_new (NULL);
+
+  for (;;) {
+    Item *in = ring_pop_begin (pipeline->read_items);
+    Item *out = ring_push_begin (pipeline->token_items);
+    gboolean done;
+
+    *out = *in;
+    ring_pop_end (pipeline->read_items);
+    done = out->block == NULL;
+
+    if (!done &&
+        record_select_text (out->record, out->record_length, pipeline->format->field_path,
+                            scratch, &out->text, &out->text_length)) {
+      if (out->text == scratch->str) {
+        // The scratch buffer gets reused for the next record
+        out->owned_text = g_malloc0 (out->text_length + RECORD_PADDING);
+        memcpy (out->owned_text, out->text, out->text_length);
+        out->text = out->owned_text;
+      }
+
+      out->tokens = tl_tokenize_n (out->text, out->text_length);
+    }
+
+    ring_push_end (pipeline->token_items);
+
+    if (done) {
+      break;
+    }
+  }
+
+  g_string_free (scratch, TRUE);
+
+  return NULL;
+}
+
+static gpointer
+parse_stage (gpointer user_data)
+{
+  Pipeline *pipeline = user_data;
+
+  for (;;) {
+    Item *in = ring_pop_begin (pipeline->token_items);
+    Item *out = ring_push_begin (pipeline->parse_items);
+    gboolean done;
+
+    *out = *in;
+    ring_pop_end (pipeline->token_items);
+    done = out->block == NULL;
+
+    if (out->tokens != NULL) {
+      out->entities = tl_tokens_extract_entities (out->tokens, &out->n_entities,
+                                                  &out->weighted_length);
+      tl_tokens_free (out->tokens);
+      out->tokens = NULL;
+    }
+
+    ring_push_end (pipeline->parse_items);
+
+    if (done) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+static gpointer
+write_stage (gpointer user_data)
+{
+  Pipeline *pipeline = user_data;
+  GString *output = g_string_sized_new (OUTPUT_FLUSH_SIZE * 2);
+  Block *current_block = NULL;
+
+  for (;;) {
+    Item *item = ring_pop_begin (pipeline->parse_items);
+    Block *block = item->block;
+
+    if (block != NULL) {
+      record_format_result (pipeline->format,
+                            item->text, item->text_length,
+                            item->entities, item->n_entities,
+                            item->weighted_length,
+                            output);
+      g_free (item->entities);
+      g_free (item->owned_text);
+    }
+
+    ring_pop_end (pipeline->parse_items);
+
+    if (block != current_block && current_block != NULL) {
+      *(Block **)ring_push_begin (pipeline->free_blocks) = current_block;
+      ring_push_end (pipeline->free_blocks);
+    }
+    current_block = block;
+
+    // Also flush before waiting for more records, so results of a slow stream
+    // (e.g. tail -f) show up right away instead of once 64 KiB have piled up
+    if (output->len >= OUTPUT_FLUSH_SIZE || block == NULL ||
+        (output->len > 0 && !ring_can_pop (pipeline->parse_items))) {
+      fwrite (output->str, 1, output->len, pipeline->output);
+      fflush (pipeline->output);
+      g_string_truncate (output, 0);
+    }
+
+    if (block == NULL) {
+      break;
+    }
+  }
+
+  g_string_free (output, TRUE);
+
+  return NULL;
+}
+
+static inline void
+send_record (Pipeline   *pipeline,
+             Block      *block,
+             const char *start,
+             const char *end)
+{
+  Item *item = ring_push_begin (pipeline->read_items);
+
+  if (end > start && end[-1] == '\r') {
+    end --;
+  }
+
+  memset (item, 0, sizeof (Item));
+  item->block = block;
+  item->record = start;
+  item->record_length = end - start;
+
+  ring_push_end (pipeline->read_items);
+}
+
+/*
+ * Runs in the calling thread. Records are sent on as soon as they are complete,
+ * so a slow trickle of input (e.g. a socket) still flows through immediately.
+ */
+static gboolean
+read_stage (Pipeline *pipeline,
+            Input    *input)
+{
+  Block *block = *(Block **)ring_pop_begin (pipeline->free_blocks);
+  gsize filled = 0;
+  gsize sent = 0;
+  gboolean at_eof = FALSE;
+  gboolean success = TRUE;
+  GError *error = NULL;
+  Item *item;
+
+  ring_pop_end (pipeline->free_blocks);
+
+  while (!at_eof) {
+    gssize n_read;
+
+    if (filled == block->capacity) {
+      if (sent == 0) {
+        // Nothing of this block is in flight, so it can simply grow
+        block->capacity *= 2;
+        block->data = g_realloc (block->data, block->capacity + RECORD_PADDING);
+      } else {
+        Block *next = *(Block **)ring_pop_begin (pipeline->free_blocks);
+
+        ring_pop_end (pipeline->free_blocks);
+        memcpy (next->data, block->data + sent, filled - sent);
+        filled -= sent;
+        sent = 0;
+        block = next;
+      }
+    }
+
+    n_read = input_read (input, block->data + filled, block->capacity - filled, &error);
+    if (n_read < 0) {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      success = FALSE;
+      break;
+    }
+
+    at_eof = n_read == 0;
+    filled += n_read;
+    memset (block->data + filled, 0, RECORD_PADDING);
+
+    for (;;) {
+      const char *start = block->data + sent;
+      const char *newline = memchr (start, '\n', filled - sent);
+
+      if (newline == NULL) {
+        if (at_eof && sent < filled) {
+          send_record (pipeline, block, start, block->data + filled);
+          sent = filled;
+        }
+        break;
+      }
+
+      send_record (pipeline, block, start, newline);
+      sent = newline + 1 - block->data;
+    }
+  }
+
+  item = ring_push_begin (pipeline->read_items);
+  memset (item, 0, sizeof (Item));
+  ring_push_end (pipeline->read_items);
+
+  return success;
+}
+
+/*
+ * pipeline_run:
+ * @input: Input to read records from
+ * @format: How to select the text and format the output
+ * @output: Where to write the results
+ *
+ * Like tl-count's default mode, but reading, tokenizing, parsing and writing
+ * each get their own thread, connected by single-producer/single-consumer
+ * rings. This keeps a single slow input stream busy, the output order is
+ * the input order.
+ *
+ * Returns: %FALSE if reading @input failed.
+ */
+gboolean
+pipeline_run (Input              *input,
+              const RecordFormat *format,
+              FILE               *output)
+{
+  Pipeline pipeline;
+  Block blocks[N_BLOCKS];
+  GThread *tokenizer;
+  GThread *parser;
+  GThread *writer;
+  gboolean success;
+  guint i;
+
+  pipeline.format = format;
+  pipeline.output = output;
+  pipeline.read_items = ring_new (N_ITEMS, sizeof (Item));
+  pipeline.token_items = ring_new (N_ITEMS, sizeof (Item));
+  pipeline.parse_items = ring_new (N_ITEMS, sizeof (Item));
+  pipeline.free_blocks = ring_new (N_BLOCKS, sizeof (Block *));
+
+  for (i = 0; i < N_BLOCKS; i ++) {
+    blocks[i].capacity = BLOCK_SIZE;
+    blocks[i].data = g_malloc (BLOCK_SIZE + RECORD_PADDING);
+
+    *(Block **)ring_push_begin (pipeline.free_blocks) = &blocks[i];
+    ring_push_end (pipeline.free_blocks);
+  }
+
+  tokenizer = g_thread_new ("tl-tokenize", tokenize_stage, &pipeline);
+  parser = g_thread_new ("tl-parse", parse_stage, &pipeline);
+  writer = g_thread_new ("tl-write", write_stage, &pipeline);
+
+  success = read_stage (&pipeline, input);
+
+  g_thread_join (tokenizer);
+  g_thread_join (parser);
+  g_thread_join (writer);
+
+  for (i = 0; i < N_BLOCKS; i ++) {
+    g_free (blocks[i].data);
+  }
+  ring_free (pipeline.read_items);
+  ring_free (pipeline.token_items);
+  ring_free (pipeline.parse_items);
+  ring_free (pipeline.free_blocks);
+
+  return success;
+}
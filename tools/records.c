@@ -0,0 +1,549 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "records.h"
+#include "libtweetlength.h"
+#include <string.h>
+
+static inline void
+append_record (GArray     *records,
+               const char *start,
+               const char *end)
+{
+  Record *r;
+
+  if (end > start && end[-1] == '\r') {
+    end --;
+  }
+
+  g_array_set_size (records, records->len + 1);
+  r = &g_array_index (records, Record, records->len - 1);
+  r->start = start;
+  r->length = end - start;
+}
+
+/*
+ * records_split:
+ * @data: Buffer containing newline-separated records
+ * @length: Length of @data, in bytes
+ * @at_eof: Whether the data after the last newline is a complete record
+ * @records: (out caller-allocates): GArray of #Record, will be cleared
+ *
+ * Slices @data into records without copying anything.
+ *
+ * Returns: The number of bytes of @data that ended up in @records.
+ */
+gsize
+records_split (const char *data,
+               gsize       length,
+               gboolean    at_eof,
+               GArray     *records)
+{
+  const char *p = data;
+  const char *end = data + length;
+
+  g_array_set_size (records, 0);
+
+  for (;;) {
+    const char *newline = memchr (p, '\n', end - p);
+
+    if (newline == NULL) {
+      if (at_eof && p < end) {
+        append_record (records, p, end);
+        p = end;
+      }
+      break;
+    }
+
+    append_record (records, p, newline);
+    p = newline + 1;
+  }
+
+  return p - data;
+}
+
+static inline const char *
+skip_whitespace (const char *p,
+                 const char *end)
+{
+  while (p < end &&
+         (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    p ++;
+  }
+
+  return p;
+}
+
+// @p points to the opening quote. Returns the position after the closing one.
+static const char *
+skip_string (const char *p,
+             const char *end,
+             gboolean   *out_has_escapes)
+{
+  g_assert (*p == '"');
+  p ++;
+
+  while (p < end) {
+    if (*p == '\\') {
+      if (out_has_escapes) {
+        *out_has_escapes = TRUE;
+      }
+      p += 2;
+      continue;
+    }
+
+    if (*p == '"') {
+      return p + 1;
+    }
+
+    p ++;
+  }
+
+  return NULL;
+}
+
+static const char *
+skip_value (const char *p,
+            const char *end)
+{
+  int depth = 0;
+
+  if (p >= end) {
+    return NULL;
+  }
+
+  if (*p == '"') {
+    return skip_string (p, end, NULL);
+  }
+
+  if (*p != '{' && *p != '[') {
+    // Numbers, true, false, null
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+      p ++;
+    }
+    return p;
+  }
+
+  while (p < end) {
+    switch (*p) {
+      case '"':
+        p = skip_string (p, end, NULL);
+        if (p == NULL) {
+          return NULL;
+        }
+        continue;
+
+      case '{':
+      case '[':
+        depth ++;
+      break;
+
+      case '}':
+      case ']':
+        depth --;
+        if (depth == 0) {
+          return p + 1;
+        }
+      break;
+    }
+
+    p ++;
+  }
+
+  return NULL;
+}
+
+/* Returns the start of the value of member @key of the object at @p, or NULL. */
+static const char *
+find_member (const char *p,
+             const char *end,
+             const char *key)
+{
+  const gsize key_length = strlen (key);
+
+  p = skip_whitespace (p, end);
+  if (p >= end || *p != '{') {
+    return NULL;
+  }
+  p ++;
+
+  for (;;) {
+    const char *key_start;
+    const char *key_end;
+
+    p = skip_whitespace (p, end);
+    if (p >= end || *p != '"') {
+      return NULL;
+    }
+
+    key_start = p + 1;
+    p = skip_string (p, end, NULL);
+    if (p == NULL) {
+      return NULL;
+    }
+    key_end = p - 1;
+
+    p = skip_whitespace (p, end);
+    if (p >= end || *p != ':') {
+      return NULL;
+    }
+    p = skip_whitespace (p + 1, end);
+
+    // Keys are compared verbatim, escapes in keys are not worth the effort.
+    if ((gsize)(key_end - key_start) == key_length &&
+        memcmp (key_start, key, key_length) == 0) {
+      return p;
+    }
+
+    p = skip_value (p, end);
+    if (p == NULL) {
+      return NULL;
+    }
+
+    p = skip_whitespace (p, end);
+    if (p >= end || *p != ',') {
+      return NULL;
+    }
+    p ++;
+  }
+}
+
+static inline gboolean
+read_hex4 (const char *p,
+           const char *end,
+           gunichar   *out_c)
+{
+  gunichar c = 0;
+  int i;
+
+  if (end - p < 4) {
+    return FALSE;
+  }
+
+  for (i = 0; i < 4; i ++) {
+    int v = g_ascii_xdigit_value (p[i]);
+
+    if (v < 0) {
+      return FALSE;
+    }
+    c = (c << 4) | v;
+  }
+
+  *out_c = c;
+  return TRUE;
+}
+
+static gboolean
+unescape_string (const char *p,
+                 const char *end,
+                 GString    *out)
+{
+  g_string_truncate (out, 0);
+
+  while (p < end) {
+    const char *backslash = memchr (p, '\\', end - p);
+    gunichar c;
+
+    if (backslash == NULL) {
+      g_string_append_len (out, p, end - p);
+      break;
+    }
+
+    g_string_append_len (out, p, backslash - p);
+    p = backslash + 1;
+    if (p >= end) {
+      return FALSE;
+    }
+
+    switch (*p) {
+      case '"':
+      case '\\':
+      case '/':
+        g_string_append_c (out, *p);
+      break;
+      case 'b': g_string_append_c (out, '\b'); break;
+      case 'f': g_string_append_c (out, '\f'); break;
+      case 'n': g_string_append_c (out, '\n'); break;
+      case 'r': g_string_append_c (out, '\r'); break;
+      case 't': g_string_append_c (out, '\t'); break;
+
+      case 'u':
+        if (!read_hex4 (p + 1, end, &c)) {
+          return FALSE;
+        }
+        p += 4;
+
+        if (c >= 0xD800 && c < 0xE000) {
+          gunichar low;
+
+          // Surrogate pair, encoded as two consecutive escapes
+          if (c < 0xDC00 && end - p > 2 && p[1] == '\\' && p[2] == 'u' &&
+              read_hex4 (p + 3, end, &low) && low >= 0xDC00 && low < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+            p += 6;
+          } else {
+            c = 0xFFFD;
+          }
+        }
+
+        g_string_append_unichar (out, c);
+      break;
+
+      default:
+        return FALSE;
+    }
+
+    p ++;
+  }
+
+  return TRUE;
+}
+
+/*
+ * record_select_text:
+ * @record: The record
+ * @record_length: Length of @record, in bytes
+ * @field_path: (nullable): NULL-terminated list of JSON member names
+ * @scratch: Buffer to unescape JSON strings into
+ * @out_text: (out): Location to store the text to count
+ * @out_text_length: (out): Location to store the length of @out_text, in bytes
+ *
+ * If @field_path is %NULL, the record itself is the text. Otherwise @record is
+ * parsed as a JSON object and the string at @field_path is returned. That is a
+ * slice of @record unless the string contains escapes, in which case it gets
+ * unescaped into @scratch.
+ *
+ * Returns: %FALSE if there is no string at @field_path
+ */
+gboolean
+record_select_text (const char   *record,
+                    gsize         record_length,
+                    char        **field_path,
+                    GString      *scratch,
+                    const char  **out_text,
+                    gsize        *out_text_length)
+{
+  const char *end = record + record_length;
+  const char *p = record;
+  const char *value_end;
+  gboolean has_escapes = FALSE;
+  guint i;
+
+  if (field_path == NULL) {
+    *out_text = record;
+    *out_text_length = record_length;
+    return TRUE;
+  }
+
+  for (i = 0; field_path[i] != NULL; i ++) {
+    p = find_member (p, end, field_path[i]);
+    if (p == NULL) {
+      return FALSE;
+    }
+  }
+
+  if (p >= end || *p != '"') {
+    return FALSE;
+  }
+
+  value_end = skip_string (p, end, &has_escapes);
+  if (value_end == NULL) {
+    return FALSE;
+  }
+
+  // Without the quotes
+  p ++;
+  value_end --;
+
+  if (!has_escapes) {
+    *out_text = p;
+    *out_text_length = value_end - p;
+    return TRUE;
+  }
+
+  if (!unescape_string (p, value_end, scratch)) {
+    return FALSE;
+  }
+
+  *out_text = scratch->str;
+  *out_text_length = scratch->len;
+  return TRUE;
+}
+
+static inline void
+append_number (GString *s,
+               guint64  n)
+{
+  char buffer[20];
+  int i = sizeof (buffer);
+
+  do {
+    buffer[--i] = '0' + (n % 10);
+    n /= 10;
+  } while (n > 0);
+
+  g_string_append_len (s, buffer + i, sizeof (buffer) - i);
+}
+
+static inline const char *
+entity_type_name (guint type)
+{
+  switch (type) {
+    case TL_ENT_HASHTAG:
+      return "hashtag";
+    case TL_ENT_LINK:
+      return "link";
+    case TL_ENT_MENTION:
+      return "mention";
+    default:
+      return "text";
+  }
+}
+
+/*
+ * record_format_result:
+ * @text: (nullable): The counted text, %NULL if the record had none
+ *
+ * Appends one line describing a record to @output. That is either tab-separated
+ * `length weighted_length entities`, where entities are comma-separated
+ * `type:start:length` triples, or a JSON object with the same contents.
+ * Records without text to count produce a line containing just '-' (or null).
+ */
+void
+record_format_result (const RecordFormat *format,
+                      const char         *text,
+                      gsize               text_length,
+                      const TlEntity     *entities,
+                      gsize               n_entities,
+                      gsize               weighted_length,
+                      GString            *output)
+{
+  gsize length;
+  gsize i;
+
+  if (text == NULL) {
+    g_string_append (output, format->json_output ? "null\n" : "-\n");
+    return;
+  }
+
+  length = text_length > 0 ? g_utf8_strlen (text, text_length) : 0;
+
+  if (format->json_output) {
+    g_string_append (output, "{\"length\":");
+    append_number (output, length);
+    g_string_append (output, ",\"weighted_length\":");
+    append_number (output, weighted_length);
+    g_string_append (output, ",\"entities\":[");
+    for (i = 0; i < n_entities; i ++) {
+      if (i > 0) {
+        g_string_append_c (output, ',');
+      }
+      g_string_append (output, "{\"type\":\"");
+      g_string_append (output, entity_type_name (entities[i].type));
+      g_string_append (output, "\",\"start\":");
+      append_number (output, entities[i].start_character_index);
+      g_string_append (output, ",\"length\":");
+      append_number (output, entities[i].length_in_characters);
+      g_string_append_c (output, '}');
+    }
+    g_string_append (output, "]}\n");
+  } else {
+    append_number (output, length);
+    g_string_append_c (output, '\t');
+    append_number (output, weighted_length);
+    g_string_append_c (output, '\t');
+    for (i = 0; i < n_entities; i ++) {
+      if (i > 0) {
+        g_string_append_c (output, ',');
+      }
+      g_string_append (output, entity_type_name (entities[i].type));
+      g_string_append_c (output, ':');
+      append_number (output, entities[i].start_character_index);
+      g_string_append_c (output, ':');
+      append_number (output, entities[i].length_in_characters);
+    }
+    g_string_append_c (output, '\n');
+  }
+}
+
+/*
+ * record_format:
+ *
+ * Counts @record and appends the result to @output, see record_format_result().
+ */
+void
+record_format (const Record       *record,
+               const RecordFormat *format,
+               GString            *scratch,
+               GString            *output)
+{
+  const char *text;
+  gsize text_length;
+  TlEntity *entities = NULL;
+  gsize n_entities = 0;
+  gsize weighted_length = 0;
+
+  if (!record_select_text (record->start, record->length, format->field_path,
+                           scratch, &text, &text_length)) {
+    record_format_result (format, NULL, 0, NULL, 0, 0, output);
+    return;
+  }
+
+  if (text_length > 0) {
+    entities = tl_extract_entities_n (text, text_length, &n_entities, &weighted_length);
+  }
+
+  record_format_result (format, text, text_length, entities, n_entities, weighted_length, output);
+
+  g_free (entities);
+}
+
+/*
+ * json_append_string:
+ * @s: NUL-terminated string, e.g. a filename
+ *
+ * Appends @s to @output as a quoted JSON string.
+ */
+void
+json_append_string (GString    *output,
+                    const char *s)
+{
+  g_string_append_c (output, '"');
+  for (; *s != '\0'; s ++) {
+    switch (*s) {
+      case '"':
+      case '\\':
+        g_string_append_c (output, '\\');
+        g_string_append_c (output, *s);
+        break;
+      case '\n':
+        g_string_append (output, "\\n");
+        break;
+      case '\t':
+        g_string_append (output, "\\t");
+        break;
+      default:
+        if ((guchar)*s < 0x20) {
+          g_string_append_printf (output, "\\u%04x", (guchar)*s);
+        } else {
+          g_string_append_c (output, *s);
+        }
+    }
+  }
+  g_string_append_c (output, '"');
+}
@@ -0,0 +1,64 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_RECORDS_H__
+#define __TL_RECORDS_H__
+
+#include "libtweetlength.h"
+
+/* A truncated UTF-8 sequence at the end of a record gets read in full by
+ * libtweetlength, so every buffer we hand records out of has this many NUL
+ * bytes after the data. */
+#define RECORD_PADDING 8
+
+/* A record is a slice of some bigger buffer, it never owns its data. */
+typedef struct {
+  const char *start;
+  gsize length;
+} Record;
+
+typedef struct {
+  char     **field_path; /* NULL for plain text records */
+  gboolean   json_output;
+} RecordFormat;
+
+gsize    records_split        (const char          *data,
+                               gsize                length,
+                               gboolean             at_eof,
+                               GArray              *records);
+gboolean record_select_text   (const char          *record,
+                               gsize                record_length,
+                               char               **field_path,
+                               GString             *scratch,
+                               const char         **out_text,
+                               gsize               *out_text_length);
+void     record_format_result (const RecordFormat  *format,
+                               const char          *text,
+                               gsize                text_length,
+                               const TlEntity      *entities,
+                               gsize                n_entities,
+                               gsize                weighted_length,
+                               GString             *output);
+void     record_format        (const Record        *record,
+                               const RecordFormat  *format,
+                               GString             *scratch,
+                               GString             *output);
+
+void     json_append_string   (GString             *output,
+                               const char          *s);
+
+#endif
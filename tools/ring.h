@@ -0,0 +1,172 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TL_RING_H__
+#define __TL_RING_H__
+
+#include <glib.h>
+
+/*
+ * Bounded lock-free ring buffer for exactly one producer and one consumer
+ * thread. Slots are filled and drained in place:
+ *
+ *   slot = ring_push_begin (ring); ...fill slot...; ring_push_end (ring);
+ *   slot = ring_pop_begin (ring);  ...read slot...; ring_pop_end (ring);
+ *
+ * Both _begin functions block while the ring is full or empty, which is what
+ * bounds the amount of work in flight between two stages. They spin for a
+ * short while first, then sleep until the other side moves.
+ */
+
+#define RING_CACHE_LINE 64
+
+typedef struct {
+  char *slots;
+  gsize slot_size;
+  guint mask;
+
+  // Keep the two indices on separate cache lines, one per thread
+  char padding1[RING_CACHE_LINE];
+  gint tail; // Only written by the producer
+  char padding2[RING_CACHE_LINE];
+  gint head; // Only written by the consumer
+  char padding3[RING_CACHE_LINE];
+
+  // Only touched once a side has given up spinning
+  gint n_sleepers;
+  GMutex mutex;
+  GCond cond;
+} Ring;
+
+static inline Ring *
+ring_new (guint n_slots,
+          gsize slot_size)
+{
+  Ring *ring = g_new0 (Ring, 1);
+
+  g_assert ((n_slots & (n_slots - 1)) == 0);
+
+  ring->slots = g_malloc0 (n_slots * slot_size);
+  ring->slot_size = slot_size;
+  ring->mask = n_slots - 1;
+  g_mutex_init (&ring->mutex);
+  g_cond_init (&ring->cond);
+
+  return ring;
+}
+
+static inline void
+ring_free (Ring *ring)
+{
+  g_mutex_clear (&ring->mutex);
+  g_cond_clear (&ring->cond);
+  g_free (ring->slots);
+  g_free (ring);
+}
+
+// For the producer, whether ring_push_begin() can return right away
+static inline gboolean
+ring_can_push (Ring *ring)
+{
+  return (guint)ring->tail - (guint)g_atomic_int_get (&ring->head) <= ring->mask;
+}
+
+// For the consumer, whether ring_pop_begin() can return right away
+static inline gboolean
+ring_can_pop (Ring *ring)
+{
+  return (guint)ring->head != (guint)g_atomic_int_get (&ring->tail);
+}
+
+/*
+ * Spin first, then yield, then sleep so an idle stage does not use any CPU.
+ * The sleeper is counted before @ready is checked under the mutex, and the
+ * other side checks the count after moving its index, so either the sleeper
+ * sees the move or gets signalled.
+ */
+static inline void
+ring_wait (Ring      *ring,
+           guint     *n_waits,
+           gboolean (*ready) (Ring *ring))
+{
+  if (*n_waits < 100) {
+    (*n_waits) ++;
+  } else if (*n_waits < 200) {
+    (*n_waits) ++;
+    g_thread_yield ();
+  } else {
+    g_mutex_lock (&ring->mutex);
+    g_atomic_int_inc (&ring->n_sleepers);
+    while (!ready (ring)) {
+      g_cond_wait (&ring->cond, &ring->mutex);
+    }
+    g_atomic_int_add (&ring->n_sleepers, -1);
+    g_mutex_unlock (&ring->mutex);
+  }
+}
+
+static inline void
+ring_wake (Ring *ring)
+{
+  if (g_atomic_int_get (&ring->n_sleepers) > 0) {
+    g_mutex_lock (&ring->mutex);
+    g_cond_signal (&ring->cond);
+    g_mutex_unlock (&ring->mutex);
+  }
+}
+
+static inline gpointer
+ring_push_begin (Ring *ring)
+{
+  const guint tail = (guint)ring->tail;
+  guint n_waits = 0;
+
+  while (!ring_can_push (ring)) {
+    ring_wait (ring, &n_waits, ring_can_push);
+  }
+
+  return ring->slots + (tail & ring->mask) * ring->slot_size;
+}
+
+static inline void
+ring_push_end (Ring *ring)
+{
+  g_atomic_int_set (&ring->tail, (gint)((guint)ring->tail + 1));
+  ring_wake (ring);
+}
+
+static inline gpointer
+ring_pop_begin (Ring *ring)
+{
+  const guint head = (guint)ring->head;
+  guint n_waits = 0;
+
+  while (!ring_can_pop (ring)) {
+    ring_wait (ring, &n_waits, ring_can_pop);
+  }
+
+  return ring->slots + (head & ring->mask) * ring->slot_size;
+}
+
+static inline void
+ring_pop_end (Ring *ring)
+{
+  g_atomic_int_set (&ring->head, (gint)((guint)ring->head + 1));
+  ring_wake (ring);
+}
+
+#endif
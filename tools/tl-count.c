@@ -0,0 +1,439 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libtweetlength.h"
+#include "tl-corpus.h"
+#include "records.h"
+#include "input.h"
+#include "pipeline.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define READ_BUFFER_SIZE   (8 * 1024 * 1024)
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+typedef struct {
+  const Record *records;
+  guint n_records;
+  GString *output;
+  GString *scratch;
+} Job;
+
+typedef struct {
+  RecordFormat format;
+  guint n_threads;
+  GThreadPool *pool;
+  Job *jobs;
+
+  GMutex lock;
+  GCond done_cond;
+  guint n_pending;
+
+  gboolean pipeline;
+  TlCorpusStats corpus_stats;
+} CountContext;
+
+static void
+run_job (Job                *job,
+         const RecordFormat *format)
+{
+  guint i;
+
+  g_string_truncate (job->output, 0);
+
+  for (i = 0; i < job->n_records; i ++) {
+    record_format (&job->records[i], format, job->scratch, job->output);
+  }
+}
+
+static void
+pool_func (gpointer data,
+           gpointer user_data)
+{
+  CountContext *ctx = user_data;
+
+  run_job (data, &ctx->format);
+
+  g_mutex_lock (&ctx->lock);
+  ctx->n_pending --;
+  if (ctx->n_pending == 0) {
+    g_cond_signal (&ctx->done_cond);
+  }
+  g_mutex_unlock (&ctx->lock);
+}
+
+/*
+ * Splits @records into one contiguous range per thread and writes the results
+ * in range order, so the output order is always the input order.
+ */
+static void
+process_batch (CountContext *ctx,
+               const char   *data,
+               gsize         length,
+               const GArray *records)
+{
+  const guint n_jobs = MIN (ctx->n_threads, MAX (records->len, 1));
+  const guint per_job = records->len / n_jobs;
+  guint first = 0;
+  guint i;
+
+  for (i = 0; i < n_jobs; i ++) {
+    Job *job = &ctx->jobs[i];
+
+    job->records = &g_array_index (records, Record, first);
+    job->n_records = per_job + (i < records->len % n_jobs ? 1 : 0);
+    first += job->n_records;
+  }
+
+  if (n_jobs > 1) {
+    ctx->n_pending = n_jobs - 1;
+    for (i = 1; i < n_jobs; i ++) {
+      g_thread_pool_push (ctx->pool, &ctx->jobs[i], NULL);
+    }
+  }
+
+  // The calling thread does the first range itself
+  run_job (&ctx->jobs[0], &ctx->format);
+
+  if (n_jobs > 1) {
+    g_mutex_lock (&ctx->lock);
+    while (ctx->n_pending > 0) {
+      g_cond_wait (&ctx->done_cond, &ctx->lock);
+    }
+    g_mutex_unlock (&ctx->lock);
+  }
+
+  for (i = 0; i < n_jobs; i ++) {
+    fwrite (ctx->jobs[i].output->str, 1, ctx->jobs[i].output->len, stdout);
+  }
+}
+
+typedef void (* BatchFunc) (CountContext *ctx,
+                            const char   *data,
+                            gsize         length,
+                            const GArray *records);
+
+static gboolean
+read_batches (CountContext *ctx,
+              Input        *input,
+              BatchFunc     batch_func)
+{
+  gsize capacity = READ_BUFFER_SIZE;
+  char *buffer = g_malloc (capacity + RECORD_PADDING);
+  gsize filled = 0;
+  gboolean at_eof = FALSE;
+  gboolean success = TRUE;
+  GArray *records = g_array_sized_new (FALSE, FALSE, sizeof (Record), 64 * 1024);
+  GError *error = NULL;
+
+  while (!at_eof) {
+    gsize consumed;
+
+    // Fill the whole buffer (or hit EOF) so batches stay big even on pipes
+    while (filled < capacity) {
+      gssize n_read = input_read (input, buffer + filled, capacity - filled, &error);
+
+      if (n_read < 0) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        success = FALSE;
+        goto out;
+      }
+
+      if (n_read == 0) {
+        at_eof = TRUE;
+        break;
+      }
+
+      filled += n_read;
+    }
+
+    memset (buffer + filled, 0, RECORD_PADDING);
+    consumed = records_split (buffer, filled, at_eof, records);
+
+    if (records->len == 0 && !at_eof) {
+      // A single record does not fit into the buffer
+      capacity *= 2;
+      buffer = g_realloc (buffer, capacity + RECORD_PADDING);
+      continue;
+    }
+
+    batch_func (ctx, buffer, consumed, records);
+
+    // Keep the incomplete last record around for the next round
+    memmove (buffer, buffer + consumed, filled - consumed);
+    filled -= consumed;
+  }
+
+out:
+  g_array_free (records, TRUE);
+  g_free (buffer);
+
+  return success;
+}
+
+static gboolean
+count_fd (CountContext *ctx,
+          int           fd,
+          const char   *name)
+{
+  GError *error = NULL;
+  Input *input;
+  gboolean success;
+
+  input = input_open (fd, name, &error);
+  if (input == NULL) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  if (ctx->pipeline) {
+    success = pipeline_run (input, &ctx->format, stdout);
+  } else {
+    success = read_batches (ctx, input, process_batch);
+  }
+  input_free (input);
+
+  return success;
+}
+
+static gboolean
+select_text (const char  *record,
+             gsize        record_length,
+             GString     *scratch,
+             const char **out_text,
+             gsize       *out_text_length,
+             gpointer     user_data)
+{
+  return record_select_text (record, record_length, user_data, scratch,
+                             out_text, out_text_length);
+}
+
+static void
+scan_batch (CountContext *ctx,
+            const char   *data,
+            gsize         length,
+            const GArray *records)
+{
+  TlCorpusStats stats;
+
+  tl_corpus_scan (data, length, ctx->n_threads,
+                  ctx->format.field_path != NULL ? select_text : NULL,
+                  ctx->format.field_path,
+                  &stats);
+  tl_corpus_stats_merge (&ctx->corpus_stats, &stats);
+}
+
+/*
+ * Corpus mode: Map the file and only print aggregated stats for it.
+ * Compressed files can't be mapped, they get decompressed and scanned
+ * batch by batch instead.
+ */
+static gboolean
+scan_file (CountContext *ctx,
+           const char   *filename)
+{
+  TlCorpusStats stats;
+  GError *error = NULL;
+  Input *input;
+  int fd;
+
+  fd = open (filename, O_RDONLY);
+  if (fd < 0) {
+    g_printerr ("Could not open %s: %s\n", filename, g_strerror (errno));
+    return FALSE;
+  }
+
+  input = input_open (fd, filename, &error);
+  if (input == NULL) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    close (fd);
+    return FALSE;
+  }
+
+  if (input_get_compression (input) != COMPRESSION_NONE) {
+    gboolean success;
+
+    memset (&ctx->corpus_stats, 0, sizeof (TlCorpusStats));
+    success = read_batches (ctx, input, scan_batch);
+    stats = ctx->corpus_stats;
+
+    input_free (input);
+    close (fd);
+
+    if (!success) {
+      return FALSE;
+    }
+  } else {
+    input_free (input);
+    close (fd);
+
+    if (!tl_corpus_scan_file (filename, ctx->n_threads,
+                              ctx->format.field_path != NULL ? select_text : NULL,
+                              ctx->format.field_path,
+                              &stats, &error)) {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+  }
+
+  if (ctx->format.json_output) {
+    GString *json = g_string_new ("{\"file\":");
+
+    json_append_string (json, filename);
+    g_string_append_printf (json, ",\"records\":%" G_GUINT64_FORMAT ",\"skipped\":%" G_GUINT64_FORMAT
+                            ",\"bytes\":%" G_GUINT64_FORMAT ",\"weighted_length\":%" G_GUINT64_FORMAT
+                            ",\"max_weighted_length\":%" G_GUINT64_FORMAT ",\"hashtags\":%" G_GUINT64_FORMAT
+                            ",\"links\":%" G_GUINT64_FORMAT ",\"mentions\":%" G_GUINT64_FORMAT "}\n",
+                            stats.n_records, stats.n_skipped, stats.n_bytes, stats.n_characters,
+                            stats.max_characters, stats.n_hashtags, stats.n_links, stats.n_mentions);
+    fputs (json->str, stdout);
+    g_string_free (json, TRUE);
+  } else {
+    printf ("%s\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+            "\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+            "\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\n",
+            filename, stats.n_records, stats.n_skipped, stats.n_bytes, stats.n_characters,
+            stats.max_characters, stats.n_hashtags, stats.n_links, stats.n_mentions);
+  }
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  CountContext ctx = { 0 };
+  char *field = NULL;
+  gboolean json_output = FALSE;
+  gboolean corpus_mode = FALSE;
+  gboolean pipeline = FALSE;
+  int n_threads = 1;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  gboolean success = TRUE;
+  guint i;
+  const GOptionEntry entries[] = {
+    { "field", 'f', 0, G_OPTION_ARG_STRING, &field,
+      "Read NDJSON and count the string member at PATH, e.g. extended_tweet.full_text", "PATH" },
+    { "json", 'j', 0, G_OPTION_ARG_NONE, &json_output,
+      "Write one JSON object per record instead of tab-separated values", NULL },
+    { "threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+      "Number of counting threads, 0 for one per CPU", "N" },
+    { "corpus", 'c', 0, G_OPTION_ARG_NONE, &corpus_mode,
+      "Map each FILE and print only aggregated stats (records, skipped, bytes, weighted length, "
+      "max weighted length, hashtags, links, mentions)", NULL },
+    { "pipeline", 'p', 0, G_OPTION_ARG_NONE, &pipeline,
+      "Read, tokenize, parse and write on one thread each, instead of --threads", NULL },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("[FILE…] - count tweet lengths per line");
+  g_option_context_set_description (option_context,
+                                    "Reads standard input if no FILE is given.\n"
+                                    "Output: length, weighted length and type:start:length of each entity.");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  if (n_threads <= 0) {
+    n_threads = g_get_num_processors ();
+  }
+
+  if (field != NULL) {
+    ctx.format.field_path = g_strsplit (field, ".", -1);
+  }
+  ctx.format.json_output = json_output;
+  ctx.pipeline = pipeline;
+  ctx.n_threads = n_threads;
+  ctx.jobs = g_new0 (Job, ctx.n_threads);
+  for (i = 0; i < ctx.n_threads; i ++) {
+    ctx.jobs[i].output = g_string_sized_new (OUTPUT_BUFFER_SIZE);
+    ctx.jobs[i].scratch = g_string_new (NULL);
+  }
+  if (ctx.n_threads > 1) {
+    ctx.pool = g_thread_pool_new (pool_func, &ctx, ctx.n_threads - 1, TRUE, NULL);
+  }
+  g_mutex_init (&ctx.lock);
+  g_cond_init (&ctx.done_cond);
+
+  setvbuf (stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+  if (argc < 2) {
+    if (corpus_mode) {
+      g_printerr ("--corpus needs at least one FILE\n");
+      success = FALSE;
+    } else {
+      success = count_fd (&ctx, STDIN_FILENO, "stdin");
+    }
+  }
+
+  for (i = 1; i < (guint)argc; i ++) {
+    int fd;
+
+    if (corpus_mode) {
+      success &= scan_file (&ctx, argv[i]);
+      continue;
+    }
+
+    if (strcmp (argv[i], "-") == 0) {
+      success &= count_fd (&ctx, STDIN_FILENO, "stdin");
+      continue;
+    }
+
+    fd = open (argv[i], O_RDONLY);
+    if (fd < 0) {
+      g_printerr ("Could not open %s: %s\n", argv[i], g_strerror (errno));
+      success = FALSE;
+      continue;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    success &= count_fd (&ctx, fd, argv[i]);
+    close (fd);
+  }
+
+  fflush (stdout);
+
+  if (ctx.pool != NULL) {
+    g_thread_pool_free (ctx.pool, FALSE, TRUE);
+  }
+  for (i = 0; i < ctx.n_threads; i ++) {
+    g_string_free (ctx.jobs[i].output, TRUE);
+    g_string_free (ctx.jobs[i].scratch, TRUE);
+  }
+  g_free (ctx.jobs);
+  g_mutex_clear (&ctx.lock);
+  g_cond_clear (&ctx.done_cond);
+  g_strfreev (ctx.format.field_path);
+  g_free (field);
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,900 @@
+/*  This file is part of libtweetlength
+ *  Copyright (C) 2017 Timm Bäder
+ *
+ *  libtweetlength is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  libtweetlength is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with libtweetlength.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * tl-server: Counts tweets for other processes over a unix domain socket.
+ *
+ * All integers are little-endian. Every message in either direction is a frame
+ *
+ *   u32 length      Number of bytes following this field
+ *   u32 id          Chosen by the client, echoed in the response
+ *   u16 type        REQUEST_COUNT or REQUEST_STATS
+ *   u16 flags       Request: FLAG_ENTITIES. Response: status, 0 means OK.
+ *   ...payload
+ *
+ * REQUEST_COUNT payload:  u32 n_texts, then n_texts times { u32 length, UTF-8 bytes }
+ * Response payload:       u32 n_texts, then n_texts times
+ *                           { u32 weighted_length, u32 n_entities,
+ *                             n_entities times { u32 type, u32 start_character,
+ *                                                u32 length_in_characters,
+ *                                                u32 start_byte, u32 length_in_bytes } }
+ *                         Entities are only included if FLAG_ENTITIES was set.
+ *
+ * REQUEST_STATS has no payload, the response payload is a JSON object.
+ * Responses to failed requests carry an error message as payload.
+ *
+ * Requests on one connection are handled concurrently, so responses can arrive
+ * in a different order. Use the id to match them up. A client that shuts down
+ * its sending side still gets the responses to all complete requests before
+ * the server closes the connection.
+ */
+
+#include "libtweetlength.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define HEADER_SIZE        12 /* length + id + type + flags */
+#define MAX_FRAME_SIZE     (16 * 1024 * 1024)
+#define MAX_IN_FLIGHT      256
+#define READ_SIZE          (64 * 1024)
+#define MAX_EVENTS         64
+// A truncated UTF-8 sequence at the end of a text gets read in full
+#define FRAME_PADDING      8
+#define N_LATENCY_BUCKETS  32
+
+enum {
+  REQUEST_COUNT = 1,
+  REQUEST_STATS = 2,
+};
+
+enum {
+  FLAG_ENTITIES = 1 << 0,
+};
+
+enum {
+  STATUS_OK          = 0,
+  STATUS_BAD_REQUEST = 1,
+};
+
+typedef struct {
+  int fd;
+  gint ref_count;
+  gint n_in_flight;
+  guint32 events;
+
+  // Main thread only
+  GString *in;
+  gboolean pending; // Already in Server.pending
+  gboolean read_closed; // Got EOF, closed once everything is answered
+
+  // Written by workers, sent by the main thread
+  GMutex lock;
+  GString *out;
+  gsize out_pos;
+  gboolean closed;
+} Connection;
+
+typedef struct {
+  GMutex lock;
+  gint64 start_time;
+  guint64 n_connections;
+  guint64 n_requests;
+  guint64 n_texts;
+  guint64 n_bytes;
+  guint64 n_errors;
+  // Bucket i counts requests that took [2^i, 2^(i+1)) µs
+  guint64 latency_buckets[N_LATENCY_BUCKETS];
+} Stats;
+
+typedef struct {
+  int epoll_fd;
+  int listen_fd;
+  int wake_fd;
+  int signal_fd;
+
+  GThreadPool *pool;
+  GHashTable *connections; // Open connections, each holding a reference
+  // Closed while handling the current batch of events. Their references
+  // are dropped after it, so later events of the batch can still check.
+  GPtrArray *closed;
+
+  GMutex pending_lock;
+  GPtrArray *pending;
+
+  Stats stats;
+} Server;
+
+typedef struct {
+  Server *server;
+  Connection *connection;
+  char *frame;
+  gsize frame_length;
+  gint64 receive_time;
+} Job;
+
+// Per worker thread, reused for every request that thread handles
+typedef struct {
+  GString *response;
+} Scratch;
+
+static void
+scratch_free (gpointer data)
+{
+  Scratch *scratch = data;
+
+  g_string_free (scratch->response, TRUE);
+  g_free (scratch);
+}
+
+static GPrivate scratch_key = G_PRIVATE_INIT (scratch_free);
+
+static Connection *
+connection_ref (Connection *connection)
+{
+  g_atomic_int_inc (&connection->ref_count);
+
+  return connection;
+}
+
+static void
+connection_unref (Connection *connection)
+{
+  if (!g_atomic_int_dec_and_test (&connection->ref_count)) {
+    return;
+  }
+
+  g_string_free (connection->in, TRUE);
+  g_string_free (connection->out, TRUE);
+  g_mutex_clear (&connection->lock);
+  g_free (connection);
+}
+
+static inline guint32
+read_u32 (const char *p)
+{
+  guint32 v;
+
+  memcpy (&v, p, sizeof (v));
+  return GUINT32_FROM_LE (v);
+}
+
+static inline guint16
+read_u16 (const char *p)
+{
+  guint16 v;
+
+  memcpy (&v, p, sizeof (v));
+  return GUINT16_FROM_LE (v);
+}
+
+static inline void
+append_u32 (GString *s,
+            guint32  v)
+{
+  v = GUINT32_TO_LE (v);
+  g_string_append_len (s, (const char *)&v, sizeof (v));
+}
+
+static inline void
+append_u16 (GString *s,
+            guint16  v)
+{
+  v = GUINT16_TO_LE (v);
+  g_string_append_len (s, (const char *)&v, sizeof (v));
+}
+
+static inline void
+set_u32 (GString *s,
+         gsize    offset,
+         guint32  v)
+{
+  v = GUINT32_TO_LE (v);
+  memcpy (s->str + offset, &v, sizeof (v));
+}
+
+static gboolean
+handle_count (const char *payload,
+              gsize       payload_length,
+              gboolean    with_entities,
+              GString    *response,
+              guint64    *out_n_texts,
+              guint64    *out_n_bytes)
+{
+  const char *p = payload;
+  const char *end = payload + payload_length;
+  guint32 n_texts;
+  guint32 i;
+
+  if (payload_length < 4) {
+    return FALSE;
+  }
+
+  n_texts = read_u32 (p);
+  p += 4;
+  append_u32 (response, n_texts);
+
+  for (i = 0; i < n_texts; i ++) {
+    guint32 text_length;
+    TlEntity *entities = NULL;
+    gsize n_entities = 0;
+    gsize weighted_length;
+    gsize e;
+
+    if (end - p < 4) {
+      return FALSE;
+    }
+    text_length = read_u32 (p);
+    p += 4;
+    if ((gsize)(end - p) < text_length) {
+      return FALSE;
+    }
+
+    if (text_length == 0) {
+      weighted_length = 0;
+    } else if (with_entities) {
+      entities = tl_extract_entities_n (p, text_length, &n_entities, &weighted_length);
+    } else {
+      weighted_length = tl_count_characters_n (p, text_length);
+    }
+
+    append_u32 (response, weighted_length);
+    append_u32 (response, n_entities);
+    for (e = 0; e < n_entities; e ++) {
+      append_u32 (response, entities[e].type);
+      append_u32 (response, entities[e].start_character_index);
+      append_u32 (response, entities[e].length_in_characters);
+      append_u32 (response, entities[e].start - p);
+      append_u32 (response, entities[e].length_in_bytes);
+    }
+    g_free (entities);
+
+    *out_n_texts += 1;
+    *out_n_bytes += text_length;
+    p += text_length;
+  }
+
+  return TRUE;
+}
+
+static guint64
+latency_percentile (const Stats *stats,
+                    double       percentile)
+{
+  guint64 total = 0;
+  guint64 seen = 0;
+  guint i;
+
+  for (i = 0; i < N_LATENCY_BUCKETS; i ++) {
+    total += stats->latency_buckets[i];
+  }
+
+  if (total == 0) {
+    return 0;
+  }
+
+  for (i = 0; i < N_LATENCY_BUCKETS; i ++) {
+    seen += stats->latency_buckets[i];
+    if (seen >= total * percentile) {
+      break;
+    }
+  }
+
+  // Upper bound of the bucket
+  return G_GUINT64_CONSTANT (1) << (i + 1);
+}
+
+static void
+format_stats (Server  *server,
+              GString *out)
+{
+  Stats *stats = &server->stats;
+  double uptime;
+
+  g_mutex_lock (&stats->lock);
+  uptime = (g_get_monotonic_time () - stats->start_time) / (double)G_USEC_PER_SEC;
+  g_string_append_printf (out,
+                          "{\"uptime_s\":%.3f,\"connections\":%" G_GUINT64_FORMAT
+                          ",\"requests\":%" G_GUINT64_FORMAT ",\"texts\":%" G_GUINT64_FORMAT
+                          ",\"bytes\":%" G_GUINT64_FORMAT ",\"errors\":%" G_GUINT64_FORMAT
+                          ",\"texts_per_s\":%.1f,\"mb_per_s\":%.3f"
+                          ",\"latency_us\":{\"p50\":%" G_GUINT64_FORMAT ",\"p99\":%" G_GUINT64_FORMAT
+                          ",\"p999\":%" G_GUINT64_FORMAT "}}",
+                          uptime, stats->n_connections, stats->n_requests, stats->n_texts,
+                          stats->n_bytes, stats->n_errors,
+                          stats->n_texts / uptime, stats->n_bytes / uptime / (1024.0 * 1024.0),
+                          latency_percentile (stats, 0.5), latency_percentile (stats, 0.99),
+                          latency_percentile (stats, 0.999));
+  g_mutex_unlock (&stats->lock);
+}
+
+static void
+queue_response (Server     *server,
+                Connection *connection,
+                GString    *response)
+{
+  const guint64 one = 1;
+
+  g_mutex_lock (&connection->lock);
+  if (!connection->closed) {
+    g_string_append_len (connection->out, response->str, response->len);
+  }
+  g_mutex_unlock (&connection->lock);
+
+  g_atomic_int_add (&connection->n_in_flight, -1);
+
+  // The main thread sends the data and drops this reference
+  g_mutex_lock (&server->pending_lock);
+  g_ptr_array_add (server->pending, connection_ref (connection));
+  g_mutex_unlock (&server->pending_lock);
+
+  if (write (server->wake_fd, &one, sizeof (one)) < 0) {
+    g_warning ("Could not wake up main loop: %s", g_strerror (errno));
+  }
+}
+
+static void
+worker_func (gpointer data,
+             gpointer user_data)
+{
+  Job *job = data;
+  Server *server = user_data;
+  Scratch *scratch = g_private_get (&scratch_key);
+  const guint32 id = read_u32 (job->frame);
+  const guint16 type = read_u16 (job->frame + 4);
+  const guint16 flags = read_u16 (job->frame + 6);
+  const char *payload = job->frame + HEADER_SIZE - 4;
+  const gsize payload_length = job->frame_length - (HEADER_SIZE - 4);
+  guint64 n_texts = 0;
+  guint64 n_bytes = 0;
+  gboolean success;
+  gint64 latency;
+  guint bucket;
+
+  if (scratch == NULL) {
+    scratch = g_new0 (Scratch, 1);
+    scratch->response = g_string_sized_new (READ_SIZE);
+    g_private_set (&scratch_key, scratch);
+  }
+
+  g_string_truncate (scratch->response, 0);
+  append_u32 (scratch->response, 0); // Length, set below
+  append_u32 (scratch->response, id);
+  append_u16 (scratch->response, type);
+  append_u16 (scratch->response, STATUS_OK);
+
+  switch (type) {
+    case REQUEST_COUNT:
+      success = handle_count (payload, payload_length, (flags & FLAG_ENTITIES) != 0,
+                              scratch->response, &n_texts, &n_bytes);
+    break;
+
+    case REQUEST_STATS:
+      format_stats (server, scratch->response);
+      success = TRUE;
+    break;
+
+    default:
+      success = FALSE;
+  }
+
+  if (!success) {
+    g_string_truncate (scratch->response, HEADER_SIZE - 2);
+    append_u16 (scratch->response, STATUS_BAD_REQUEST);
+    g_string_append (scratch->response, "Malformed request");
+  }
+
+  set_u32 (scratch->response, 0, scratch->response->len - 4);
+  queue_response (server, job->connection, scratch->response);
+
+  latency = g_get_monotonic_time () - job->receive_time;
+  bucket = latency > 0 ? MIN (g_bit_storage (latency) - 1, N_LATENCY_BUCKETS - 1) : 0;
+
+  g_mutex_lock (&server->stats.lock);
+  server->stats.n_requests ++;
+  server->stats.n_texts += n_texts;
+  server->stats.n_bytes += n_bytes;
+  server->stats.n_errors += success ? 0 : 1;
+  server->stats.latency_buckets[bucket] ++;
+  g_mutex_unlock (&server->stats.lock);
+
+  connection_unref (job->connection);
+  g_free (job->frame);
+  g_free (job);
+}
+
+static void
+connection_update_events (Server     *server,
+                          Connection *connection)
+{
+  struct epoll_event event = { 0 };
+  gboolean has_output;
+
+  g_mutex_lock (&connection->lock);
+  has_output = connection->out_pos < connection->out->len;
+  g_mutex_unlock (&connection->lock);
+
+  // Stop reading from clients that don't pick up their responses
+  if (!connection->read_closed &&
+      g_atomic_int_get (&connection->n_in_flight) < MAX_IN_FLIGHT) {
+    event.events |= EPOLLIN;
+  }
+  if (has_output) {
+    event.events |= EPOLLOUT;
+  }
+
+  if (event.events == connection->events) {
+    return;
+  }
+
+  event.data.ptr = connection;
+  epoll_ctl (server->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+  connection->events = event.events;
+}
+
+static void
+connection_close (Server     *server,
+                  Connection *connection)
+{
+  if (!g_hash_table_steal (server->connections, connection)) {
+    return;
+  }
+
+  g_mutex_lock (&connection->lock);
+  connection->closed = TRUE;
+  g_mutex_unlock (&connection->lock);
+
+  epoll_ctl (server->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+  close (connection->fd);
+
+  g_ptr_array_add (server->closed, connection);
+}
+
+/*
+ * After EOF from the client, closes @connection once the responses to all
+ * requests it sent before are out.
+ */
+static void
+connection_close_if_done (Server     *server,
+                          Connection *connection)
+{
+  gboolean has_output;
+
+  if (!connection->read_closed ||
+      g_atomic_int_get (&connection->n_in_flight) > 0) {
+    return;
+  }
+
+  g_mutex_lock (&connection->lock);
+  has_output = connection->out_pos < connection->out->len;
+  g_mutex_unlock (&connection->lock);
+
+  if (!has_output) {
+    connection_close (server, connection);
+  }
+}
+
+static gboolean
+connection_flush (Connection *connection)
+{
+  gboolean success = TRUE;
+
+  g_mutex_lock (&connection->lock);
+  while (!connection->closed && connection->out_pos < connection->out->len) {
+    gssize n_written = send (connection->fd,
+                             connection->out->str + connection->out_pos,
+                             connection->out->len - connection->out_pos,
+                             MSG_NOSIGNAL);
+
+    if (n_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      success = errno == EAGAIN || errno == EWOULDBLOCK;
+      break;
+    }
+
+    connection->out_pos += n_written;
+  }
+
+  if (connection->out_pos == connection->out->len) {
+    g_string_truncate (connection->out, 0);
+    connection->out_pos = 0;
+  }
+  g_mutex_unlock (&connection->lock);
+
+  return success;
+}
+
+static void
+dispatch_frames (Server     *server,
+                 Connection *connection)
+{
+  gsize pos = 0;
+
+  while (connection->in->len - pos >= 4) {
+    const guint32 frame_length = read_u32 (connection->in->str + pos);
+    Job *job;
+
+    if (frame_length < HEADER_SIZE - 4 || frame_length > MAX_FRAME_SIZE) {
+      g_warning ("Invalid frame length %u, closing connection", frame_length);
+      connection_close (server, connection);
+      return;
+    }
+
+    if (connection->in->len - pos - 4 < frame_length) {
+      break;
+    }
+
+    job = g_new (Job, 1);
+    job->server = server;
+    job->connection = connection_ref (connection);
+    job->frame_length = frame_length;
+    job->frame = g_malloc (frame_length + FRAME_PADDING);
+    memcpy (job->frame, connection->in->str + pos + 4, frame_length);
+    memset (job->frame + frame_length, 0, FRAME_PADDING);
+    job->receive_time = g_get_monotonic_time ();
+
+    g_atomic_int_inc (&connection->n_in_flight);
+    g_thread_pool_push (server->pool, job, NULL);
+
+    pos += 4 + frame_length;
+  }
+
+  g_string_erase (connection->in, 0, pos);
+  connection_update_events (server, connection);
+}
+
+static void
+connection_read (Server     *server,
+                 Connection *connection)
+{
+  for (;;) {
+    gsize old_length = connection->in->len;
+    gssize n_read;
+
+    g_string_set_size (connection->in, old_length + READ_SIZE);
+    n_read = recv (connection->fd, connection->in->str + old_length, READ_SIZE, 0);
+
+    if (n_read <= 0) {
+      g_string_set_size (connection->in, old_length);
+
+      if (n_read < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (n_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+
+      if (n_read < 0) {
+        connection_close (server, connection);
+        return;
+      }
+
+      // EOF, but complete requests before it still get answered
+      connection->read_closed = TRUE;
+      break;
+    }
+
+    g_string_set_size (connection->in, old_length + n_read);
+  }
+
+  dispatch_frames (server, connection);
+  if (g_hash_table_contains (server->connections, connection)) {
+    connection_close_if_done (server, connection);
+  }
+}
+
+static void
+accept_connections (Server *server)
+{
+  for (;;) {
+    struct epoll_event event = { 0 };
+    Connection *connection;
+    int fd;
+
+    fd = accept4 (server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        g_warning ("accept failed: %s", g_strerror (errno));
+      }
+      break;
+    }
+
+    connection = g_new0 (Connection, 1);
+    connection->fd = fd;
+    connection->ref_count = 1;
+    connection->in = g_string_sized_new (READ_SIZE);
+    connection->out = g_string_sized_new (READ_SIZE);
+    connection->events = EPOLLIN;
+    g_mutex_init (&connection->lock);
+    g_hash_table_add (server->connections, connection);
+
+    event.events = EPOLLIN;
+    event.data.ptr = connection;
+    epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+
+    g_mutex_lock (&server->stats.lock);
+    server->stats.n_connections ++;
+    g_mutex_unlock (&server->stats.lock);
+  }
+}
+
+static void
+send_pending (Server *server)
+{
+  GPtrArray *pending;
+  guint64 counter;
+  guint i;
+
+  if (read (server->wake_fd, &counter, sizeof (counter)) < 0 && errno != EAGAIN) {
+    g_warning ("Could not read from eventfd: %s", g_strerror (errno));
+  }
+
+  g_mutex_lock (&server->pending_lock);
+  pending = server->pending;
+  server->pending = g_ptr_array_new ();
+  g_mutex_unlock (&server->pending_lock);
+
+  for (i = 0; i < pending->len; i ++) {
+    Connection *connection = g_ptr_array_index (pending, i);
+
+    // Still open?
+    if (g_hash_table_contains (server->connections, connection)) {
+      if (connection_flush (connection)) {
+        connection_update_events (server, connection);
+        connection_close_if_done (server, connection);
+      } else {
+        connection_close (server, connection);
+      }
+    }
+
+    connection_unref (connection);
+  }
+
+  g_ptr_array_free (pending, TRUE);
+}
+
+static int
+listen_on (const char  *path,
+           GError     **error)
+{
+  struct sockaddr_un address = { 0 };
+  int fd;
+
+  if (strlen (path) >= sizeof (address.sun_path)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_NAMETOOLONG,
+                 "Socket path %s is too long", path);
+    return -1;
+  }
+
+  address.sun_family = AF_UNIX;
+  strcpy (address.sun_path, path);
+
+  fd = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    goto fail;
+  }
+
+  // A stale socket from an earlier run
+  unlink (path);
+
+  if (bind (fd, (struct sockaddr *)&address, sizeof (address)) != 0 ||
+      listen (fd, SOMAXCONN) != 0) {
+    goto fail;
+  }
+
+  return fd;
+
+fail:
+  {
+    int saved_errno = errno;
+
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                 "Could not listen on %s: %s", path, g_strerror (saved_errno));
+    if (fd >= 0) {
+      close (fd);
+    }
+  }
+  return -1;
+}
+
+static void
+add_fd (Server *server,
+        int     fd,
+        guint32 events)
+{
+  struct epoll_event event = { 0 };
+
+  event.events = events;
+  // Connections use their Connection* as data, these use their fd's address
+  event.data.ptr = fd == server->listen_fd ? (gpointer)&server->listen_fd :
+                   fd == server->wake_fd ? (gpointer)&server->wake_fd :
+                                           (gpointer)&server->signal_fd;
+  epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+int
+main (int argc, char **argv)
+{
+  Server server = { 0 };
+  char *socket_path = NULL;
+  int n_threads = 0;
+  gboolean running = TRUE;
+  GOptionContext *option_context;
+  GError *error = NULL;
+  sigset_t signals;
+  GString *stats;
+  GHashTableIter iter;
+  gpointer key;
+  const GOptionEntry entries[] = {
+    { "socket", 's', 0, G_OPTION_ARG_FILENAME, &socket_path,
+      "Path of the unix socket to listen on", "PATH" },
+    { "threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+      "Number of worker threads, 0 for one per CPU", "N" },
+    { NULL }
+  };
+
+  option_context = g_option_context_new ("- count tweets for other processes");
+  g_option_context_add_main_entries (option_context, entries, NULL);
+  if (!g_option_context_parse (option_context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_option_context_free (option_context);
+    return 1;
+  }
+  g_option_context_free (option_context);
+
+  if (socket_path == NULL) {
+    socket_path = g_build_filename (g_get_user_runtime_dir (), "tl-server.sock", NULL);
+  }
+
+  if (n_threads <= 0) {
+    n_threads = g_get_num_processors ();
+  }
+
+  // Before any thread gets started, so only the signalfd sees these
+  sigemptyset (&signals);
+  sigaddset (&signals, SIGINT);
+  sigaddset (&signals, SIGTERM);
+  sigprocmask (SIG_BLOCK, &signals, NULL);
+
+  server.listen_fd = listen_on (socket_path, &error);
+  if (server.listen_fd < 0) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_free (socket_path);
+    return 1;
+  }
+
+  server.epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  server.wake_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  server.signal_fd = signalfd (-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  add_fd (&server, server.listen_fd, EPOLLIN);
+  add_fd (&server, server.wake_fd, EPOLLIN);
+  add_fd (&server, server.signal_fd, EPOLLIN);
+
+  server.connections = g_hash_table_new (NULL, NULL);
+  server.closed = g_ptr_array_new_with_free_func ((GDestroyNotify)connection_unref);
+  server.pending = g_ptr_array_new ();
+  g_mutex_init (&server.pending_lock);
+  g_mutex_init (&server.stats.lock);
+  server.stats.start_time = g_get_monotonic_time ();
+  server.pool = g_thread_pool_new (worker_func, &server, n_threads, TRUE, NULL);
+
+  g_printerr ("Listening on %s with %d threads\n", socket_path, n_threads);
+
+  while (running) {
+    struct epoll_event events[MAX_EVENTS];
+    int n_events;
+    int i;
+
+    n_events = epoll_wait (server.epoll_fd, events, MAX_EVENTS, -1);
+    if (n_events < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      g_printerr ("epoll_wait failed: %s\n", g_strerror (errno));
+      break;
+    }
+
+    for (i = 0; i < n_events; i ++) {
+      gpointer data = events[i].data.ptr;
+      Connection *connection;
+
+      if (data == &server.listen_fd) {
+        accept_connections (&server);
+        continue;
+      } else if (data == &server.wake_fd) {
+        send_pending (&server);
+        continue;
+      } else if (data == &server.signal_fd) {
+        running = FALSE;
+        continue;
+      }
+
+      connection = data;
+      // Closed while handling an earlier event of this batch
+      if (!g_hash_table_contains (server.connections, connection)) {
+        continue;
+      }
+
+      if (events[i].events & EPOLLOUT) {
+        if (!connection_flush (connection)) {
+          connection_close (&server, connection);
+          continue;
+        }
+        connection_update_events (&server, connection);
+        connection_close_if_done (&server, connection);
+        if (!g_hash_table_contains (server.connections, connection)) {
+          continue;
+        }
+      }
+
+      // Half-closed connections only wait for their responses, and there is
+      // no one left to read them after a hangup
+      if (connection->read_closed && (events[i].events & (EPOLLHUP | EPOLLERR))) {
+        connection_close (&server, connection);
+      } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        connection_read (&server, connection);
+      }
+    }
+
+    g_ptr_array_set_size (server.closed, 0);
+  }
+
+  // Let the workers finish, then drop everything
+  g_thread_pool_free (server.pool, FALSE, TRUE);
+  send_pending (&server);
+
+  g_hash_table_iter_init (&iter, server.connections);
+  while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    Connection *connection = key;
+
+    epoll_ctl (server.epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close (connection->fd);
+    g_hash_table_iter_steal (&iter);
+    connection_unref (connection);
+  }
+  g_hash_table_unref (server.connections);
+  g_ptr_array_free (server.closed, TRUE);
+
+  stats = g_string_new (NULL);
+  format_stats (&server, stats);
+  g_printerr ("%s\n", stats->str);
+  g_string_free (stats, TRUE);
+
+  unlink (socket_path);
+  close (server.listen_fd);
+  close (server.wake_fd);
+  close (server.signal_fd);
+  close (server.epoll_fd);
+  g_ptr_array_free (server.pending, TRUE);
+  g_mutex_clear (&server.pending_lock);
+  g_mutex_clear (&server.stats.lock);
+  g_free (socket_path);
+
+  return 0;
+}